@@ -0,0 +1,131 @@
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace MinjaSharp;
+
+/// <summary>
+/// Bridges one <c>mj_render_async</c> call to a task: completes the task from the native completion
+/// callback and forwards cancellation of a <see cref="CancellationToken"/> to the native cancel token.
+/// </summary>
+internal sealed class AsyncRender
+{
+    private readonly TaskCompletionSource<string> _completion = new(TaskCreationOptions.RunContinuationsAsynchronously);
+    private readonly CancellationToken _cancellationToken;
+    private readonly object _lock = new();
+    private IntPtr _cancelToken;
+    private CancellationTokenRegistration _registration;
+    private bool _completed;
+
+    private AsyncRender(CancellationToken cancellationToken)
+    {
+        _cancellationToken = cancellationToken;
+    }
+
+    internal static unsafe Task<string> Start(IntPtr templateHandle, IntPtr contextHandle, TimeSpan timeout, CancellationToken cancellationToken)
+    {
+        var render = new AsyncRender(cancellationToken);
+        var handle = GCHandle.Alloc(render);
+        var timeoutNs = timeout == Timeout.InfiniteTimeSpan ? 0UL : Math.Max(1UL, (ulong)timeout.Ticks * 100);
+        var result = Native.mj_render_async(templateHandle, contextHandle, &OnCompleted, GCHandle.ToIntPtr(handle), timeoutNs, out var cancelToken);
+        if (result != Native.MjOk)
+        {
+            // The completion callback never runs when the call fails.
+            handle.Free();
+            Native.CheckResult(result, "Rendering template asynchronously");
+        }
+        render.Attach(cancelToken);
+        return render._completion.Task;
+    }
+
+    // The render may already have finished by the time the token is handed over.
+    private void Attach(IntPtr cancelToken)
+    {
+        lock (_lock)
+        {
+            if (_completed)
+            {
+                Native.mj_free_cancel_token(cancelToken);
+                return;
+            }
+            _cancelToken = cancelToken;
+            // Runs the callback inline if the token is already cancelled; the lock is re-entrant.
+            _registration = _cancellationToken.Register(static state => ((AsyncRender)state!).Cancel(), this);
+        }
+    }
+
+    private void Cancel()
+    {
+        lock (_lock)
+        {
+            if (_cancelToken != IntPtr.Zero)
+            {
+                Native.mj_cancel(_cancelToken);
+            }
+        }
+    }
+
+    private void Complete(int status, string? output, string? errorMessage)
+    {
+        IntPtr cancelToken;
+        CancellationTokenRegistration registration;
+        lock (_lock)
+        {
+            _completed = true;
+            cancelToken = _cancelToken;
+            _cancelToken = IntPtr.Zero;
+            registration = _registration;
+        }
+
+        // Disposing waits for a running Cancel, which needs the lock, so it happens outside of it.
+        registration.Dispose();
+        if (cancelToken != IntPtr.Zero)
+        {
+            Native.mj_free_cancel_token(cancelToken);
+        }
+
+        if (status == Native.MjOk)
+        {
+            _completion.TrySetResult(output!);
+        }
+        else if (status == Native.MjErrorCancelled && _cancellationToken.IsCancellationRequested)
+        {
+            _completion.TrySetCanceled(_cancellationToken);
+        }
+        else
+        {
+            var message = $"Rendering template asynchronously failed. Code: {status}. Details: {errorMessage}";
+            _completion.TrySetException(Native.CreateException(status, message));
+        }
+    }
+
+    [UnmanagedCallersOnly(CallConvs = [typeof(CallConvCdecl)])]
+    private static unsafe void OnCompleted(int status, byte* data, nuint length, byte* errorMessage, IntPtr userData)
+    {
+        var handle = GCHandle.FromIntPtr(userData);
+        var render = (AsyncRender)handle.Target!;
+        handle.Free();
+
+        string? output = null;
+        string? error = null;
+        try
+        {
+            if (status == Native.MjOk)
+            {
+                output = length == 0 ? string.Empty : Encoding.UTF8.GetString(data, checked((int)length));
+            }
+            else
+            {
+                error = Marshal.PtrToStringUTF8((IntPtr)errorMessage);
+            }
+        }
+        catch (Exception ex)
+        {
+            // Exceptions must not cross back into native code.
+            render._completion.TrySetException(ex);
+            render.Complete(Native.MjError, null, ex.Message);
+            return;
+        }
+        render.Complete(status, output, error);
+    }
+}
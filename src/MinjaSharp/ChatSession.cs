@@ -0,0 +1,131 @@
+using System.Text;
+
+namespace MinjaSharp;
+
+/// <summary>
+/// A multi-turn conversation rendered through one template. The session keeps the context and its
+/// last output, so when messages are only appended, templates with a simple message loop render just
+/// the new messages. Other templates (and any change other than an append) fall back to a full render.
+/// Output is always identical to rendering the whole conversation from scratch.
+/// </summary>
+/// <remarks>A session is not thread-safe.</remarks>
+public sealed class ChatSession : IDisposable
+{
+    private IntPtr _handle;
+
+    /// <summary>
+    /// Creates a session. The root value is moved into the session and disposed.
+    /// </summary>
+    /// <param name="template">The chat template. The session keeps its own reference to the parsed template.</param>
+    /// <param name="root">The top-level variables; a <c>messages</c> entry, if present, must be an array.</param>
+    /// <exception cref="ArgumentNullException">If template or root is null.</exception>
+    /// <exception cref="MinjaException">If the session cannot be created in the native layer.</exception>
+    public ChatSession(Template template, Value root)
+    {
+        ArgumentNullException.ThrowIfNull(template);
+        ArgumentNullException.ThrowIfNull(root);
+        if (root.Handle == IntPtr.Zero) throw new ArgumentException("Root value has an invalid (null) handle.", nameof(root));
+
+        var result = Native.mj_chat_session_create(template.Handle, root.Handle, out var handle);
+        Native.CheckResult(result, "Creating chat session");
+        root.MarkConsumed();
+        _handle = handle;
+    }
+
+    /// <summary>
+    /// Creates a session from an object whose properties become the top-level variables.
+    /// </summary>
+    public static ChatSession Create<T>(Template template, T data)
+    {
+        ArgumentNullException.ThrowIfNull(data);
+        return new ChatSession(template, ValueBuilder.From(data));
+    }
+
+    /// <summary>
+    /// True if appended messages are rendered incrementally; false if every render is a full render.
+    /// </summary>
+    public bool IsIncremental
+    {
+        get
+        {
+            ObjectDisposedException.ThrowIf(_handle == IntPtr.Zero, this);
+            return Native.mj_chat_session_is_incremental(_handle) != 0;
+        }
+    }
+
+    /// <summary>
+    /// Appends a message. The value is moved into the session and disposed.
+    /// </summary>
+    public void Append(Value message)
+    {
+        ObjectDisposedException.ThrowIf(_handle == IntPtr.Zero, this);
+        ArgumentNullException.ThrowIfNull(message);
+
+        var result = Native.mj_chat_session_append_take(_handle, message.Handle);
+        Native.CheckResult(result, "Appending chat message");
+        message.MarkConsumed();
+    }
+
+    /// <summary>
+    /// Appends a message built from an object.
+    /// </summary>
+    public void Append<T>(T message)
+    {
+        ArgumentNullException.ThrowIfNull(message);
+        Append(ValueBuilder.From(message));
+    }
+
+    /// <summary>
+    /// Replaces a top-level variable. The value is moved into the session and disposed.
+    /// The next render is a full render.
+    /// </summary>
+    public void Set(string key, Value value)
+    {
+        ObjectDisposedException.ThrowIf(_handle == IntPtr.Zero, this);
+        ArgumentNullException.ThrowIfNull(key);
+        ArgumentNullException.ThrowIfNull(value);
+
+        var result = Native.mj_chat_session_set_take(_handle, key, value.Handle);
+        Native.CheckResult(result, $"Setting chat session variable '{key}'");
+        value.MarkConsumed();
+    }
+
+    /// <summary>
+    /// Renders the conversation.
+    /// </summary>
+    /// <exception cref="MinjaRenderException">Thrown if template rendering fails in the native layer.</exception>
+    public unsafe string Render()
+    {
+        ObjectDisposedException.ThrowIf(_handle == IntPtr.Zero, this);
+
+        var result = Native.mj_chat_session_render(_handle, out var data, out var length);
+        Native.CheckResult(result, "Rendering chat session");
+
+        if (length > int.MaxValue)
+        {
+            throw new MinjaAllocationException("Rendered output is too large for a .NET string.", Native.MjError);
+        }
+        return length == 0 ? string.Empty : Encoding.UTF8.GetString((byte*)data, (int)length);
+    }
+
+    /// <summary>
+    /// Frees the native session.
+    /// </summary>
+    public void Dispose()
+    {
+        if (_handle != IntPtr.Zero)
+        {
+            Native.mj_free_chat_session(_handle);
+            _handle = IntPtr.Zero;
+        }
+        GC.SuppressFinalize(this);
+    }
+
+    ~ChatSession()
+    {
+        if (_handle != IntPtr.Zero)
+        {
+            Native.mj_free_chat_session(_handle);
+        }
+    }
+}
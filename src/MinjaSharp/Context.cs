@@ -15,27 +15,191 @@ public sealed class Context : IDisposable
     /// <exception cref="ArgumentNullException">If root is null.</exception>
     /// <exception cref="ObjectDisposedException">If root is disposed.</exception>
     /// <exception cref="MinjaException">If context creation fails in the native layer.</exception>
-    public Context(Value root)
+    public Context(Value root) : this(root, takeOwnership: false)
+    {
+    }
+
+    /// <summary>
+    /// Creates a context from a root value, optionally moving the root into the context instead of copying it.
+    /// </summary>
+    /// <param name="root">The root value for this context. Cannot be null or disposed.</param>
+    /// <param name="takeOwnership">
+    /// When <c>true</c>, the root is moved into the context and disposed, avoiding a copy of the tree.
+    /// </param>
+    /// <exception cref="ArgumentNullException">If root is null.</exception>
+    /// <exception cref="MinjaException">If context creation fails in the native layer.</exception>
+    public Context(Value root, bool takeOwnership)
     {
         ArgumentNullException.ThrowIfNull(root);
-            
+
         if (root.Handle == IntPtr.Zero) throw new ArgumentException("Root value has an invalid (null) handle.", nameof(root)); // Should be caught by disposed check mostly
 
-        // Assuming Value class throws ObjectDisposedException if its Handle is accessed after disposal
-        // or if its internal _disposed flag is checked.
-        // For safety, we could check root._disposed if it were public/internal.
-        // Given current Value implementation, Handle would be IntPtr.Zero if disposed and owned.
+        if (!takeOwnership)
+        {
+            var copyResult = Native.mj_context_make(root.Handle, out var copiedHandle);
+            Native.CheckResult(copyResult, "Creating context");
+            Handle = copiedHandle;
+            return;
+        }
 
-        var result = Native.mj_context_make(root.Handle, out var contextHandle);
+        var result = Native.mj_context_make_take(root.Handle, out var contextHandle);
         Native.CheckResult(result, "Creating context");
+        root.MarkConsumed();
         Handle = contextHandle;
     }
 
+    private Context(IntPtr handle)
+    {
+        Handle = handle;
+    }
+
+    /// <summary>
+    /// Creates a context that layers <paramref name="overlay"/> over this one. Names missing from the overlay
+    /// are looked up here, and variables set while rendering land in the overlay, so a large shared context
+    /// (tool schemas, system prompt, model settings) can back many per-request contexts without being copied.
+    /// </summary>
+    /// <remarks>
+    /// A context used as a base may be shared across threads but must not be rendered or modified directly
+    /// while derived contexts are in use. Derived contexts keep the base alive, so it may be disposed first.
+    /// </remarks>
+    /// <param name="overlay">The per-request variables; must be an object.</param>
+    /// <param name="takeOwnership">When <c>true</c>, the overlay is moved into the new context and disposed.</param>
+    /// <exception cref="ObjectDisposedException">If this context is disposed.</exception>
+    /// <exception cref="ArgumentNullException">If overlay is null.</exception>
+    /// <exception cref="MinjaException">If context creation fails in the native layer.</exception>
+    public Context Derive(Value overlay, bool takeOwnership = false)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, this);
+        ArgumentNullException.ThrowIfNull(overlay);
+        if (overlay.Handle == IntPtr.Zero) throw new ArgumentException("Overlay value has an invalid (null) handle.", nameof(overlay));
+
+        if (!takeOwnership)
+        {
+            var copyResult = Native.mj_context_derive(Handle, overlay.Handle, out var copiedHandle);
+            Native.CheckResult(copyResult, "Deriving context");
+            return new Context(copiedHandle);
+        }
+
+        var result = Native.mj_context_derive_take(Handle, overlay.Handle, out var contextHandle);
+        Native.CheckResult(result, "Deriving context");
+        overlay.MarkConsumed();
+        return new Context(contextHandle);
+    }
+
+    /// <summary>
+    /// Creates a context that layers the properties of <paramref name="data"/> over this one.
+    /// </summary>
+    public Context Derive<T>(T data)
+    {
+        ArgumentNullException.ThrowIfNull(data);
+        return Derive(ValueBuilder.From(data), takeOwnership: true);
+    }
+
     public static Context From<T>(T data)
     {
         ArgumentNullException.ThrowIfNull(data);
 
-        return new Context(ValueBuilder.From(data));
+        // The value tree is private to this call, so move it into the context rather than copying it.
+        return new Context(ValueBuilder.From(data), takeOwnership: true);
+    }
+
+    /// <summary>
+    /// Creates a context that reads the top-level properties (or dictionary entries) of <paramref name="data"/>
+    /// only when a template first uses them, so properties a template ignores are never marshalled.
+    /// </summary>
+    /// <remarks>
+    /// A property is converted in full the first time it is read and cached for the rest of the context's
+    /// lifetime; later changes to <paramref name="data"/> are not seen. Properties that throw count as missing.
+    /// The context asks for properties while it is rendered, so it must not be rendered on several threads at
+    /// once, directly or as the base of derived contexts.
+    /// </remarks>
+    /// <param name="data">A POCO or a dictionary with string keys.</param>
+    /// <exception cref="ArgumentNullException">If data is null.</exception>
+    /// <exception cref="MinjaException">If context creation fails in the native layer.</exception>
+    public static Context FromLazy<T>(T data) where T : class
+    {
+        ArgumentNullException.ThrowIfNull(data);
+        return new Context(LazyValue.CreateContext(data));
+    }
+
+    /// <summary>
+    /// Sets the variable, object member or array element at <paramref name="path"/> in place. Paths are dotted:
+    /// the first segment names a variable, later segments are object keys or array indices
+    /// (<c>"messages.3.content"</c>). <paramref name="value"/> is moved into the context and disposed.
+    /// </summary>
+    /// <remarks>
+    /// Edits reach only the variables this context defines itself; paths into a base context of
+    /// <see cref="Derive(Value, bool)"/> are rejected. A context must not be edited while it is rendered or
+    /// used as a base. A context created from a root without taking ownership shares that root's members, so
+    /// edits also show through the root.
+    /// </remarks>
+    /// <exception cref="ObjectDisposedException">If this context or value is disposed.</exception>
+    /// <exception cref="ArgumentNullException">If path or value is null.</exception>
+    /// <exception cref="ArgumentException">If the path is malformed or does not exist.</exception>
+    public void SetPath(string path, Value value)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, this);
+        ArgumentNullException.ThrowIfNull(path);
+        ArgumentNullException.ThrowIfNull(value);
+        if (value.Handle == IntPtr.Zero) throw new ObjectDisposedException(nameof(Value));
+
+        var result = Native.mj_context_set_path(Handle, path, value.Handle);
+        Native.CheckResult(result, $"Setting context path '{path}'");
+        value.MarkConsumed();
+    }
+
+    /// <summary>
+    /// Appends <paramref name="value"/> to the array at <paramref name="path"/> in place, so a long-lived context
+    /// (an agent loop's <c>messages</c>) grows by one item without being rebuilt. The value is moved into the
+    /// context and disposed. Paths are resolved as in <see cref="SetPath"/>.
+    /// </summary>
+    /// <exception cref="ObjectDisposedException">If this context or value is disposed.</exception>
+    /// <exception cref="ArgumentNullException">If path or value is null.</exception>
+    /// <exception cref="ArgumentException">If the path is malformed, does not exist or is not an array.</exception>
+    public void Append(string path, Value value)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, this);
+        ArgumentNullException.ThrowIfNull(path);
+        ArgumentNullException.ThrowIfNull(value);
+        if (value.Handle == IntPtr.Zero) throw new ObjectDisposedException(nameof(Value));
+
+        var result = Native.mj_context_append(Handle, path, value.Handle);
+        Native.CheckResult(result, $"Appending to context path '{path}'");
+        value.MarkConsumed();
+    }
+
+    /// <summary>
+    /// Converts <paramref name="item"/> like <see cref="From{T}"/> and appends it to the array at <paramref name="path"/>.
+    /// </summary>
+    public void Append<T>(string path, T item)
+    {
+        ArgumentNullException.ThrowIfNull(path);
+        var value = ValueBuilder.From(item);
+        try
+        {
+            Append(path, value);
+        }
+        catch
+        {
+            value.Dispose();
+            throw;
+        }
+    }
+
+    /// <summary>
+    /// Removes the variable, object member or array element at <paramref name="path"/>. Paths are resolved as in
+    /// <see cref="SetPath"/>.
+    /// </summary>
+    /// <exception cref="ObjectDisposedException">If this context is disposed.</exception>
+    /// <exception cref="ArgumentNullException">If path is null.</exception>
+    /// <exception cref="ArgumentException">If the path is malformed or does not exist.</exception>
+    public void RemovePath(string path)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, this);
+        ArgumentNullException.ThrowIfNull(path);
+
+        var result = Native.mj_context_remove_path(Handle, path);
+        Native.CheckResult(result, $"Removing context path '{path}'");
     }
 
     /// <summary>
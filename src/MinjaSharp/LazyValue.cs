@@ -0,0 +1,70 @@
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace MinjaSharp;
+
+/// <summary>
+/// Serves the top-level variables of a lazy context from a POCO or dictionary, building each one only
+/// when the native layer asks for it. Names resolve as in <see cref="ValueBuilder"/>.
+/// </summary>
+internal sealed class LazyValue
+{
+    private static readonly unsafe Native.MjLazyVtable s_vtable = new()
+    {
+        Get = &OnGet,
+        Release = &OnRelease,
+    };
+
+    private readonly object _source;
+
+    private LazyValue(object source)
+    {
+        _source = source;
+    }
+
+    /// <summary>
+    /// Creates the native context handle. The context keeps the adapter alive until it is freed.
+    /// </summary>
+    internal static IntPtr CreateContext(object source)
+    {
+        var handle = GCHandle.Alloc(new LazyValue(source));
+        var result = Native.mj_context_make_lazy(s_vtable, GCHandle.ToIntPtr(handle), out var contextHandle);
+        if (result != Native.MjOk)
+        {
+            // The context did not take ownership, so the handle is still ours to free.
+            handle.Free();
+            Native.CheckResult(result, "Creating lazy context");
+        }
+        return contextHandle;
+    }
+
+    [UnmanagedCallersOnly(CallConvs = [typeof(CallConvCdecl)])]
+    private static unsafe int OnGet(IntPtr userData, byte* key, nuint keyLength, IntPtr* outValueHandle)
+    {
+        *outValueHandle = IntPtr.Zero;
+        try
+        {
+            var lazy = (LazyValue)GCHandle.FromIntPtr(userData).Target!;
+            var name = Encoding.UTF8.GetString(key, checked((int)keyLength));
+            if (!ValueBuilder.TryGetMember(lazy._source, name, out var member))
+            {
+                return Native.MjOk;
+            }
+
+            // The native context takes the handle over and frees it.
+            var value = ValueBuilder.From(member);
+            *outValueHandle = value.Handle;
+            value.MarkConsumed();
+            return Native.MjOk;
+        }
+        catch
+        {
+            // Exceptions can't cross the native frame; the render that asked for the variable fails instead.
+            return Native.MjError;
+        }
+    }
+
+    [UnmanagedCallersOnly(CallConvs = [typeof(CallConvCdecl)])]
+    private static void OnRelease(IntPtr userData) => GCHandle.FromIntPtr(userData).Free();
+}
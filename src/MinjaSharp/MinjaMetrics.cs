@@ -0,0 +1,222 @@
+using System.Diagnostics.Metrics;
+
+namespace MinjaSharp;
+
+/// <summary>
+/// A latency distribution collected by the native layer. Bucket <c>i</c> counts durations in
+/// [2<sup>i</sup>, 2<sup>i+1</sup>) nanoseconds; bucket 0 also counts 0 ns and the last bucket is open-ended.
+/// </summary>
+public sealed class LatencyHistogram
+{
+    private readonly ulong[] _buckets;
+
+    internal unsafe LatencyHistogram(in Native.MjLatencyHistogram native)
+    {
+        Count = native.Count;
+        TotalNanoseconds = native.TotalNs;
+        _buckets = new ulong[Native.MjStatsLatencyBuckets];
+        fixed (ulong* buckets = native.Buckets)
+        {
+            new ReadOnlySpan<ulong>(buckets, _buckets.Length).CopyTo(_buckets);
+        }
+    }
+
+    /// <summary>Number of recorded operations.</summary>
+    public ulong Count { get; }
+
+    /// <summary>Sum of the recorded durations in nanoseconds.</summary>
+    public ulong TotalNanoseconds { get; }
+
+    /// <summary>Operations per bucket.</summary>
+    public IReadOnlyList<ulong> Buckets => _buckets;
+
+    /// <summary>
+    /// Exclusive upper bound of a bucket in nanoseconds, or <see cref="ulong.MaxValue"/> for the last bucket.
+    /// </summary>
+    public static ulong GetBucketUpperBound(int bucket)
+    {
+        ArgumentOutOfRangeException.ThrowIfNegative(bucket);
+        ArgumentOutOfRangeException.ThrowIfGreaterThanOrEqual(bucket, Native.MjStatsLatencyBuckets);
+        return bucket == Native.MjStatsLatencyBuckets - 1 ? ulong.MaxValue : 1UL << (bucket + 1);
+    }
+
+    /// <summary>
+    /// Estimates a percentile as the upper bound of the bucket it falls in, so the estimate is within a factor of two.
+    /// Returns <see cref="TimeSpan.Zero"/> when nothing was recorded.
+    /// </summary>
+    /// <param name="percentile">A value between 0 and 100.</param>
+    public TimeSpan GetPercentile(double percentile)
+    {
+        ArgumentOutOfRangeException.ThrowIfNegative(percentile);
+        ArgumentOutOfRangeException.ThrowIfGreaterThan(percentile, 100);
+        if (Count == 0)
+        {
+            return TimeSpan.Zero;
+        }
+
+        var rank = Math.Max(1, (ulong)Math.Ceiling(Count * percentile / 100));
+        ulong seen = 0;
+        for (var i = 0; i < _buckets.Length; i++)
+        {
+            seen += _buckets[i];
+            if (seen >= rank)
+            {
+                var bound = GetBucketUpperBound(i);
+                return bound == ulong.MaxValue ? TimeSpan.MaxValue : TimeSpan.FromTicks((long)(bound / 100));
+            }
+        }
+        return TimeSpan.MaxValue;
+    }
+}
+
+/// <summary>
+/// Render counters, process-wide or for one template.
+/// </summary>
+/// <param name="Renders">Renders started, including failed ones. Each batch item and chat session render counts once.</param>
+/// <param name="Errors">Renders that failed.</param>
+/// <param name="OutputBytes">UTF-8 bytes produced by successful renders.</param>
+/// <param name="Time">Distribution of render durations.</param>
+public readonly record struct RenderStatistics(ulong Renders, ulong Errors, ulong OutputBytes, LatencyHistogram Time)
+{
+    internal RenderStatistics(in Native.MjRenderStats native)
+        : this(native.Renders, native.Errors, native.OutputBytes, new LatencyHistogram(native.Time))
+    {
+    }
+}
+
+/// <summary>
+/// Statistics of one parsed template. Templates returned by <see cref="Template.FromCache"/> for the same source share them.
+/// </summary>
+/// <param name="Render">Renders of this template.</param>
+/// <param name="ParseTime">How long parsing took, or zero if collection was off at the time.</param>
+public readonly record struct TemplateStatistics(RenderStatistics Render, TimeSpan ParseTime);
+
+/// <summary>
+/// Process-wide statistics of the native layer.
+/// </summary>
+/// <param name="Enabled">Whether collection is currently on.</param>
+/// <param name="Render">Renders of all templates.</param>
+/// <param name="Parses">Template parses, including failed ones and template cache misses.</param>
+/// <param name="ParseErrors">Parses that failed.</param>
+/// <param name="ParseTime">Distribution of parse durations.</param>
+/// <param name="ErrorsByCode">Native calls that failed, indexed by native error code; index 0 counts unknown codes.</param>
+/// <param name="LiveValues">Heap-owned values created while collection was on and not yet disposed.</param>
+/// <param name="LiveContexts">Heap-owned contexts created while collection was on and not yet disposed.</param>
+/// <param name="LiveTemplates">Templates not yet disposed.</param>
+public sealed record MinjaStatistics(
+    bool Enabled,
+    RenderStatistics Render,
+    ulong Parses,
+    ulong ParseErrors,
+    LatencyHistogram ParseTime,
+    IReadOnlyList<ulong> ErrorsByCode,
+    long LiveValues,
+    long LiveContexts,
+    long LiveTemplates);
+
+/// <summary>
+/// Switches native statistics collection on and off, reads it, and publishes it through the
+/// <see cref="MeterName"/> meter of <c>System.Diagnostics.Metrics</c>.
+/// </summary>
+/// <remarks>
+/// Collection is off by default and costs one branch per native call while off. The instruments are observable:
+/// they read the native counters only when a listener collects.
+/// </remarks>
+public static class MinjaMetrics
+{
+    /// <summary>Name of the meter that publishes the native statistics.</summary>
+    public const string MeterName = "MinjaSharp";
+
+    private static readonly Meter s_meter = new(MeterName);
+
+    // An explicit static constructor creates the instruments as soon as the type is used, not lazily on first field access.
+    static MinjaMetrics()
+    {
+        s_meter.CreateObservableCounter("minja.render.count", () => (long)Snapshot().Render.Renders, description: "Template renders");
+        s_meter.CreateObservableCounter("minja.render.errors", () => (long)Snapshot().Render.Errors, description: "Template renders that failed");
+        s_meter.CreateObservableCounter("minja.render.output", () => (long)Snapshot().Render.OutputBytes, unit: "By", description: "Bytes rendered");
+        s_meter.CreateObservableCounter("minja.render.duration", () => Seconds(Snapshot().Render.Time), unit: "s", description: "Total time spent rendering");
+        s_meter.CreateObservableCounter("minja.render.duration.bucket", () => BucketMeasurements(Snapshot().Render.Time),
+            description: "Renders per latency bucket; the le tag is the bucket's upper bound in seconds");
+        s_meter.CreateObservableCounter("minja.parse.count", () => (long)Snapshot().Parses, description: "Template parses");
+        s_meter.CreateObservableCounter("minja.parse.errors", () => (long)Snapshot().ParseErrors, description: "Template parses that failed");
+        s_meter.CreateObservableCounter("minja.parse.duration", () => Seconds(Snapshot().ParseTime), unit: "s", description: "Total time spent parsing");
+        s_meter.CreateObservableCounter("minja.errors", ErrorMeasurements, description: "Native calls that failed, by error code");
+        s_meter.CreateObservableUpDownCounter("minja.handles.live", HandleMeasurements, description: "Native handles not yet released");
+    }
+
+    /// <summary>
+    /// Gets or sets whether the native layer collects statistics.
+    /// </summary>
+    public static bool Enabled
+    {
+        get => Native.mj_stats_enabled() != 0;
+        set => Native.mj_stats_set_enabled(value ? 1 : 0);
+    }
+
+    /// <summary>
+    /// Reads the process-wide statistics.
+    /// </summary>
+    public static MinjaStatistics GetStatistics() => Snapshot();
+
+    /// <summary>
+    /// Zeroes the process-wide counters and histograms. Live handle counts and per-template statistics are kept.
+    /// </summary>
+    public static void Reset() => Native.mj_reset_stats();
+
+    private static unsafe MinjaStatistics Snapshot()
+    {
+        var result = Native.mj_get_stats(out var stats);
+        Native.CheckResult(result, "Reading statistics");
+
+        var errors = new ulong[Native.MjStatsErrorCodes];
+        new ReadOnlySpan<ulong>(stats.ErrorsByCode, errors.Length).CopyTo(errors);
+
+        return new MinjaStatistics(
+            stats.Enabled != 0,
+            new RenderStatistics(stats.Render),
+            stats.Parses,
+            stats.ParseErrors,
+            new LatencyHistogram(stats.ParseTime),
+            errors,
+            stats.LiveValues,
+            stats.LiveContexts,
+            stats.LiveTemplates);
+    }
+
+    private static double Seconds(LatencyHistogram histogram) => histogram.TotalNanoseconds / 1e9;
+
+    private static IEnumerable<Measurement<long>> BucketMeasurements(LatencyHistogram histogram)
+    {
+        for (var i = 0; i < histogram.Buckets.Count; i++)
+        {
+            if (histogram.Buckets[i] == 0)
+            {
+                continue;
+            }
+            var bound = LatencyHistogram.GetBucketUpperBound(i);
+            var le = bound == ulong.MaxValue ? "+Inf" : (bound / 1e9).ToString("R", System.Globalization.CultureInfo.InvariantCulture);
+            yield return new Measurement<long>((long)histogram.Buckets[i], new KeyValuePair<string, object?>("le", le));
+        }
+    }
+
+    private static IEnumerable<Measurement<long>> ErrorMeasurements()
+    {
+        var errors = Snapshot().ErrorsByCode;
+        for (var code = 0; code < errors.Count; code++)
+        {
+            if (errors[code] != 0)
+            {
+                yield return new Measurement<long>((long)errors[code], new KeyValuePair<string, object?>("code", code));
+            }
+        }
+    }
+
+    private static IEnumerable<Measurement<long>> HandleMeasurements()
+    {
+        var stats = Snapshot();
+        yield return new Measurement<long>(stats.LiveValues, new KeyValuePair<string, object?>("kind", "value"));
+        yield return new Measurement<long>(stats.LiveContexts, new KeyValuePair<string, object?>("kind", "context"));
+        yield return new Measurement<long>(stats.LiveTemplates, new KeyValuePair<string, object?>("kind", "template"));
+    }
+}
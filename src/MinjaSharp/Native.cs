@@ -32,29 +32,31 @@ internal static partial class Native
 
         var fullMessage = $"{operationName} failed. Code: {resultCode}. Details: {errorMessage}";
 
-        switch (resultCode)
+        throw CreateException(resultCode, fullMessage);
+    }
+
+    // Maps a native error code to the exception type the managed API throws for it.
+    internal static Exception CreateException(int resultCode, string fullMessage)
+    {
+        return resultCode switch
         {
-            case MjErrorInvalidArgument:
-                throw new ArgumentException(fullMessage);
-            case MjErrorAllocationFailed:
-                throw new MinjaAllocationException(fullMessage, resultCode);
-            case MjErrorJsonParse:
-                throw new MinjaJsonException(fullMessage, resultCode);
-            case MjErrorTemplateRender:
-                throw new MinjaRenderException(fullMessage, resultCode);
-            case MjErrorTemplateParse:
-                throw new MinjaParseException(fullMessage, resultCode);
-            case MjErrorOperationFailed:
-                throw new MinjaOperationException(fullMessage, resultCode);
-            default: // MJ_ERROR or any other code
-                throw new MinjaException(fullMessage, resultCode);
-        }
+            MjErrorInvalidArgument => new ArgumentException(fullMessage),
+            MjErrorAllocationFailed => new MinjaAllocationException(fullMessage, resultCode),
+            MjErrorJsonParse => new MinjaJsonException(fullMessage, resultCode),
+            MjErrorTemplateRender => new MinjaRenderException(fullMessage, resultCode),
+            MjErrorTemplateParse => new MinjaParseException(fullMessage, resultCode),
+            MjErrorOperationFailed or MjErrorSinkAborted or MjErrorBufferFormat => new MinjaOperationException(fullMessage, resultCode),
+            MjErrorUnsupported => new NotSupportedException(fullMessage),
+            MjErrorCancelled => new OperationCanceledException(fullMessage),
+            MjErrorDeadlineExceeded => new TimeoutException(fullMessage),
+            _ => new MinjaException(fullMessage, resultCode), // MJ_ERROR or any other code
+        };
     }
         
     private const string DllName = "minja_shim_ext"; // Renamed for clarity, Dll is a bit generic
 
     // --- Error Code Definitions (mirroring C++ header) ---
-    private const int MjOk = 0;
+    public const int MjOk = 0;
     public const int MjError = 1;
     private const int MjErrorInvalidArgument = 2;
     private const int MjErrorAllocationFailed = 3;
@@ -62,6 +64,12 @@ internal static partial class Native
     private const int MjErrorTemplateRender = 5;
     private const int MjErrorOperationFailed = 6;
     private const int MjErrorTemplateParse = 7;
+    public const int MjErrorBufferTooSmall = 8;
+    public const int MjErrorSinkAborted = 9;
+    private const int MjErrorBufferFormat = 10;
+    private const int MjErrorUnsupported = 11;
+    public const int MjErrorCancelled = 12;
+    private const int MjErrorDeadlineExceeded = 13;
     
     // --- Error Handling ---
     // Retrieves the last error message.
@@ -83,6 +91,93 @@ internal static partial class Native
     [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
     public static partial void mj_free_template(IntPtr templateHandle);
 
+    // --- Template cache ---
+    // Returns a handle to the shared parsed template for this UTF-8 source, parsing it on a miss.
+    // The handle is freed with mj_free_template like any other.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static unsafe partial int mj_parse_cached(byte* tmplStr, nuint length, out IntPtr outTemplateHandle);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial void mj_template_cache_set_budget(nuint bytes);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial void mj_template_cache_clear();
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_template_cache_get_stats(out MjTemplateCacheStats outStats);
+
+    // --- Result cache ---
+    // Off until given a budget; 0 turns it off again.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial void mj_result_cache_set_budget(nuint bytes);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial void mj_result_cache_clear();
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_result_cache_get_stats(out MjTemplateCacheStats outStats);
+
+    // Renders against a root value, returning the cached output for an equal value when there is one.
+    // Output is retained like mj_render_ctx_retained.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_render_cached(IntPtr templateHandle, IntPtr rootValueHandle, out IntPtr outData, out nuint outLength);
+
+    // --- Renderers ---
+    // A renderer keeps its output buffer between renders; it must be used by one thread at a time.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_renderer_create(out IntPtr outRendererHandle);
+
+    // The output is owned by the renderer and stays valid until its next render.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_renderer_render(IntPtr rendererHandle, IntPtr templateHandle, IntPtr contextHandle, out IntPtr outData, out nuint outLength);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial void mj_free_renderer(IntPtr rendererHandle);
+
+    // --- Span render ---
+    // Renders and reports where each element of a top-level array starts and ends in the output.
+    // Output and spans are owned by the calling thread like mj_render_ctx_retained.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static unsafe partial int mj_render_ctx_spans(IntPtr templateHandle, IntPtr contextHandle, [MarshalAs(UnmanagedType.LPUTF8Str)] string arrayName,
+        out IntPtr outData, out nuint outLength, out MjSpan* outSpans, out nuint outSpanCount, out MjSpan outTail);
+
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct MjSpan
+    {
+        public nuint Begin;
+        public nuint End;
+    }
+
+    // --- Template analysis ---
+    // Lists what a template may read from its context as JSON. The string must be freed using mj_free_string.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_template_analyze(IntPtr templateHandle, out IntPtr outJson);
+
+    // Mirrors mj_template_cache_stats, and mj_result_cache_stats, which has the same layout.
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct MjTemplateCacheStats
+    {
+        public ulong Hits;
+        public ulong Misses;
+        public ulong Evictions;
+        public ulong Entries;
+        public ulong Bytes;
+        public ulong Budget;
+    }
+
     // --- Render by JSON ---
     // Renders a template using a JSON string as context.
     // On success, returns MJ_OK and sets out_rendered_string.
@@ -96,6 +191,16 @@ internal static partial class Native
     [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
     public static partial void mj_free_string(IntPtr s);
 
+    // Renders with length-delimited UTF-8 JSON as context; output is retained like mj_render_ctx_retained.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static unsafe partial int mj_render_json_retained(IntPtr templateHandle, byte* jsonUtf8, nuint length, out IntPtr outData, out nuint outLength);
+
+    // Builds a value from length-delimited UTF-8 JSON.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static unsafe partial int mj_value_from_json(byte* jsonUtf8, nuint length, out IntPtr outValueHandle);
+
     // --- Value APIs ---
     // All value constructors return MJ_OK on success and set out_value_handle.
     // On failure, they return an error code and out_value_handle will be IntPtr.Zero.
@@ -139,6 +244,78 @@ internal static partial class Native
     [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
     public static partial int mj_object_set(IntPtr objectHandle, [MarshalAs(UnmanagedType.LPUTF8Str)] string key, IntPtr valueHandle);
 
+    // --- Consuming (move) variants ---
+    // Move the child (or root) into its new owner and free the passed handle on success.
+    // On failure the caller keeps ownership of the handle.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_array_push_take(IntPtr arrayHandle, IntPtr valueHandle);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_object_set_take(IntPtr objectHandle, [MarshalAs(UnmanagedType.LPUTF8Str)] string key, IntPtr valueHandle);
+
+    // Interns an object key process-wide; ids stay valid until the process exits.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static unsafe partial int mj_intern_key(byte* key, nuint keyLength, out uint outKeyId);
+
+    // Like mj_object_set and mj_object_set_take, keyed by an id from mj_intern_key.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_object_set_key(IntPtr objectHandle, uint keyId, IntPtr valueHandle);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_object_set_key_take(IntPtr objectHandle, uint keyId, IntPtr valueHandle);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_context_make_take(IntPtr rootValueHandle, out IntPtr outContextHandle);
+
+    // Layers an overlay object over a shared base context; lookups fall through to the base.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_context_derive(IntPtr baseContextHandle, IntPtr overlayValueHandle, out IntPtr outContextHandle);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_context_derive_take(IntPtr baseContextHandle, IntPtr overlayValueHandle, out IntPtr outContextHandle);
+
+    // In-place edits of a context's own variables by dotted path. Values are moved in; the value handle
+    // is freed on success and still owned by the caller on failure.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_context_set_path(IntPtr contextHandle, [MarshalAs(UnmanagedType.LPUTF8Str)] string path, IntPtr valueHandle);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_context_append(IntPtr contextHandle, [MarshalAs(UnmanagedType.LPUTF8Str)] string path, IntPtr valueHandle);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_context_remove_path(IntPtr contextHandle, [MarshalAs(UnmanagedType.LPUTF8Str)] string path);
+
+    // Creates a context that asks the host for each top-level variable the first time a template reads it.
+    // On success the context owns userData and hands it to vtable.Release when it is destroyed.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_context_make_lazy(in MjLazyVtable vtable, IntPtr userData, out IntPtr outContextHandle);
+
+    [StructLayout(LayoutKind.Sequential)]
+    internal unsafe struct MjLazyVtable
+    {
+        public delegate* unmanaged[Cdecl]<IntPtr, byte*, nuint, IntPtr*, int> Get;
+        public delegate* unmanaged[Cdecl]<IntPtr, void> Release;
+    }
+
+    // --- Binary value trees ---
+    // Decodes a complete value tree from one buffer (see ValueBufferWriter for the encoder).
+    // On success, returns MJ_OK and sets out_value_handle; MJ_ERROR_BUFFER_FORMAT for malformed input.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static unsafe partial int mj_value_from_buffer(byte* data, nuint length, out IntPtr outValueHandle);
+
     // --- Context from a Value, and free it ---
     // Creates a rendering context from a root value.
     // On success, returns MJ_OK and sets out_context_handle.
@@ -160,8 +337,180 @@ internal static partial class Native
     [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
     public static partial int mj_render_ctx(IntPtr templateHandle, IntPtr contextHandle, out IntPtr outRenderedString);
 
+    // --- Render into caller-owned or retained memory ---
+    // Renders directly into the supplied buffer (not NUL-terminated).
+    // Returns MJ_ERROR_BUFFER_TOO_SMALL with outLength set to the required size if the buffer is too small.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static unsafe partial int mj_render_ctx_into(IntPtr templateHandle, IntPtr contextHandle, byte* buffer, nuint bufferSize, out nuint outLength);
+
+    // Renders into a native buffer owned by the calling thread.
+    // The data must not be freed and is only valid until the next mj_render_ctx_retained call on the same thread.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_render_ctx_retained(IntPtr templateHandle, IntPtr contextHandle, out IntPtr outData, out nuint outLength);
+
+    // --- Streaming render ---
+    // Hands rendered output to sinkFn in chunks of about flushThreshold bytes (0 selects a default).
+    // The callback returns 0 to continue or non-zero to abort, which makes the call return MJ_ERROR_SINK_ABORTED.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static unsafe partial int mj_render_stream(IntPtr templateHandle, IntPtr contextHandle,
+        delegate* unmanaged[Cdecl]<byte*, nuint, IntPtr, int> sinkFn, IntPtr userData, nuint flushThreshold);
+
+    // --- Batch render ---
+    // Renders one template against many contexts on the native thread pool. Per-item failures are
+    // reported through the result's codes and mj_batch_error; the batch must be freed with mj_free_batch.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static unsafe partial int mj_render_batch(IntPtr templateHandle, IntPtr* contextHandles, nuint count,
+        in MjBatchOptions options, out IntPtr outBatchHandle, out MjBatchResult outResult);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial IntPtr mj_batch_error(IntPtr batchHandle, nuint index);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial void mj_free_batch(IntPtr batchHandle);
+
+    // --- Asynchronous render ---
+    // Queues a render on the native executor; completionFn runs exactly once, on an executor thread, when
+    // the call returns MJ_OK. timeoutNs is a budget from the call (0 for none). The cancel token must be
+    // freed with mj_free_cancel_token.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static unsafe partial int mj_render_async(IntPtr templateHandle, IntPtr contextHandle,
+        delegate* unmanaged[Cdecl]<int, byte*, nuint, byte*, IntPtr, void> completionFn, IntPtr userData,
+        ulong timeoutNs, out IntPtr outCancelToken);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial void mj_cancel(IntPtr cancelToken);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial void mj_free_cancel_token(IntPtr cancelToken);
+
+    // Mirrors mj_batch_options.
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct MjBatchOptions
+    {
+        public nuint ThreadCount;
+    }
+
+    // Mirrors mj_batch_result.
+    [StructLayout(LayoutKind.Sequential)]
+    internal unsafe struct MjBatchResult
+    {
+        public byte* Data;
+        public nuint DataLength;
+        public nuint* Offsets;
+        public int* Codes;
+        public nuint Failed;
+    }
+
+    // --- Chat sessions ---
+    // Keeps a context and its last output; appended messages are rendered incrementally when the template allows it.
+    // The _take functions move the value into the session and free its handle on success.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_chat_session_create(IntPtr templateHandle, IntPtr rootValueHandle, out IntPtr outSessionHandle);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_chat_session_append_take(IntPtr sessionHandle, IntPtr valueHandle);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_chat_session_set_take(IntPtr sessionHandle, [MarshalAs(UnmanagedType.LPUTF8Str)] string key, IntPtr valueHandle);
+
+    // The output is owned by the session and valid until the next call on it.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_chat_session_render(IntPtr sessionHandle, out IntPtr outData, out nuint outLength);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_chat_session_is_incremental(IntPtr sessionHandle);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial void mj_free_chat_session(IntPtr sessionHandle);
+
     // --- Value memory management ---
     [LibraryImport(DllName)]
     [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
     public static partial void mj_free_value(IntPtr valueHandle);
+
+    // --- Statistics ---
+    internal const int MjStatsLatencyBuckets = 40;
+    internal const int MjStatsErrorCodes = 16;
+
+    // Mirrors mj_latency_histogram.
+    [StructLayout(LayoutKind.Sequential)]
+    internal unsafe struct MjLatencyHistogram
+    {
+        public ulong Count;
+        public ulong TotalNs;
+        public fixed ulong Buckets[MjStatsLatencyBuckets];
+    }
+
+    // Mirrors mj_render_stats.
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct MjRenderStats
+    {
+        public ulong Renders;
+        public ulong Errors;
+        public ulong OutputBytes;
+        public MjLatencyHistogram Time;
+    }
+
+    // Mirrors mj_stats.
+    [StructLayout(LayoutKind.Sequential)]
+    internal unsafe struct MjStats
+    {
+        public int Enabled;
+        public MjRenderStats Render;
+        public ulong Parses;
+        public ulong ParseErrors;
+        public MjLatencyHistogram ParseTime;
+        public fixed ulong ErrorsByCode[MjStatsErrorCodes];
+        public long LiveValues;
+        public long LiveContexts;
+        public long LiveTemplates;
+    }
+
+    // Mirrors mj_template_stats.
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct MjTemplateStats
+    {
+        public MjRenderStats Render;
+        public ulong ParseNs;
+    }
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial void mj_stats_set_enabled(int enabled);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_stats_enabled();
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_get_stats(out MjStats outStats);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial int mj_get_template_stats(IntPtr templateHandle, out MjTemplateStats outStats);
+
+    // Zeroes the process-wide counters; live handle gauges are kept.
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial void mj_reset_stats();
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(System.Runtime.CompilerServices.CallConvCdecl)])]
+    public static partial void mj_reset_template_stats(IntPtr templateHandle);
 }
\ No newline at end of file
@@ -0,0 +1,14 @@
+namespace MinjaSharp;
+
+/// <summary>
+/// The outcome of rendering one item of <see cref="Template.RenderMany"/>.
+/// </summary>
+/// <param name="Output">The rendered text, or <c>null</c> if the item failed.</param>
+/// <param name="Error">The failure, or <c>null</c> if the item rendered successfully.</param>
+public readonly record struct RenderResult(string? Output, Exception? Error)
+{
+    /// <summary>
+    /// True when the item rendered successfully.
+    /// </summary>
+    public bool Succeeded => Error is null;
+}
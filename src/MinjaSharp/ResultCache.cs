@@ -0,0 +1,55 @@
+namespace MinjaSharp;
+
+/// <summary>
+/// Counters of the native result cache.
+/// </summary>
+/// <param name="Hits">Renders answered from the cache.</param>
+/// <param name="Misses">Renders that had to run the template.</param>
+/// <param name="Evictions">Outputs dropped to stay within the budget.</param>
+/// <param name="Entries">Outputs currently cached.</param>
+/// <param name="Bytes">Approximate memory charged to the cached outputs.</param>
+/// <param name="Budget">Byte budget of the cache.</param>
+public readonly record struct ResultCacheStatistics(
+    ulong Hits, ulong Misses, ulong Evictions, ulong Entries, ulong Bytes, ulong Budget)
+{
+    /// <summary>
+    /// Fraction of lookups that were hits, or 0 before the first lookup.
+    /// </summary>
+    public double HitRate => Hits + Misses == 0 ? 0 : (double)Hits / (Hits + Misses);
+}
+
+/// <summary>
+/// Controls the process-wide native cache used by <see cref="Template.RenderCached(Value)"/>, which returns the
+/// previous output when a template renders a value equal to one it has rendered before.
+/// </summary>
+/// <remarks>
+/// The cache is off until it is given a budget. Values are matched by a 128-bit structural hash that the
+/// native layer keeps up to date while values are built, so a lookup costs little more than building the value.
+/// </remarks>
+public static class ResultCache
+{
+    /// <summary>
+    /// Sets the approximate number of bytes the cache may hold. Least recently used outputs are evicted to fit.
+    /// A budget of 0 turns the cache off and drops its entries.
+    /// </summary>
+    public static void SetBudget(long bytes)
+    {
+        ArgumentOutOfRangeException.ThrowIfNegative(bytes);
+        Native.mj_result_cache_set_budget((nuint)bytes);
+    }
+
+    /// <summary>
+    /// Drops every cached output. Counters are kept.
+    /// </summary>
+    public static void Clear() => Native.mj_result_cache_clear();
+
+    /// <summary>
+    /// Reads the cache counters.
+    /// </summary>
+    public static ResultCacheStatistics GetStatistics()
+    {
+        var result = Native.mj_result_cache_get_stats(out var stats);
+        Native.CheckResult(result, "Reading result cache statistics");
+        return new ResultCacheStatistics(stats.Hits, stats.Misses, stats.Evictions, stats.Entries, stats.Bytes, stats.Budget);
+    }
+}
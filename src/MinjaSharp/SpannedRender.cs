@@ -0,0 +1,16 @@
+namespace MinjaSharp;
+
+/// <summary>
+/// The outcome of <see cref="Template.RenderWithSpans"/>: the rendered text and where each element of the chosen
+/// array was rendered in it.
+/// </summary>
+/// <param name="Output">The rendered text.</param>
+/// <param name="Elements">One range of <paramref name="Output"/> per array element, in order. Consecutive ranges are adjacent.</param>
+/// <param name="Tail">The text after the last element; for chat templates, the generation prompt.</param>
+public sealed record SpannedRender(string Output, IReadOnlyList<Range> Elements, Range Tail)
+{
+    /// <summary>
+    /// The text before the first element, such as a system prompt or tool definitions.
+    /// </summary>
+    public Range Header => ..(Elements.Count > 0 ? Elements[0].Start : Tail.Start);
+}
@@ -1,4 +1,9 @@
+using System.Buffers;
+using System.Collections.Concurrent;
+using System.Runtime.CompilerServices;
+using System.Runtime.ExceptionServices;
 using System.Runtime.InteropServices;
+using System.Text;
 
 namespace MinjaSharp;
 // Ensure MinjaRenderException and MinjaJsonException are defined as shown previously,
@@ -9,8 +14,9 @@ namespace MinjaSharp;
 /// </summary>
 public sealed class Template : IDisposable
 {
-    private IntPtr Handle { get; set; } // Make setter private
+    internal IntPtr Handle { get; private set; } // Make setter private
     private bool _disposed;
+    private TemplateAnalysis? _analysis;
 
     /// <summary>
     /// Creates a new Template instance by parsing the provided template string.
@@ -28,6 +34,48 @@ public sealed class Template : IDisposable
         Handle = templateHandle;
     }
 
+    private Template(IntPtr handle)
+    {
+        Handle = handle;
+    }
+
+    /// <summary>
+    /// Returns a template for the given source from the process-wide native cache, parsing it only
+    /// the first time the source is seen. Each returned instance must still be disposed; the parsed
+    /// tree is shared between them.
+    /// </summary>
+    /// <param name="tmpl">The template string to parse. Cannot be null.</param>
+    /// <exception cref="ArgumentNullException">If tmpl is null.</exception>
+    /// <exception cref="MinjaParseException">Thrown when template parsing fails in the native layer.</exception>
+    /// <exception cref="MinjaException">For other native errors during parsing.</exception>
+    public static unsafe Template FromCache(string tmpl)
+    {
+        ArgumentNullException.ThrowIfNull(tmpl);
+
+        var maxBytes = Encoding.UTF8.GetMaxByteCount(tmpl.Length);
+        byte[]? rented = null;
+        var buffer = maxBytes <= 1024 ? stackalloc byte[maxBytes] : (rented = ArrayPool<byte>.Shared.Rent(maxBytes));
+        try
+        {
+            var length = Encoding.UTF8.GetBytes(tmpl, buffer);
+            int result;
+            IntPtr handle;
+            fixed (byte* source = buffer)
+            {
+                result = Native.mj_parse_cached(source, (nuint)length, out handle);
+            }
+            Native.CheckResult(result, "Parsing template");
+            return new Template(handle);
+        }
+        finally
+        {
+            if (rented != null)
+            {
+                ArrayPool<byte>.Shared.Return(rented);
+            }
+        }
+    }
+
     /// <summary>
     /// Renders the template using the provided context.
     /// </summary>
@@ -58,28 +106,419 @@ public sealed class Template : IDisposable
         ArgumentNullException.ThrowIfNull(ctx);
         
         if (ctx.Handle == IntPtr.Zero) throw new ArgumentException("Context has an invalid (null) handle.", nameof(ctx));
-        var result = Native.mj_render_ctx(Handle, ctx.Handle, out var renderedStringPtr);
+
+        // The output lives in a per-thread native buffer that is reused across renders,
+        // so the only copy made here is the UTF-8 decode into the managed string.
+        var result = Native.mj_render_ctx_retained(Handle, ctx.Handle, out var data, out var length);
         Native.CheckResult(result, "Rendering template with context");
 
-        if (renderedStringPtr == IntPtr.Zero)
+        if (length == 0)
         {
-            // This case should ideally be caught by CheckResult if MJ_OK was returned but ptr is null.
-            // However, if MJ_OK is returned AND ptr is Zero, it's an empty string by convention.
-            // The C++ code aims to return MJ_ERROR_ALLOCATION_FAILED if create_c_string fails.
-            // If CheckResult didn't throw, and we get here with MJ_OK and Zero ptr, it means empty string.
             return string.Empty;
         }
 
-        string renderedString;
+        if (length > int.MaxValue)
+        {
+            throw new MinjaAllocationException("Rendered output is too large for a .NET string.", Native.MjError);
+        }
+
+        unsafe
+        {
+            return Encoding.UTF8.GetString((byte*)data, (int)length);
+        }
+    }
+
+    /// <summary>
+    /// Renders the template against <paramref name="root"/>, returning the output of an earlier render from
+    /// <see cref="ResultCache"/> when this template has already rendered an equal value. Renders exactly like
+    /// <see cref="Render(Context)"/> with a context made from <paramref name="root"/>, which is left unmodified.
+    /// </summary>
+    /// <param name="root">The root object. Cannot be null.</param>
+    /// <returns>The rendered template as a string.</returns>
+    /// <exception cref="ObjectDisposedException">If the template or root is disposed.</exception>
+    /// <exception cref="ArgumentNullException">If root is null.</exception>
+    /// <exception cref="MinjaRenderException">Thrown if template rendering fails in the native layer.</exception>
+    /// <exception cref="MinjaException">For other native errors during rendering.</exception>
+    public string RenderCached(Value root)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, typeof(Template));
+        ArgumentNullException.ThrowIfNull(root);
+        if (root.Handle == IntPtr.Zero) throw new ObjectDisposedException(nameof(Value));
+
+        var result = Native.mj_render_cached(Handle, root.Handle, out var data, out var length);
+        Native.CheckResult(result, "Rendering template through the result cache");
+
+        if (length == 0)
+        {
+            return string.Empty;
+        }
+
+        if (length > int.MaxValue)
+        {
+            throw new MinjaAllocationException("Rendered output is too large for a .NET string.", Native.MjError);
+        }
+
+        unsafe
+        {
+            return Encoding.UTF8.GetString((byte*)data, (int)length);
+        }
+    }
+
+    /// <summary>
+    /// Builds a value from <paramref name="data"/> like <see cref="Render{T}(T)"/> and renders it through
+    /// <see cref="ResultCache"/>; see <see cref="RenderCached(Value)"/>.
+    /// </summary>
+    /// <param name="data">The data containing values for the template. Cannot be null.</param>
+    /// <returns>The rendered template as a string.</returns>
+    /// <exception cref="ObjectDisposedException">If the template is disposed.</exception>
+    /// <exception cref="ArgumentNullException">If data is null.</exception>
+    /// <exception cref="MinjaRenderException">Thrown if template rendering fails in the native layer.</exception>
+    public string RenderCached<T>(T data)
+    {
+        ArgumentNullException.ThrowIfNull(data);
+        using var root = ValueBuilder.From(data);
+        return RenderCached(root);
+    }
+
+    /// <summary>
+    /// Renders the template on the native executor without blocking the calling thread. Cancelling
+    /// <paramref name="cancellationToken"/> stops the render from the native side, so a runaway template does
+    /// not keep a thread busy.
+    /// </summary>
+    /// <param name="ctx">The context containing values for the template. Cannot be null. It may be disposed once
+    /// the call returns, but must not be modified until the task completes.</param>
+    /// <param name="cancellationToken">Cancels the render.</param>
+    /// <exception cref="ObjectDisposedException">If the template is disposed.</exception>
+    /// <exception cref="ArgumentNullException">If ctx is null.</exception>
+    /// <remarks>The returned task faults with <see cref="MinjaRenderException"/> if rendering fails and is
+    /// cancelled when the token is. minja has no hook between its nodes; the render checks for cancellation
+    /// whenever it writes output or looks up a name, so a loop that does neither runs to completion.</remarks>
+    public Task<string> RenderAsync(Context ctx, CancellationToken cancellationToken = default) =>
+        RenderAsync(ctx, Timeout.InfiniteTimeSpan, cancellationToken);
+
+    /// <summary>
+    /// Renders the template on the native executor, giving up after <paramref name="timeout"/>.
+    /// </summary>
+    /// <param name="ctx">The context containing values for the template. Cannot be null.</param>
+    /// <param name="timeout">Time budget measured from this call, or <see cref="Timeout.InfiniteTimeSpan"/>.</param>
+    /// <param name="cancellationToken">Cancels the render.</param>
+    /// <exception cref="ObjectDisposedException">If the template is disposed.</exception>
+    /// <exception cref="ArgumentNullException">If ctx is null.</exception>
+    /// <exception cref="ArgumentOutOfRangeException">If timeout is negative and not infinite.</exception>
+    /// <remarks>A render that runs past its budget faults the task with <see cref="TimeoutException"/>.</remarks>
+    public Task<string> RenderAsync(Context ctx, TimeSpan timeout, CancellationToken cancellationToken = default)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, typeof(Template));
+        ArgumentNullException.ThrowIfNull(ctx);
+        if (timeout < TimeSpan.Zero && timeout != Timeout.InfiniteTimeSpan)
+        {
+            throw new ArgumentOutOfRangeException(nameof(timeout));
+        }
+
+        if (ctx.Handle == IntPtr.Zero) throw new ArgumentException("Context has an invalid (null) handle.", nameof(ctx));
+
+        if (cancellationToken.IsCancellationRequested)
+        {
+            return Task.FromCanceled<string>(cancellationToken);
+        }
+
+        return AsyncRender.Start(Handle, ctx.Handle, timeout, cancellationToken);
+    }
+
+    /// <summary>
+    /// Renders the template and reports where each element of a top-level array was rendered, so a caller can
+    /// compare prompts on element boundaries (for instance to reuse a model's KV cache for an unchanged prefix of
+    /// messages) without diffing the text.
+    /// </summary>
+    /// <remarks>
+    /// Only templates that render the array element by element are supported: one top-level loop over it that
+    /// does not read <c>loop</c>, carry state between iterations or mention the array elsewhere. The spans are
+    /// checked against the full render, so they are either exact or not returned. This costs about two renders.
+    /// </remarks>
+    /// <param name="ctx">The context to render with. Cannot be null.</param>
+    /// <param name="arrayName">The top-level array to report spans for.</param>
+    /// <exception cref="ObjectDisposedException">If the template is disposed.</exception>
+    /// <exception cref="ArgumentException">If <paramref name="arrayName"/> does not name an array.</exception>
+    /// <exception cref="NotSupportedException">If the template does not render the array element by element.</exception>
+    /// <exception cref="MinjaRenderException">Thrown if template rendering fails in the native layer.</exception>
+    public unsafe SpannedRender RenderWithSpans(Context ctx, string arrayName = "messages")
+    {
+        ObjectDisposedException.ThrowIf(_disposed, typeof(Template));
+        ArgumentNullException.ThrowIfNull(ctx);
+        ArgumentNullException.ThrowIfNull(arrayName);
+
+        if (ctx.Handle == IntPtr.Zero) throw new ArgumentException("Context has an invalid (null) handle.", nameof(ctx));
+
+        var result = Native.mj_render_ctx_spans(Handle, ctx.Handle, arrayName,
+            out var data, out var length, out var spans, out var spanCount, out var tail);
+        Native.CheckResult(result, "Rendering template with spans");
+
+        if (length > int.MaxValue)
+        {
+            throw new MinjaAllocationException("Rendered output is too large for a .NET string.", Native.MjError);
+        }
+
+        // Spans are UTF-8 byte offsets and fall on character boundaries; convert them to string indices
+        // by counting the characters of each byte range once.
+        var bytes = new ReadOnlySpan<byte>((byte*)data, (int)length);
+        var elements = new Range[(int)spanCount];
+        var headerEnd = elements.Length > 0 ? spans[0].Begin : tail.Begin;
+        var offset = Encoding.UTF8.GetCharCount(bytes[..(int)headerEnd]);
+        for (var i = 0; i < elements.Length; i++)
+        {
+            var start = offset;
+            offset += Encoding.UTF8.GetCharCount(bytes[(int)spans[i].Begin..(int)spans[i].End]);
+            elements[i] = start..offset;
+        }
+
+        var tailLength = Encoding.UTF8.GetCharCount(bytes[(int)tail.Begin..(int)tail.End]);
+        return new SpannedRender(Encoding.UTF8.GetString(bytes), elements, offset..(offset + tailLength));
+    }
+
+    /// <summary>
+    /// Renders the template against many contexts in parallel on the native thread pool.
+    /// A failing item does not stop the others; its error is reported in its result.
+    /// </summary>
+    /// <param name="contexts">The contexts to render. Each context may appear only once.</param>
+    /// <param name="threadCount">Threads to render on, the calling thread included; 0 uses one per hardware thread.</param>
+    /// <returns>One result per context, in the same order.</returns>
+    /// <exception cref="ObjectDisposedException">If the template is disposed.</exception>
+    /// <exception cref="ArgumentNullException">If contexts or any of its items is null.</exception>
+    /// <exception cref="MinjaException">If the batch could not be run at all.</exception>
+    public unsafe RenderResult[] RenderMany(IReadOnlyList<Context> contexts, int threadCount = 0)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, typeof(Template));
+        ArgumentNullException.ThrowIfNull(contexts);
+        ArgumentOutOfRangeException.ThrowIfNegative(threadCount);
+
+        var handles = new IntPtr[contexts.Count];
+        for (var i = 0; i < handles.Length; i++)
+        {
+            var ctx = contexts[i] ?? throw new ArgumentNullException(nameof(contexts), $"Context at index {i} is null.");
+            if (ctx.Handle == IntPtr.Zero) throw new ArgumentException($"Context at index {i} has an invalid (null) handle.", nameof(contexts));
+            handles[i] = ctx.Handle;
+        }
+
+        var options = new Native.MjBatchOptions { ThreadCount = (nuint)threadCount };
+        int result;
+        IntPtr batch;
+        Native.MjBatchResult view;
+        fixed (IntPtr* handlePtr = handles)
+        {
+            result = Native.mj_render_batch(Handle, handlePtr, (nuint)handles.Length, in options, out batch, out view);
+        }
+        GC.KeepAlive(contexts); // The contexts own the handles the native side just used
+        Native.CheckResult(result, "Rendering template batch");
+
         try
         {
-            renderedString = Marshal.PtrToStringUTF8(renderedStringPtr) ?? string.Empty;
+            var results = new RenderResult[handles.Length];
+            for (var i = 0; i < results.Length; i++)
+            {
+                var code = view.Codes[i];
+                if (code != Native.MjOk)
+                {
+                    var message = Marshal.PtrToStringUTF8(Native.mj_batch_error(batch, (nuint)i)) ?? "Unknown native error.";
+                    results[i] = new RenderResult(null, Native.CreateException(code, $"Rendering batch item {i} failed. Code: {code}. Details: {message}"));
+                    continue;
+                }
+
+                var start = view.Offsets[i];
+                var length = view.Offsets[i + 1] - start;
+                if (length > int.MaxValue)
+                {
+                    results[i] = new RenderResult(null, new MinjaAllocationException("Rendered output is too large for a .NET string.", Native.MjError));
+                    continue;
+                }
+                results[i] = new RenderResult(Encoding.UTF8.GetString(view.Data + start, (int)length), null);
+            }
+            return results;
         }
         finally
         {
-            Native.mj_free_string(renderedStringPtr);
+            Native.mj_free_batch(batch);
         }
-        return renderedString;
+    }
+
+    /// <summary>
+    /// Renders the template as UTF-8 directly into a caller-supplied buffer.
+    /// </summary>
+    /// <param name="ctx">The context containing values for the template. Cannot be null.</param>
+    /// <param name="utf8Destination">The buffer that receives the rendered UTF-8 bytes.</param>
+    /// <param name="bytesWritten">
+    /// The number of bytes written on success, or the number of bytes required when the buffer is too small.
+    /// </param>
+    /// <returns><c>true</c> if the output fit into <paramref name="utf8Destination"/>; otherwise <c>false</c>.</returns>
+    /// <exception cref="ObjectDisposedException">If the template is disposed.</exception>
+    /// <exception cref="ArgumentNullException">If ctx is null.</exception>
+    /// <exception cref="MinjaRenderException">Thrown if template rendering fails in the native layer.</exception>
+    /// <exception cref="MinjaException">For other native errors during rendering.</exception>
+    public bool TryRender(Context ctx, Span<byte> utf8Destination, out int bytesWritten)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, typeof(Template));
+        ArgumentNullException.ThrowIfNull(ctx);
+
+        if (ctx.Handle == IntPtr.Zero) throw new ArgumentException("Context has an invalid (null) handle.", nameof(ctx));
+
+        int result;
+        nuint length;
+        unsafe
+        {
+            fixed (byte* buffer = utf8Destination)
+            {
+                result = Native.mj_render_ctx_into(Handle, ctx.Handle, buffer, (nuint)utf8Destination.Length, out length);
+            }
+        }
+
+        bytesWritten = length > int.MaxValue ? int.MaxValue : (int)length;
+        if (result == Native.MjErrorBufferTooSmall)
+        {
+            return false;
+        }
+
+        Native.CheckResult(result, "Rendering template into buffer");
+        return true;
+    }
+
+    /// <summary>
+    /// Renders the template as UTF-8 into a stream, writing chunks as they are produced
+    /// instead of building the whole output first.
+    /// </summary>
+    /// <param name="ctx">The context containing values for the template. Cannot be null.</param>
+    /// <param name="destination">The stream that receives the rendered UTF-8 bytes. Cannot be null.</param>
+    /// <param name="flushThreshold">Approximate chunk size in bytes; 0 uses the native default.</param>
+    /// <exception cref="ObjectDisposedException">If the template is disposed.</exception>
+    /// <exception cref="ArgumentNullException">If ctx or destination is null.</exception>
+    /// <exception cref="MinjaRenderException">Thrown if template rendering fails in the native layer.</exception>
+    /// <exception cref="MinjaException">For other native errors during rendering.</exception>
+    public void Render(Context ctx, Stream destination, int flushThreshold = 0)
+    {
+        ArgumentNullException.ThrowIfNull(destination);
+        RenderStreaming(ctx, new StreamChunkWriter(destination), flushThreshold);
+    }
+
+    /// <summary>
+    /// Renders the template as UTF-8 into a buffer writer, writing chunks as they are produced
+    /// instead of building the whole output first.
+    /// </summary>
+    /// <param name="ctx">The context containing values for the template. Cannot be null.</param>
+    /// <param name="destination">The buffer writer that receives the rendered UTF-8 bytes. Cannot be null.</param>
+    /// <param name="flushThreshold">Approximate chunk size in bytes; 0 uses the native default.</param>
+    /// <exception cref="ObjectDisposedException">If the template is disposed.</exception>
+    /// <exception cref="ArgumentNullException">If ctx or destination is null.</exception>
+    /// <exception cref="MinjaRenderException">Thrown if template rendering fails in the native layer.</exception>
+    /// <exception cref="MinjaException">For other native errors during rendering.</exception>
+    public void Render(Context ctx, IBufferWriter<byte> destination, int flushThreshold = 0)
+    {
+        ArgumentNullException.ThrowIfNull(destination);
+        RenderStreaming(ctx, new BufferWriterChunkWriter(destination), flushThreshold);
+    }
+
+    private unsafe void RenderStreaming(Context ctx, ChunkWriter writer, int flushThreshold)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, typeof(Template));
+        ArgumentNullException.ThrowIfNull(ctx);
+        ArgumentOutOfRangeException.ThrowIfNegative(flushThreshold);
+
+        if (ctx.Handle == IntPtr.Zero) throw new ArgumentException("Context has an invalid (null) handle.", nameof(ctx));
+
+        var writerHandle = GCHandle.Alloc(writer);
+        int result;
+        try
+        {
+            result = Native.mj_render_stream(Handle, ctx.Handle, &OnChunk, GCHandle.ToIntPtr(writerHandle), (nuint)flushThreshold);
+        }
+        finally
+        {
+            writerHandle.Free();
+        }
+
+        // Exceptions thrown by the destination can't cross the native frame; they abort the
+        // render and are rethrown here with their original stack trace.
+        if (result == Native.MjErrorSinkAborted && writer.Error != null)
+        {
+            ExceptionDispatchInfo.Throw(writer.Error);
+        }
+
+        Native.CheckResult(result, "Rendering template to stream");
+    }
+
+    [UnmanagedCallersOnly(CallConvs = [typeof(CallConvCdecl)])]
+    private static unsafe int OnChunk(byte* data, nuint length, IntPtr userData)
+    {
+        var writer = (ChunkWriter)GCHandle.FromIntPtr(userData).Target!;
+        try
+        {
+            writer.Write(new ReadOnlySpan<byte>(data, checked((int)length)));
+            return 0;
+        }
+        catch (Exception ex)
+        {
+            writer.Error = ex;
+            return 1;
+        }
+    }
+
+    private abstract class ChunkWriter
+    {
+        public Exception? Error { get; set; }
+
+        public abstract void Write(ReadOnlySpan<byte> chunk);
+    }
+
+    private sealed class StreamChunkWriter(Stream stream) : ChunkWriter
+    {
+        public override void Write(ReadOnlySpan<byte> chunk) => stream.Write(chunk);
+    }
+
+    private sealed class BufferWriterChunkWriter(IBufferWriter<byte> bufferWriter) : ChunkWriter
+    {
+        public override void Write(ReadOnlySpan<byte> chunk) => bufferWriter.Write(chunk);
+    }
+
+    /// <summary>
+    /// Lists the variables and access paths this template may read, and the filters, tests and functions it uses.
+    /// The result is computed once per instance.
+    /// </summary>
+    /// <exception cref="ObjectDisposedException">If the template is disposed.</exception>
+    public TemplateAnalysis Analyze()
+    {
+        ObjectDisposedException.ThrowIf(_disposed, typeof(Template));
+        if (_analysis != null)
+        {
+            return _analysis;
+        }
+
+        var result = Native.mj_template_analyze(Handle, out var json);
+        Native.CheckResult(result, "Analyzing template");
+        try
+        {
+            return _analysis = new TemplateAnalysis(Marshal.PtrToStringUTF8(json)!);
+        }
+        finally
+        {
+            Native.mj_free_string(json);
+        }
+    }
+
+    /// <summary>
+    /// Creates a context from <paramref name="data"/> holding only what this template reads, according to
+    /// <see cref="Analyze"/>. Properties the template never reads are not marshalled, and array elements it
+    /// never reads are passed as null. Which properties of each type are kept is worked out once per type.
+    /// Falls back to <see cref="Context.From{T}"/> when the analysis is incomplete.
+    /// </summary>
+    /// <remarks>The context is only meant for this template: other templates may read what was left out.</remarks>
+    /// <exception cref="ObjectDisposedException">If the template is disposed.</exception>
+    /// <exception cref="ArgumentNullException">If data is null.</exception>
+    public Context CreateContext<T>(T data)
+    {
+        ArgumentNullException.ThrowIfNull(data);
+        var analysis = Analyze();
+        if (!analysis.IsComplete)
+        {
+            return Context.From(data);
+        }
+        return new Context(ValueBuilder.From(data, analysis.Requirement), takeOwnership: true);
     }
 
     /// <summary>
@@ -119,6 +558,59 @@ public sealed class Template : IDisposable
         return renderedString;
     }
 
+    /// <summary>
+    /// Renders the template using UTF-8 JSON as the context, without transcoding or copying the input.
+    /// The JSON is turned into template values directly while it is parsed; object keys keep their document order.
+    /// </summary>
+    /// <param name="utf8Json">The JSON context as UTF-8 bytes. Must be an object.</param>
+    /// <returns>The rendered template as a string.</returns>
+    /// <exception cref="ObjectDisposedException">If the template is disposed.</exception>
+    /// <exception cref="MinjaJsonException">Thrown if the JSON is malformed.</exception>
+    /// <exception cref="MinjaRenderException">Thrown if template rendering fails in the native layer.</exception>
+    /// <exception cref="MinjaException">For other native errors during rendering.</exception>
+    public unsafe string RenderJson(ReadOnlySpan<byte> utf8Json)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, typeof(Template));
+
+        int result;
+        IntPtr data;
+        nuint length;
+        fixed (byte* json = utf8Json)
+        {
+            result = Native.mj_render_json_retained(Handle, json, (nuint)utf8Json.Length, out data, out length);
+        }
+        Native.CheckResult(result, "Rendering template with JSON context");
+
+        if (length > int.MaxValue)
+        {
+            throw new MinjaAllocationException("Rendered output is too large for a .NET string.", Native.MjError);
+        }
+        return length == 0 ? string.Empty : Encoding.UTF8.GetString((byte*)data, (int)length);
+    }
+
+    /// <summary>
+    /// Reads the statistics collected for this template while <see cref="MinjaMetrics.Enabled"/> was on.
+    /// </summary>
+    /// <exception cref="ObjectDisposedException">If the template is disposed.</exception>
+    public TemplateStatistics GetStatistics()
+    {
+        ObjectDisposedException.ThrowIf(_disposed, typeof(Template));
+
+        var result = Native.mj_get_template_stats(Handle, out var stats);
+        Native.CheckResult(result, "Reading template statistics");
+        return new TemplateStatistics(new RenderStatistics(stats.Render), TimeSpan.FromTicks((long)(stats.ParseNs / 100)));
+    }
+
+    /// <summary>
+    /// Zeroes the render statistics of this template.
+    /// </summary>
+    /// <exception cref="ObjectDisposedException">If the template is disposed.</exception>
+    public void ResetStatistics()
+    {
+        ObjectDisposedException.ThrowIf(_disposed, typeof(Template));
+        Native.mj_reset_template_stats(Handle);
+    }
+
 
     /// <summary>
     /// Disposes the template and frees native resources.
@@ -147,4 +639,116 @@ public sealed class Template : IDisposable
     }
 
     ~Template() => Dispose(false);
-}
\ No newline at end of file
+}
+
+/// <summary>
+/// Renders templates into a native output buffer that is kept between renders. Each template also remembers
+/// a running estimate of its output size, so the buffer is reserved up front rather than grown while rendering.
+/// Once a renderer has seen its largest output, rendering no longer grows the native heap.
+/// </summary>
+/// <remarks>
+/// A renderer must be used by one thread at a time. Workers can take one with <see cref="Rent"/> and hand it back
+/// with <see cref="Return"/> so buffers are shared across requests without being shared between threads.
+/// </remarks>
+public sealed class Renderer : IDisposable
+{
+    private static readonly ConcurrentQueue<Renderer> s_pool = new();
+    private static readonly int s_maxPooled = Environment.ProcessorCount * 2;
+    private static int s_pooled;
+
+    internal IntPtr Handle { get; private set; }
+    private bool _disposed;
+
+    /// <summary>
+    /// Creates a renderer with an empty buffer.
+    /// </summary>
+    /// <exception cref="MinjaException">If the native renderer cannot be created.</exception>
+    public Renderer()
+    {
+        var result = Native.mj_renderer_create(out var handle);
+        Native.CheckResult(result, "Creating renderer");
+        Handle = handle;
+    }
+
+    /// <summary>
+    /// Takes a renderer from the process-wide pool, or creates one if the pool is empty.
+    /// </summary>
+    public static Renderer Rent()
+    {
+        if (s_pool.TryDequeue(out var renderer))
+        {
+            Interlocked.Decrement(ref s_pooled);
+            return renderer;
+        }
+        return new Renderer();
+    }
+
+    /// <summary>
+    /// Returns a renderer to the pool. The caller must not use it afterwards. Renderers beyond the pool's
+    /// capacity are disposed.
+    /// </summary>
+    public static void Return(Renderer renderer)
+    {
+        ArgumentNullException.ThrowIfNull(renderer);
+        if (renderer._disposed)
+        {
+            return;
+        }
+        if (Interlocked.Increment(ref s_pooled) > s_maxPooled)
+        {
+            Interlocked.Decrement(ref s_pooled);
+            renderer.Dispose();
+            return;
+        }
+        s_pool.Enqueue(renderer);
+    }
+
+    /// <summary>
+    /// Renders a template with a context.
+    /// </summary>
+    /// <exception cref="ObjectDisposedException">If the renderer is disposed.</exception>
+    /// <exception cref="ArgumentNullException">If template or ctx is null.</exception>
+    /// <exception cref="MinjaRenderException">Thrown if template rendering fails in the native layer.</exception>
+    /// <exception cref="MinjaException">For other native errors during rendering.</exception>
+    public unsafe string Render(Template template, Context ctx)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, this);
+        ArgumentNullException.ThrowIfNull(template);
+        ArgumentNullException.ThrowIfNull(ctx);
+        if (template.Handle == IntPtr.Zero) throw new ObjectDisposedException(nameof(Template));
+        if (ctx.Handle == IntPtr.Zero) throw new ArgumentException("Context has an invalid (null) handle.", nameof(ctx));
+
+        var result = Native.mj_renderer_render(Handle, template.Handle, ctx.Handle, out var data, out var length);
+        Native.CheckResult(result, "Rendering template with renderer");
+
+        if (length > int.MaxValue)
+        {
+            throw new MinjaAllocationException("Rendered output is too large for a .NET string.", Native.MjError);
+        }
+        return length == 0 ? string.Empty : Encoding.UTF8.GetString((byte*)data, (int)length);
+    }
+
+    /// <summary>
+    /// Disposes the renderer and frees its native buffer.
+    /// </summary>
+    public void Dispose()
+    {
+        Dispose(true);
+        GC.SuppressFinalize(this);
+    }
+
+    private void Dispose(bool disposing)
+    {
+        if (!_disposed)
+        {
+            if (Handle != IntPtr.Zero)
+            {
+                Native.mj_free_renderer(Handle);
+                Handle = IntPtr.Zero;
+            }
+            _disposed = true;
+        }
+    }
+
+    ~Renderer() => Dispose(false);
+}
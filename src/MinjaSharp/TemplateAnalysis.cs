@@ -0,0 +1,174 @@
+using System.Collections.Concurrent;
+using System.Reflection;
+using System.Text.Json;
+
+namespace MinjaSharp;
+
+/// <summary>
+/// What a template may read from its context, as reported by <see cref="Template.Analyze"/>. The analysis
+/// over-approximates: every read the template can make is covered, unless <see cref="IsComplete"/> is false.
+/// </summary>
+public sealed class TemplateAnalysis
+{
+    /// <summary>Path segment that stands for any array element, or any key after a computed subscript.</summary>
+    public const string AnyElement = "*";
+
+    private ValueRequirement? _requirement;
+
+    internal TemplateAnalysis(string json)
+    {
+        using var document = JsonDocument.Parse(json);
+        var root = document.RootElement;
+        Variables = Strings(root.GetProperty("variables"));
+        Paths = root.GetProperty("paths").EnumerateArray().Select(p => (IReadOnlyList<string>)Strings(p)).ToArray();
+        Shapes = root.GetProperty("shapes").EnumerateArray().Select(p => (IReadOnlyList<string>)Strings(p)).ToArray();
+        Filters = Strings(root.GetProperty("filters"));
+        Tests = Strings(root.GetProperty("tests"));
+        Functions = Strings(root.GetProperty("functions"));
+        IsDynamic = root.GetProperty("dynamic").GetBoolean();
+        IsComplete = root.GetProperty("complete").GetBoolean();
+    }
+
+    /// <summary>Top-level variables the template reads, builtins excluded.</summary>
+    public IReadOnlyList<string> Variables { get; }
+
+    /// <summary>
+    /// Access paths whose values may be read in full, such as <c>["messages", "*", "content"]</c>.
+    /// </summary>
+    public IReadOnlyList<IReadOnlyList<string>> Paths { get; }
+
+    /// <summary>
+    /// Access paths whose values are only iterated or tested for type, length or truthiness. The keys of an
+    /// object count as part of its shape.
+    /// </summary>
+    public IReadOnlyList<IReadOnlyList<string>> Shapes { get; }
+
+    /// <summary>Filters the template applies.</summary>
+    public IReadOnlyList<string> Filters { get; }
+
+    /// <summary>Tests the template applies with <c>is</c>.</summary>
+    public IReadOnlyList<string> Tests { get; }
+
+    /// <summary>Globals the template calls, builtins included.</summary>
+    public IReadOnlyList<string> Functions { get; }
+
+    /// <summary>True if the template computes a key or index; such subscripts appear as <see cref="AnyElement"/>.</summary>
+    public bool IsDynamic { get; }
+
+    /// <summary>False if the template uses a construct the analysis does not follow, so reads may be missing.</summary>
+    public bool IsComplete { get; }
+
+    internal ValueRequirement Requirement => _requirement ??= ValueRequirement.Build(this);
+
+    private static string[] Strings(JsonElement array) => array.EnumerateArray().Select(e => e.GetString()!).ToArray();
+}
+
+/// <summary>
+/// The part of a value a template reads, as a tree of <see cref="TemplateAnalysis"/> paths. Used to build
+/// contexts that leave out everything else.
+/// </summary>
+internal sealed class ValueRequirement
+{
+    // Properties each POCO type keeps under this requirement, resolved once per type.
+    private readonly ConcurrentDictionary<Type, (string Name, PropertyInfo Property, ValueRequirement Requirement)[]> _members = new();
+
+    /// <summary>The value is read in full.</summary>
+    public bool Whole { get; private set; }
+
+    /// <summary>The value's type, size or keys are read; objects are kept whole, arrays keep their length.</summary>
+    public bool Shape { get; private set; }
+
+    /// <summary>Requirements of named keys.</summary>
+    public Dictionary<string, ValueRequirement>? Children { get; private set; }
+
+    /// <summary>Requirement of every element, or of every key after a computed subscript.</summary>
+    public ValueRequirement? Any { get; private set; }
+
+    public static ValueRequirement Build(TemplateAnalysis analysis)
+    {
+        var root = new ValueRequirement();
+        foreach (var path in analysis.Paths)
+        {
+            root.Add(path).Whole = true;
+        }
+        foreach (var path in analysis.Shapes)
+        {
+            root.Add(path).Shape = true;
+        }
+        root.Normalize();
+        return root;
+    }
+
+    /// <summary>Requirement of a key, or <c>null</c> if the template never reads it.</summary>
+    public ValueRequirement? Child(string key) =>
+        Children != null && Children.TryGetValue(key, out var child) ? child : Any;
+
+    public (string Name, PropertyInfo Property, ValueRequirement Requirement)[] MembersOf(Type type) =>
+        _members.GetOrAdd(type, t => ValueBuilder.PropertiesOf(t)
+            .Where(p => Child(p.Name) != null)
+            .Select(p => (p.Name, p.Property, Child(p.Name)!))
+            .ToArray());
+
+    private ValueRequirement Add(IReadOnlyList<string> path)
+    {
+        var node = this;
+        foreach (var segment in path)
+        {
+            if (segment == TemplateAnalysis.AnyElement)
+            {
+                node = node.Any ??= new ValueRequirement();
+                continue;
+            }
+            node.Children ??= new Dictionary<string, ValueRequirement>();
+            if (!node.Children.TryGetValue(segment, out var child))
+            {
+                node.Children[segment] = child = new ValueRequirement();
+            }
+            node = child;
+        }
+        return node;
+    }
+
+    private void MergeFrom(ValueRequirement other)
+    {
+        Whole |= other.Whole;
+        Shape |= other.Shape;
+        if (other.Any != null)
+        {
+            (Any ??= new ValueRequirement()).MergeFrom(other.Any);
+        }
+        if (other.Children != null)
+        {
+            foreach (var (key, child) in other.Children)
+            {
+                Add([key]).MergeFrom(child);
+            }
+        }
+    }
+
+    // A key reachable through both its name and a computed subscript needs both requirements.
+    private void Normalize()
+    {
+        if (Whole)
+        {
+            Children = null;
+            Any = null;
+            return;
+        }
+        if (Any != null && Children != null)
+        {
+            foreach (var child in Children.Values)
+            {
+                child.MergeFrom(Any);
+            }
+        }
+        Any?.Normalize();
+        if (Children != null)
+        {
+            foreach (var child in Children.Values)
+            {
+                child.Normalize();
+            }
+        }
+    }
+}
@@ -0,0 +1,44 @@
+namespace MinjaSharp;
+
+/// <summary>
+/// Counters of the native template cache.
+/// </summary>
+/// <param name="Hits">Lookups that returned an already parsed template.</param>
+/// <param name="Misses">Lookups that had to parse the source.</param>
+/// <param name="Evictions">Templates dropped to stay within the budget.</param>
+/// <param name="Entries">Templates currently cached.</param>
+/// <param name="Bytes">Approximate memory charged to the cached templates.</param>
+/// <param name="Budget">Byte budget of the cache.</param>
+public readonly record struct TemplateCacheStatistics(
+    ulong Hits, ulong Misses, ulong Evictions, ulong Entries, ulong Bytes, ulong Budget);
+
+/// <summary>
+/// Controls the process-wide native cache used by <see cref="Template.FromCache"/>.
+/// </summary>
+public static class TemplateCache
+{
+    /// <summary>
+    /// Sets the approximate number of bytes the cache may hold. Least recently used templates are evicted to fit.
+    /// Templates already handed out are unaffected.
+    /// </summary>
+    public static void SetBudget(long bytes)
+    {
+        ArgumentOutOfRangeException.ThrowIfNegative(bytes);
+        Native.mj_template_cache_set_budget((nuint)bytes);
+    }
+
+    /// <summary>
+    /// Drops every cached template. Counters are kept.
+    /// </summary>
+    public static void Clear() => Native.mj_template_cache_clear();
+
+    /// <summary>
+    /// Reads the cache counters.
+    /// </summary>
+    public static TemplateCacheStatistics GetStatistics()
+    {
+        var result = Native.mj_template_cache_get_stats(out var stats);
+        Native.CheckResult(result, "Reading template cache statistics");
+        return new TemplateCacheStatistics(stats.Hits, stats.Misses, stats.Evictions, stats.Entries, stats.Bytes, stats.Budget);
+    }
+}
@@ -94,6 +94,38 @@ public sealed class Value : IDisposable
         return new Value(handle);
     }
 
+    /// <summary>
+    /// Builds a value from UTF-8 JSON in a single pass. Object keys keep their document order.
+    /// </summary>
+    /// <param name="utf8Json">The JSON document as UTF-8 bytes.</param>
+    /// <exception cref="MinjaJsonException">Thrown if the JSON is malformed.</exception>
+    public static unsafe Value FromJson(ReadOnlySpan<byte> utf8Json)
+    {
+        int result;
+        IntPtr handle;
+        fixed (byte* json = utf8Json)
+        {
+            result = Native.mj_value_from_json(json, (nuint)utf8Json.Length, out handle);
+        }
+        Native.CheckResult(result, "Building value from JSON");
+        return new Value(handle);
+    }
+
+    /// <summary>
+    /// Decodes a complete value tree from the binary format understood by <c>mj_value_from_buffer</c>.
+    /// </summary>
+    internal static unsafe Value FromBuffer(ReadOnlySpan<byte> buffer)
+    {
+        int result;
+        IntPtr handle;
+        fixed (byte* data = buffer)
+        {
+            result = Native.mj_value_from_buffer(data, (nuint)buffer.Length, out handle);
+        }
+        Native.CheckResult(result, "Decoding value buffer");
+        return new Value(handle);
+    }
+
     /// <summary>
     /// Adds an element to an array value.
     /// </summary>
@@ -129,6 +161,105 @@ public sealed class Value : IDisposable
         Native.CheckResult(result, $"Setting object property '{key}'");
     }
 
+    /// <summary>
+    /// Sets a property on an object value using an interned key.
+    /// </summary>
+    /// <param name="key">The interned property key.</param>
+    /// <param name="val">The property value.</param>
+    /// <exception cref="ObjectDisposedException">Thrown if this value or val is disposed.</exception>
+    /// <exception cref="ArgumentNullException">Thrown if val is null.</exception>
+    /// <exception cref="ArgumentException">Thrown if key is the default value rather than an interned key.</exception>
+    /// <exception cref="MinjaOperationException">Thrown if the native operation fails (e.g., not an object, allocation error).</exception>
+    public void Set(ValueKey key, Value val)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, typeof(Value));
+        ArgumentNullException.ThrowIfNull(val);
+        ObjectDisposedException.ThrowIf(val._disposed, val);
+
+        if (key.Name is null)
+        {
+            throw new ArgumentException("Use ValueKey.Intern to create a key.", nameof(key));
+        }
+
+        var result = Native.mj_object_set_key(Handle, key.Id, val.Handle);
+        Native.CheckResult(result, $"Setting object property '{key}'");
+    }
+
+    /// <summary>
+    /// Adds an element to an array value by moving it rather than copying it.
+    /// Ownership of <paramref name="elem"/> passes to this array and <paramref name="elem"/> is disposed.
+    /// </summary>
+    /// <param name="elem">The element value to move into the array.</param>
+    /// <exception cref="ObjectDisposedException">Thrown if this value or elem is disposed.</exception>
+    /// <exception cref="MinjaOperationException">Thrown if the native operation fails (e.g., not an array, allocation error).</exception>
+    public void AddOwned(Value elem)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, typeof(Value));
+        ArgumentNullException.ThrowIfNull(elem);
+        ObjectDisposedException.ThrowIf(elem._disposed, elem);
+
+        var result = Native.mj_array_push_take(Handle, elem.Handle);
+        Native.CheckResult(result, "Moving element into array");
+        elem.MarkConsumed();
+    }
+
+    /// <summary>
+    /// Sets a property on an object value by moving the value rather than copying it.
+    /// Ownership of <paramref name="val"/> passes to this object and <paramref name="val"/> is disposed.
+    /// </summary>
+    /// <param name="key">The property key.</param>
+    /// <param name="val">The property value to move into the object.</param>
+    /// <exception cref="ObjectDisposedException">Thrown if this value or val is disposed.</exception>
+    /// <exception cref="ArgumentNullException">Thrown if key or val is null.</exception>
+    /// <exception cref="MinjaOperationException">Thrown if the native operation fails (e.g., not an object, allocation error).</exception>
+    public void SetOwned(string key, Value val)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, typeof(Value));
+        ArgumentNullException.ThrowIfNull(key);
+        ArgumentNullException.ThrowIfNull(val);
+        ObjectDisposedException.ThrowIf(val._disposed, val);
+
+        var result = Native.mj_object_set_take(Handle, key, val.Handle);
+        Native.CheckResult(result, $"Moving value into object property '{key}'");
+        val.MarkConsumed();
+    }
+
+    /// <summary>
+    /// Sets a property on an object value using an interned key, moving the value rather than copying it.
+    /// Ownership of <paramref name="val"/> passes to this object and <paramref name="val"/> is disposed.
+    /// </summary>
+    /// <param name="key">The interned property key.</param>
+    /// <param name="val">The property value to move into the object.</param>
+    /// <exception cref="ObjectDisposedException">Thrown if this value or val is disposed.</exception>
+    /// <exception cref="ArgumentNullException">Thrown if val is null.</exception>
+    /// <exception cref="ArgumentException">Thrown if key is the default value rather than an interned key.</exception>
+    /// <exception cref="MinjaOperationException">Thrown if the native operation fails (e.g., not an object, allocation error).</exception>
+    public void SetOwned(ValueKey key, Value val)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, typeof(Value));
+        ArgumentNullException.ThrowIfNull(val);
+        ObjectDisposedException.ThrowIf(val._disposed, val);
+
+        if (key.Name is null)
+        {
+            throw new ArgumentException("Use ValueKey.Intern to create a key.", nameof(key));
+        }
+
+        var result = Native.mj_object_set_key_take(Handle, key.Id, val.Handle);
+        Native.CheckResult(result, $"Moving value into object property '{key}'");
+        val.MarkConsumed();
+    }
+
+    /// <summary>
+    /// Marks this instance as disposed after the native side has taken over (and freed) its handle.
+    /// </summary>
+    internal void MarkConsumed()
+    {
+        Handle = IntPtr.Zero;
+        _disposed = true;
+        GC.SuppressFinalize(this);
+    }
+
     /// <summary>
     /// Disposes the value and frees native resources if this instance owns the handle.
     /// </summary>
@@ -0,0 +1,196 @@
+using System.Buffers;
+using System.Buffers.Binary;
+using System.Text;
+
+namespace MinjaSharp;
+
+/// <summary>
+/// Serializes a value tree into the binary format read by <c>mj_value_from_buffer</c>,
+/// so a whole tree crosses the native boundary in one call.
+/// </summary>
+/// <remarks>
+/// Containers are written with a count placeholder that is patched once the last element is known,
+/// which lets callers stream enumerables without materializing them first.
+/// </remarks>
+internal sealed class ValueBufferWriter : IDisposable
+{
+    private const byte Version = 2;
+    private const uint InternedKey = 0x80000000;
+    private const uint NullLength = 0xFFFFFFFF;
+
+    private const byte TagNull = 0x00;
+    private const byte TagFalse = 0x01;
+    private const byte TagTrue = 0x02;
+    private const byte TagInt64 = 0x03;
+    private const byte TagDouble = 0x04;
+    private const byte TagString = 0x05;
+    private const byte TagArray = 0x06;
+    private const byte TagObject = 0x07;
+    private const byte TagInt64Array = 0x08;
+    private const byte TagDoubleArray = 0x09;
+    private const byte TagStringArray = 0x0A;
+
+    private byte[] _buffer;
+    private int _position;
+
+    public ValueBufferWriter(int initialCapacity = 4096)
+    {
+        _buffer = ArrayPool<byte>.Shared.Rent(initialCapacity);
+        WriteByte((byte)'M');
+        WriteByte((byte)'J');
+        WriteByte((byte)'V');
+        WriteByte(Version);
+    }
+
+    /// <summary>The encoded bytes written so far.</summary>
+    public ReadOnlySpan<byte> WrittenSpan => _buffer.AsSpan(0, _position);
+
+    /// <summary>Current write position, used to roll back a partially written element.</summary>
+    public int Position => _position;
+
+    public void Rewind(int position) => _position = position;
+
+    public void WriteNull() => WriteByte(TagNull);
+
+    public void WriteBool(bool b) => WriteByte(b ? TagTrue : TagFalse);
+
+    public void WriteInt(long i)
+    {
+        WriteByte(TagInt64);
+        WriteInt64Raw(i);
+    }
+
+    public void WriteDouble(double d)
+    {
+        WriteByte(TagDouble);
+        WriteInt64Raw(BitConverter.DoubleToInt64Bits(d));
+    }
+
+    public void WriteString(string s)
+    {
+        WriteByte(TagString);
+        WriteStringRaw(s);
+    }
+
+    /// <summary>Starts an array; write the elements, then pass the returned token and count to <see cref="EndContainer"/>.</summary>
+    public int BeginArray() => BeginContainer(TagArray);
+
+    /// <summary>Starts an object; write key/value pairs with <see cref="WriteKey"/>, then call <see cref="EndContainer"/>.</summary>
+    public int BeginObject() => BeginContainer(TagObject);
+
+    public void WriteKey(string key) => WriteStringRaw(key);
+
+    /// <summary>Writes a key interned with <c>mj_intern_key</c> as its id instead of its text.</summary>
+    public void WriteKey(ValueKey key)
+    {
+        EnsureCapacity(4);
+        BinaryPrimitives.WriteUInt32LittleEndian(_buffer.AsSpan(_position), InternedKey | key.Id);
+        _position += 4;
+    }
+
+    public void EndContainer(int token, int count) =>
+        BinaryPrimitives.WriteUInt32LittleEndian(_buffer.AsSpan(token), (uint)count);
+
+    public void WriteInt64Array(IEnumerable<long> values)
+    {
+        var token = BeginContainer(TagInt64Array);
+        var count = 0;
+        foreach (var value in values)
+        {
+            WriteInt64Raw(value);
+            count++;
+        }
+        EndContainer(token, count);
+    }
+
+    public void WriteDoubleArray(IEnumerable<double> values)
+    {
+        var token = BeginContainer(TagDoubleArray);
+        var count = 0;
+        foreach (var value in values)
+        {
+            WriteInt64Raw(BitConverter.DoubleToInt64Bits(value));
+            count++;
+        }
+        EndContainer(token, count);
+    }
+
+    public void WriteStringArray(IEnumerable<string?> values)
+    {
+        var token = BeginContainer(TagStringArray);
+        var count = 0;
+        foreach (var value in values)
+        {
+            if (value is null)
+            {
+                EnsureCapacity(4);
+                BinaryPrimitives.WriteUInt32LittleEndian(_buffer.AsSpan(_position), NullLength);
+                _position += 4;
+            }
+            else
+            {
+                WriteStringRaw(value);
+            }
+            count++;
+        }
+        EndContainer(token, count);
+    }
+
+    private int BeginContainer(byte tag)
+    {
+        WriteByte(tag);
+        EnsureCapacity(4);
+        var token = _position;
+        _position += 4;
+        return token;
+    }
+
+    private void WriteByte(byte b)
+    {
+        EnsureCapacity(1);
+        _buffer[_position++] = b;
+    }
+
+    private void WriteInt64Raw(long value)
+    {
+        EnsureCapacity(8);
+        BinaryPrimitives.WriteInt64LittleEndian(_buffer.AsSpan(_position), value);
+        _position += 8;
+    }
+
+    private void WriteStringRaw(string s)
+    {
+        EnsureCapacity(4 + Encoding.UTF8.GetMaxByteCount(s.Length));
+        var length = Encoding.UTF8.GetBytes(s, _buffer.AsSpan(_position + 4));
+        BinaryPrimitives.WriteUInt32LittleEndian(_buffer.AsSpan(_position), (uint)length);
+        _position += 4 + length;
+    }
+
+    private void EnsureCapacity(int additional)
+    {
+        var required = (long)_position + additional;
+        if (required <= _buffer.Length)
+        {
+            return;
+        }
+
+        if (required > Array.MaxLength)
+        {
+            throw new MinjaAllocationException("Encoded value tree is too large.", Native.MjError);
+        }
+
+        var newBuffer = ArrayPool<byte>.Shared.Rent((int)Math.Min(Math.Max(required, (long)_buffer.Length * 2), Array.MaxLength));
+        _buffer.AsSpan(0, _position).CopyTo(newBuffer);
+        ArrayPool<byte>.Shared.Return(_buffer);
+        _buffer = newBuffer;
+    }
+
+    public void Dispose()
+    {
+        if (_buffer.Length > 0)
+        {
+            ArrayPool<byte>.Shared.Return(_buffer);
+            _buffer = [];
+        }
+    }
+}
@@ -1,4 +1,5 @@
 using System.Collections;
+using System.Collections.Concurrent;
 using System.Reflection;
 using System.Text.Json.Serialization;
 
@@ -9,93 +10,299 @@ namespace MinjaSharp;
 /// </summary>
 public static class ValueBuilder
 {
+    // Public instance properties of each POCO type with the names templates see them under.
+    private static readonly ConcurrentDictionary<Type, (string Name, PropertyInfo Property)[]> s_properties = new();
+
+    // Interned keys for the same properties, in the same order, so POCO objects send ids instead of names.
+    private static readonly ConcurrentDictionary<Type, ValueKey[]> s_propertyKeys = new();
+
     /// <summary>
     /// Creates a Value from a C# object, using reflection to build a Value tree.
     /// Supports primitives, strings, dictionaries, collections, and POCOs.
     /// </summary>
+    /// <remarks>
+    /// The whole object graph is encoded into one buffer and decoded natively in a single call,
+    /// rather than creating and linking a native value per node.
+    /// </remarks>
     /// <typeparam name="T">The type of the object to convert to a Value.</typeparam>
     /// <param name="data">The object to convert to a Value.</param>
     /// <returns>A Value representation of the provided object.</returns>
     internal static Value From<T>(T? data)
+    {
+        using var writer = new ValueBufferWriter();
+        Write(writer, data);
+        return Value.FromBuffer(writer.WrittenSpan);
+    }
+
+    /// <summary>
+    /// Creates a Value from a C# object, leaving out everything <paramref name="requirement"/> says is never read.
+    /// Objects keep only the keys that are read; array elements that are never read become null, so lengths
+    /// are preserved.
+    /// </summary>
+    internal static Value From<T>(T? data, ValueRequirement requirement)
+    {
+        using var writer = new ValueBufferWriter();
+        Write(writer, data, requirement);
+        return Value.FromBuffer(writer.WrittenSpan);
+    }
+
+    private static void Write(ValueBufferWriter writer, object? data, ValueRequirement? requirement)
+    {
+        if (requirement == null)
+        {
+            writer.WriteNull();
+            return;
+        }
+        if (requirement.Whole)
+        {
+            Write(writer, data);
+            return;
+        }
+
+        switch (data)
+        {
+            case null or string or bool or int or long or float or double or decimal:
+                Write(writer, data);
+                return;
+            // The keys of an object are part of its shape
+            case IDictionary<string, object> or IDictionary when requirement.Shape:
+                Write(writer, data);
+                return;
+            case IDictionary<string, object> dict:
+            {
+                var token = writer.BeginObject();
+                var count = 0;
+                foreach (var kv in dict)
+                {
+                    var child = requirement.Child(kv.Key);
+                    if (child != null)
+                    {
+                        writer.WriteKey(kv.Key);
+                        Write(writer, kv.Value, child);
+                        count++;
+                    }
+                }
+                writer.EndContainer(token, count);
+                return;
+            }
+            case IDictionary genericDict:
+            {
+                var token = writer.BeginObject();
+                var count = 0;
+                foreach (DictionaryEntry entry in genericDict)
+                {
+                    if (entry.Key is string key && requirement.Child(key) is { } child)
+                    {
+                        writer.WriteKey(key);
+                        Write(writer, entry.Value, child);
+                        count++;
+                    }
+                }
+                writer.EndContainer(token, count);
+                return;
+            }
+            case IEnumerable enumerable:
+            {
+                var token = writer.BeginArray();
+                var count = 0;
+                foreach (var item in enumerable)
+                {
+                    Write(writer, item, requirement.Any);
+                    count++;
+                }
+                writer.EndContainer(token, count);
+                return;
+            }
+        }
+
+        if (requirement.Shape)
+        {
+            Write(writer, data);
+            return;
+        }
+
+        var objToken = writer.BeginObject();
+        var propertyCount = 0;
+        foreach (var (propertyName, prop, child) in requirement.MembersOf(data.GetType()))
+        {
+            var mark = writer.Position;
+            try
+            {
+                var propVal = prop.GetValue(data);
+                writer.WriteKey(propertyName);
+                Write(writer, propVal, child);
+                propertyCount++;
+            }
+            catch
+            {
+                writer.Rewind(mark);
+            }
+        }
+        writer.EndContainer(objToken, propertyCount);
+    }
+
+    private static void Write(ValueBufferWriter writer, object? data)
     {
         switch (data)
         {
             case null:
-                return Value.Null();
+                writer.WriteNull();
+                return;
             // Handle primitive types
             case string s:
-                return Value.String(s);
+                writer.WriteString(s);
+                return;
             case bool b:
-                return Value.Bool(b);
+                writer.WriteBool(b);
+                return;
             case int i:
-                return Value.Int(i);
+                writer.WriteInt(i);
+                return;
             case long l:
-                return Value.Int(l);
+                writer.WriteInt(l);
+                return;
             case float f:
-                return Value.Double(f);
+                writer.WriteDouble(f);
+                return;
             case double d:
-                return Value.Double(d);
+                writer.WriteDouble(d);
+                return;
             case decimal dec:
-                return Value.Double((double)dec);
+                writer.WriteDouble((double)dec);
+                return;
             // Handle dictionaries
             case IDictionary<string, object> dict:
             {
-                var obj = Value.Object();
+                var token = writer.BeginObject();
+                var count = 0;
                 foreach (var kv in dict)
                 {
-                    using var val = From(kv.Value);
-                    obj.Set(kv.Key, val);
+                    writer.WriteKey(kv.Key);
+                    Write(writer, kv.Value);
+                    count++;
                 }
-                return obj;
+                writer.EndContainer(token, count);
+                return;
             }
             // Handle general dictionaries with string keys
             case IDictionary genericDict:
             {
-                var obj = Value.Object();
+                var token = writer.BeginObject();
+                var count = 0;
                 foreach (DictionaryEntry entry in genericDict)
                 {
                     if (entry.Key is string key)
                     {
-                        using var val = From(entry.Value);
-                        obj.Set(key, val);
+                        writer.WriteKey(key);
+                        Write(writer, entry.Value);
+                        count++;
                     }
                 }
-                return obj;
+                writer.EndContainer(token, count);
+                return;
             }
+            // Homogeneous collections are sent as packed runs
+            case IEnumerable<string?> strings:
+                writer.WriteStringArray(strings);
+                return;
+            case IEnumerable<long> longs:
+                writer.WriteInt64Array(longs);
+                return;
+            case IEnumerable<int> ints:
+                writer.WriteInt64Array(ints.Select(x => (long)x));
+                return;
+            case IEnumerable<double> doubles:
+                writer.WriteDoubleArray(doubles);
+                return;
             // Handle collections/arrays
-            case IEnumerable enumerable and not string:
+            case IEnumerable enumerable:
             {
-                var arr = Value.Array();
+                var token = writer.BeginArray();
+                var count = 0;
                 foreach (var item in enumerable)
                 {
-                    using var val = From(item);
-                    arr.Add(val);
+                    Write(writer, item);
+                    count++;
                 }
-                return arr;
+                writer.EndContainer(token, count);
+                return;
             }
         }
 
         // Handle POCO objects through reflection
-        var objValue = Value.Object();
+        var objToken = writer.BeginObject();
+        var propertyCount = 0;
         var type = data.GetType();
-        foreach (var prop in type.GetProperties(BindingFlags.Public | BindingFlags.Instance))
+        var properties = PropertiesOf(type);
+        var keys = KeysOf(type);
+        for (var i = 0; i < properties.Length; i++)
         {
+            var prop = properties[i].Property;
+            var mark = writer.Position;
             try
             {
                 var propVal = prop.GetValue(data);
-                using var val = From(propVal);
-                
-                // Check for JsonPropertyName attribute
-                var jsonPropertyAttr = prop.GetCustomAttribute<JsonPropertyNameAttribute>();
-                var propertyName = jsonPropertyAttr != null ? jsonPropertyAttr.Name : prop.Name.ToLower();
-                
-                objValue.Set(propertyName, val);
+                writer.WriteKey(keys[i]);
+                Write(writer, propVal);
+                propertyCount++;
+            }
+            catch
+            {
+                // Skip properties that can't be read, dropping anything already written for them
+                writer.Rewind(mark);
+            }
+        }
+        writer.EndContainer(objToken, propertyCount);
+    }
+
+    /// <summary>
+    /// Looks up one member of a dictionary or POCO under the name <see cref="From{T}"/> would give it, without
+    /// touching the others. Properties that can't be read count as missing, as they are skipped by <see cref="From{T}"/>.
+    /// </summary>
+    internal static bool TryGetMember(object data, string name, out object? value)
+    {
+        switch (data)
+        {
+            case IDictionary<string, object> dict:
+                return dict.TryGetValue(name, out value);
+            case IDictionary genericDict:
+                if (genericDict.Contains(name))
+                {
+                    value = genericDict[name];
+                    return true;
+                }
+                value = null;
+                return false;
+            case string or IEnumerable:
+                value = null;
+                return false;
+        }
+
+        foreach (var (propertyName, prop) in PropertiesOf(data.GetType()))
+        {
+            if (propertyName != name)
+            {
+                continue;
+            }
+            try
+            {
+                value = prop.GetValue(data);
+                return true;
             }
             catch
             {
-                // Skip properties that can't be read
+                break;
             }
         }
-        return objValue;
+        value = null;
+        return false;
     }
-}
\ No newline at end of file
+
+    internal static (string Name, PropertyInfo Property)[] PropertiesOf(Type type) =>
+        s_properties.GetOrAdd(type, static t => t.GetProperties(BindingFlags.Public | BindingFlags.Instance)
+            .Select(prop => (prop.GetCustomAttribute<JsonPropertyNameAttribute>()?.Name ?? prop.Name.ToLower(), prop))
+            .ToArray());
+
+    private static ValueKey[] KeysOf(Type type) =>
+        s_propertyKeys.GetOrAdd(type, static t => PropertiesOf(t).Select(p => ValueKey.Intern(p.Name)).ToArray());
+}
@@ -0,0 +1,63 @@
+using System.Collections.Concurrent;
+using System.Text;
+
+namespace MinjaSharp;
+
+/// <summary>
+/// An object key interned once per process, for setting the same keys (<c>"role"</c>, <c>"content"</c>) on
+/// many objects without converting the key string for every call.
+/// </summary>
+/// <remarks>
+/// Interned keys are never released, so intern fixed names rather than keys that come from data.
+/// </remarks>
+public readonly struct ValueKey : IEquatable<ValueKey>
+{
+    private static readonly ConcurrentDictionary<string, ValueKey> s_keys = new(StringComparer.Ordinal);
+
+    private ValueKey(string name, uint id)
+    {
+        Name = name;
+        Id = id;
+    }
+
+    /// <summary>The key text.</summary>
+    public string Name { get; }
+
+    internal uint Id { get; }
+
+    /// <summary>
+    /// Returns the interned key for <paramref name="name"/>, interning it on first use.
+    /// </summary>
+    /// <exception cref="ArgumentNullException">Thrown if name is null.</exception>
+    /// <exception cref="MinjaOperationException">Thrown if the native key table is full.</exception>
+    public static ValueKey Intern(string name)
+    {
+        ArgumentNullException.ThrowIfNull(name);
+        return s_keys.TryGetValue(name, out var key) ? key : s_keys.GetOrAdd(name, static n => new ValueKey(n, InternNative(n)));
+    }
+
+    private static unsafe uint InternNative(string name)
+    {
+        var bytes = Encoding.UTF8.GetBytes(name);
+        int result;
+        uint id;
+        fixed (byte* data = bytes)
+        {
+            result = Native.mj_intern_key(data, (nuint)bytes.Length, out id);
+        }
+        Native.CheckResult(result, $"Interning object key '{name}'");
+        return id;
+    }
+
+    /// <inheritdoc />
+    public bool Equals(ValueKey other) => Id == other.Id && Name == other.Name;
+
+    /// <inheritdoc />
+    public override bool Equals(object? obj) => obj is ValueKey other && Equals(other);
+
+    /// <inheritdoc />
+    public override int GetHashCode() => (int)Id;
+
+    /// <inheritdoc />
+    public override string ToString() => Name ?? string.Empty;
+}
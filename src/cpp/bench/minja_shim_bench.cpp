@@ -0,0 +1,578 @@
+// Benchmark suite for the minja shim C API: template parsing, node-by-node
+// value building, context rendering, the tojson filter and the JSON render
+// path, measured on the Qwen3 chat template with conversations of 1, 10, 100 and 1000 messages,
+// with and without tools.
+//
+// Build with -DMINJA_SHIM_BUILD_BENCH=ON and run
+//
+//   minja_shim_bench [--filter TEXT] [--min-time MS] [--template FILE]
+//                    [--json FILE] [--compare BASELINE.json] [--threshold PERCENT]
+//
+// Every benchmark reports ns/op, bytes/op and allocations/op. The allocation figures come
+// from the counting operator new below; the replacement reaches the shim library on ELF and
+// Mach-O platforms, while on Windows the DLL keeps its own allocator and only the harness
+// is counted. --json writes the results for later runs to --compare against; the exit code
+// is 2 when any benchmark regressed past the threshold.
+
+#include "minja_shim_ext.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace
+{
+  std::atomic<uint64_t> g_allocations{0};
+  std::atomic<uint64_t> g_allocated_bytes{0};
+
+  void *counted_alloc(size_t size) noexcept
+  {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+  }
+} // namespace
+
+void *operator new(size_t size)
+{
+  if (void *p = counted_alloc(size))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+  return counted_alloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+  return counted_alloc(size);
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+  std::free(p);
+}
+
+namespace
+{
+  using json = nlohmann::ordered_json;
+
+  struct Options
+  {
+    std::string filter;
+    double min_time_ms = 250;
+    std::string template_path;
+    std::string json_path;
+    std::string compare_path;
+    double threshold_percent = 10;
+  };
+
+  struct Result
+  {
+    std::string name;
+    uint64_t iterations = 0;
+    double ns_per_op = 0;
+    double bytes_per_op = 0;
+    double allocs_per_op = 0;
+  };
+
+  constexpr uint64_t kMinIterations = 10;
+
+  void check(int code, const char *what)
+  {
+    if (code != MJ_OK)
+    {
+      const char *error = mj_get_last_error();
+      std::fprintf(stderr, "%s failed (%d): %s\n", what, code, error ? error : "no details");
+      mj_free_string(const_cast<char *>(error));
+      std::exit(1);
+    }
+  }
+
+  [[noreturn]] void fail(const std::string &message)
+  {
+    std::fprintf(stderr, "minja_shim_bench: %s\n", message.c_str());
+    std::exit(1);
+  }
+
+  std::string read_file(const std::string &path)
+  {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+      fail("cannot read " + path);
+    }
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+
+  // Loads a template from a plain file, or from the raw string literal of a C# source file so
+  // the bench measures exactly the template the managed tests use.
+  std::string load_template(const std::string &path)
+  {
+    std::string text = read_file(path);
+    if (path.size() < 3 || path.compare(path.size() - 3, 3, ".cs") != 0)
+    {
+      return text;
+    }
+
+    size_t open = text.find("\"\"\"\n");
+    size_t close = open == std::string::npos ? open : text.find("\n\"\"\"", open + 4);
+    if (close == std::string::npos)
+    {
+      fail("no raw string literal in " + path);
+    }
+    std::string source = text.substr(open + 4, close - open - 4);
+    source.erase(std::remove(source.begin(), source.end(), '\r'), source.end());
+    return source;
+  }
+
+  json make_tools()
+  {
+    auto tool = [](const char *name, const char *description, json properties, json required) {
+      return json{{"type", "function"},
+                  {"function",
+                   {{"name", name},
+                    {"description", description},
+                    {"parameters", {{"type", "object"}, {"properties", std::move(properties)}, {"required", std::move(required)}}}}}};
+    };
+
+    json tools = json::array();
+    tools.push_back(tool("get_weather", "Get the current weather for a location.",
+                         {{"location", {{"type", "string"}, {"description", "City and country, e.g. Paris, France"}}},
+                          {"unit", {{"type", "string"}, {"enum", {"celsius", "fahrenheit"}}}}},
+                         {"location"}));
+    tools.push_back(tool("search", "Search the web and return the top results.",
+                         {{"query", {{"type", "string"}}}, {"max_results", {{"type", "integer"}, {"minimum", 1}, {"maximum", 20}}}},
+                         {"query"}));
+    tools.push_back(tool("calculator", "Evaluate an arithmetic expression.",
+                         {{"expression", {{"type", "string"}}}},
+                         {"expression"}));
+    return tools;
+  }
+
+  // A conversation of `count` messages: a system prompt followed by alternating user and
+  // assistant turns. With tools, every other exchange goes through a tool call and response.
+  json make_root(size_t count, bool with_tools)
+  {
+    json messages = json::array();
+    for (size_t i = 0; i < count; ++i)
+    {
+      std::string n = std::to_string(i);
+      if (i == 0 && count > 1)
+      {
+        messages.push_back({{"role", "system"}, {"content", "You are a helpful assistant. Answer concisely and cite your sources."}});
+        continue;
+      }
+
+      switch (with_tools ? i % 4 : i % 2)
+      {
+      case 1:
+        messages.push_back({{"role", "user"}, {"content", "Question " + n + ": what is the weather like in Paris today, and should I bring an umbrella?"}});
+        break;
+      case 2:
+        if (with_tools)
+        {
+          json call = {{"type", "function"},
+                       {"function", {{"name", "get_weather"}, {"arguments", {{"location", "Paris, France"}, {"unit", "celsius"}}}}}};
+          messages.push_back({{"role", "assistant"}, {"content", ""}, {"tool_calls", json::array({std::move(call)})}});
+          break;
+        }
+        [[fallthrough]];
+      case 0:
+        messages.push_back({{"role", "assistant"},
+                            {"content", "<think>\nThe user asked question " + n + ".\n</think>\n\nLight rain is expected this afternoon, so yes, take an umbrella."}});
+        break;
+      case 3:
+        messages.push_back({{"role", "tool"}, {"content", "{\"temperature\": 14, \"condition\": \"light rain\", \"precipitation\": 0.8}"}});
+        break;
+      }
+    }
+
+    json root = {{"messages", std::move(messages)}, {"add_generation_prompt", true}};
+    if (with_tools)
+    {
+      root["tools"] = make_tools();
+    }
+    return root;
+  }
+
+  // A host keeps the ids of its fixed key names; interning is a one-time cost per name.
+  uint32_t key_id(const std::string &key)
+  {
+    static std::unordered_map<std::string, uint32_t> ids;
+    auto it = ids.find(key);
+    if (it == ids.end())
+    {
+      uint32_t id = 0;
+      check(mj_intern_key(key.data(), key.size(), &id), "mj_intern_key");
+      it = ids.emplace(key, id).first;
+    }
+    return it->second;
+  }
+
+  // Builds a shim value one node at a time through the C API, the way the managed builder does.
+  // With `interned`, object keys are passed as interned ids instead of C strings.
+  void *to_value(const json &node, bool interned = false)
+  {
+    void *value = nullptr;
+    switch (node.type())
+    {
+    case json::value_t::object:
+      check(mj_value_object(&value), "mj_value_object");
+      for (const auto &item : node.items())
+      {
+        if (interned)
+        {
+          check(mj_object_set_key_take(value, key_id(item.key()), to_value(item.value(), true)), "mj_object_set_key_take");
+        }
+        else
+        {
+          check(mj_object_set_take(value, item.key().c_str(), to_value(item.value())), "mj_object_set_take");
+        }
+      }
+      break;
+    case json::value_t::array:
+      check(mj_value_array(&value), "mj_value_array");
+      for (const auto &element : node)
+      {
+        check(mj_array_push_take(value, to_value(element, interned)), "mj_array_push_take");
+      }
+      break;
+    case json::value_t::string:
+      check(mj_value_string(node.get_ref<const std::string &>().c_str(), &value), "mj_value_string");
+      break;
+    case json::value_t::boolean:
+      check(mj_value_bool(node.get<bool>(), &value), "mj_value_bool");
+      break;
+    case json::value_t::number_integer:
+    case json::value_t::number_unsigned:
+      check(mj_value_int(node.get<int64_t>(), &value), "mj_value_int");
+      break;
+    case json::value_t::number_float:
+      check(mj_value_double(node.get<double>(), &value), "mj_value_double");
+      break;
+    default:
+      check(mj_value_null(&value), "mj_value_null");
+      break;
+    }
+    return value;
+  }
+
+  void *to_context(const json &root, bool interned = false)
+  {
+    void *context = nullptr;
+    check(mj_context_make_take(to_value(root, interned), &context), "mj_context_make_take");
+    return context;
+  }
+
+  class Suite
+  {
+  public:
+    explicit Suite(const Options &options) : options_(options) {}
+
+    template <typename Func>
+    void run(const std::string &name, Func &&func)
+    {
+      if (!options_.filter.empty() && name.find(options_.filter) == std::string::npos)
+      {
+        return;
+      }
+
+      func(); // warm-up: grows retained buffers and fills caches before anything is counted
+
+      auto min_time = std::chrono::duration<double, std::milli>(options_.min_time_ms);
+      uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+      uint64_t bytes = g_allocated_bytes.load(std::memory_order_relaxed);
+      uint64_t iterations = 0;
+      auto start = std::chrono::steady_clock::now();
+      std::chrono::steady_clock::duration elapsed{};
+      do
+      {
+        func();
+        ++iterations;
+        elapsed = std::chrono::steady_clock::now() - start;
+      } while (iterations < kMinIterations || elapsed < min_time);
+
+      Result result;
+      result.name = name;
+      result.iterations = iterations;
+      result.ns_per_op = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+      result.bytes_per_op = static_cast<double>(g_allocated_bytes.load(std::memory_order_relaxed) - bytes) / static_cast<double>(iterations);
+      result.allocs_per_op = static_cast<double>(g_allocations.load(std::memory_order_relaxed) - allocations) / static_cast<double>(iterations);
+
+      std::printf("%-36s %14.0f %14.0f %12.1f %10llu\n", result.name.c_str(), result.ns_per_op, result.bytes_per_op,
+                  result.allocs_per_op, static_cast<unsigned long long>(result.iterations));
+      std::fflush(stdout);
+      results_.push_back(std::move(result));
+    }
+
+    const std::vector<Result> &results() const { return results_; }
+
+  private:
+    const Options &options_;
+    std::vector<Result> results_;
+  };
+
+  json to_json(const std::vector<Result> &results, const Options &options)
+  {
+    json benchmarks = json::array();
+    for (const auto &result : results)
+    {
+      benchmarks.push_back({{"name", result.name},
+                            {"iterations", result.iterations},
+                            {"ns_per_op", result.ns_per_op},
+                            {"bytes_per_op", result.bytes_per_op},
+                            {"allocs_per_op", result.allocs_per_op}});
+    }
+    return {{"template", options.template_path}, {"min_time_ms", options.min_time_ms}, {"benchmarks", std::move(benchmarks)}};
+  }
+
+  // Prints each benchmark against the baseline and returns the number of regressions: time
+  // beyond the threshold, or any growth in allocations per operation.
+  int compare(const std::vector<Result> &results, const Options &options)
+  {
+    json baseline;
+    try
+    {
+      baseline = json::parse(read_file(options.compare_path)).at("benchmarks");
+    }
+    catch (const std::exception &e)
+    {
+      fail("cannot parse baseline " + options.compare_path + ": " + e.what());
+    }
+
+    std::printf("\n%-36s %14s %14s %9s %12s %12s\n", "compared to baseline", "base ns/op", "ns/op", "delta", "base allocs", "allocs/op");
+    int regressions = 0;
+    for (const auto &result : results)
+    {
+      const json *base = nullptr;
+      for (const auto &entry : baseline)
+      {
+        if (entry.is_object() && entry.value("name", "") == result.name)
+        {
+          base = &entry;
+          break;
+        }
+      }
+      if (!base)
+      {
+        std::printf("%-36s %14s\n", result.name.c_str(), "(new)");
+        continue;
+      }
+
+      double base_ns = base->value("ns_per_op", 0.0);
+      double base_allocs = base->value("allocs_per_op", 0.0);
+      double delta = base_ns > 0 ? (result.ns_per_op - base_ns) / base_ns * 100 : 0;
+      bool regressed = delta > options.threshold_percent || result.allocs_per_op > base_allocs + 0.5;
+      regressions += regressed ? 1 : 0;
+      std::printf("%-36s %14.0f %14.0f %+8.1f%% %12.1f %12.1f%s\n", result.name.c_str(), base_ns, result.ns_per_op, delta,
+                  base_allocs, result.allocs_per_op, regressed ? "  REGRESSED" : "");
+    }
+    return regressions;
+  }
+
+  Options parse_options(int argc, char **argv)
+  {
+    Options options;
+#ifdef MINJA_SHIM_BENCH_TEMPLATE
+    options.template_path = MINJA_SHIM_BENCH_TEMPLATE;
+#endif
+    for (int i = 1; i < argc; ++i)
+    {
+      std::string arg = argv[i];
+      auto next = [&]() -> std::string {
+        if (i + 1 >= argc)
+        {
+          fail("missing value for " + arg);
+        }
+        return argv[++i];
+      };
+
+      if (arg == "--filter")
+        options.filter = next();
+      else if (arg == "--min-time")
+        options.min_time_ms = std::strtod(next().c_str(), nullptr);
+      else if (arg == "--template")
+        options.template_path = next();
+      else if (arg == "--json")
+        options.json_path = next();
+      else if (arg == "--compare")
+        options.compare_path = next();
+      else if (arg == "--threshold")
+        options.threshold_percent = std::strtod(next().c_str(), nullptr);
+      else
+        fail("unknown argument " + arg +
+             "\nusage: minja_shim_bench [--filter TEXT] [--min-time MS] [--template FILE] [--json FILE] [--compare FILE] [--threshold PERCENT]");
+    }
+    if (options.template_path.empty())
+    {
+      fail("no template; pass --template FILE");
+    }
+    return options;
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Options options = parse_options(argc, argv);
+  std::string source = load_template(options.template_path);
+  Suite suite(options);
+
+  std::printf("%-36s %14s %14s %12s %10s\n", "benchmark", "ns/op", "bytes/op", "allocs/op", "iterations");
+
+  suite.run("parse/qwen3", [&] {
+    void *tpl = nullptr;
+    check(mj_parse(source.c_str(), &tpl), "mj_parse");
+    mj_free_template(tpl);
+  });
+
+  void *tpl = nullptr;
+  check(mj_parse(source.c_str(), &tpl), "mj_parse");
+
+  // The tool list serialised on its own, as Qwen-style templates do for every request.
+  {
+    void *tojson = nullptr;
+    check(mj_parse("{{ tools|tojson }}", &tojson), "mj_parse");
+    void *ctx = to_context(make_root(1, true));
+    suite.run("tojson/tools", [&] {
+      const char *data = nullptr;
+      size_t length = 0;
+      check(mj_render_ctx_retained(tojson, ctx, &data, &length), "mj_render_ctx_retained");
+    });
+    mj_free_context(ctx);
+    mj_free_template(tojson);
+  }
+
+  for (bool with_tools : {false, true})
+  {
+    for (size_t count : {1, 10, 100, 1000})
+    {
+      std::string suffix = "/messages=" + std::to_string(count) + (with_tools ? "/tools" : "");
+      json root = make_root(count, with_tools);
+      std::string root_json = root.dump();
+
+      suite.run("build" + suffix, [&] {
+        mj_free_context(to_context(root));
+      });
+      suite.run("build_interned" + suffix, [&] {
+        mj_free_context(to_context(root, true));
+      });
+
+      // One agent step edited into a live context, against rebuilding it above. The message is
+      // removed again so every iteration sees the same history length.
+      {
+        void *live = to_context(root);
+        json step = {{"role", "user"}, {"content", "And tomorrow?"}};
+        std::string added = "messages." + std::to_string(root["messages"].size());
+        suite.run("append" + suffix, [&] {
+          check(mj_context_append(live, "messages", to_value(step)), "mj_context_append");
+          check(mj_context_remove_path(live, added.c_str()), "mj_context_remove_path");
+        });
+        mj_free_context(live);
+      }
+
+      void *ctx = to_context(root);
+      suite.run("render" + suffix, [&] {
+        const char *data = nullptr;
+        size_t length = 0;
+        check(mj_render_ctx_retained(tpl, ctx, &data, &length), "mj_render_ctx_retained");
+      });
+
+      // Hits of the result cache, and what keeping value digests up to date adds to a build.
+      mj_result_cache_set_budget(64 * 1024 * 1024);
+      suite.run("build_digested" + suffix, [&] {
+        mj_free_value(to_value(root));
+      });
+      void *root_value = to_value(root);
+      {
+        const char *data = nullptr;
+        size_t length = 0;
+        check(mj_render_ctx_retained(tpl, ctx, &data, &length), "mj_render_ctx_retained");
+        std::string expected(data, length);
+        check(mj_render_cached(tpl, root_value, &data, &length), "mj_render_cached");
+        check(mj_render_cached(tpl, root_value, &data, &length), "mj_render_cached");
+        if (expected != std::string(data, length))
+        {
+          fail("cached output differs from the tree renderer" + suffix);
+        }
+      }
+      suite.run("render_cached" + suffix, [&] {
+        const char *data = nullptr;
+        size_t length = 0;
+        check(mj_render_cached(tpl, root_value, &data, &length), "mj_render_cached");
+      });
+      mj_free_value(root_value);
+      mj_result_cache_set_budget(0);
+
+      void *renderer = nullptr;
+      check(mj_renderer_create(&renderer), "mj_renderer_create");
+      suite.run("renderer" + suffix, [&] {
+        const char *data = nullptr;
+        size_t length = 0;
+        check(mj_renderer_render(renderer, tpl, ctx, &data, &length), "mj_renderer_render");
+      });
+      mj_free_renderer(renderer);
+      mj_free_context(ctx);
+
+      suite.run("render_json" + suffix, [&] {
+        const char *data = nullptr;
+        size_t length = 0;
+        check(mj_render_json_retained(tpl, root_json.data(), root_json.size(), &data, &length), "mj_render_json_retained");
+      });
+    }
+  }
+
+  mj_free_template(tpl);
+
+  if (!options.json_path.empty())
+  {
+    std::ofstream out(options.json_path, std::ios::binary);
+    out << to_json(suite.results(), options).dump(2) << '\n';
+    if (!out)
+    {
+      fail("cannot write " + options.json_path);
+    }
+  }
+
+  if (!options.compare_path.empty() && compare(suite.results(), options) > 0)
+  {
+    return 2;
+  }
+  return 0;
+}
@@ -0,0 +1,327 @@
+#include "chat_session.h"
+#include "render_sink.h"
+#include "template_scan.h"
+#include "tojson_filter.h"
+#include "value_buffer.h"
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+namespace minja_shim_ext_internal
+{
+  std::optional<SeparableLoop> find_separable_loop(std::string_view source, std::string_view array)
+  {
+    struct Block
+    {
+      std::string_view keyword;
+      bool messages_loop;
+    };
+
+    std::vector<Block> stack;
+    bool seen_loop = false;
+    bool in_loop = false;
+    SeparableLoop loop{};
+    std::unordered_set<std::string_view> used;     // Names read in the loop body so far
+    std::unordered_set<std::string_view> assigned; // Names set at the body's top level so far
+
+    auto innermost_for_is_loop = [&] {
+      for (auto it = stack.rbegin(); it != stack.rend(); ++it)
+      {
+        if (it->keyword == "for")
+        {
+          return it->messages_loop;
+        }
+      }
+      return false;
+    };
+
+    for (const auto &segment : scan_template(source))
+    {
+      if (segment.kind == TemplateSegment::Kind::Text || segment.kind == TemplateSegment::Kind::Comment)
+      {
+        continue;
+      }
+
+      auto tokens = tokenize_tag(segment.body);
+      size_t first = 0;
+
+      if (segment.kind == TemplateSegment::Kind::Statement && !tokens.empty())
+      {
+        std::string_view keyword = tokens[0].text;
+        first = 1;
+
+        if (keyword == "macro" || keyword == "call" || keyword == "include" || keyword == "import" ||
+            keyword == "from" || keyword == "extends" || keyword == "block")
+        {
+          return std::nullopt;
+        }
+
+        if (keyword == "for")
+        {
+          bool is_messages_loop = tokens.size() >= 4 && tokens[2].text == "in" && tokens[3].text == array;
+          if (is_messages_loop)
+          {
+            // Only `for x in messages`, optionally filtered by `if`. Filters, slices, subscripts and
+            // `recursive` change which messages the loop sees or their order, so appending a message
+            // would not just append its output.
+            bool plain = tokens.size() == 4 || (tokens[4].text == "if" && tokens.size() > 5);
+            if (seen_loop || !stack.empty() || tokens[1].kind != TemplateToken::Kind::Identifier || !plain)
+            {
+              return std::nullopt;
+            }
+            seen_loop = true;
+            in_loop = true;
+            loop.begin = segment.begin;
+            first = 4;
+          }
+          stack.push_back({keyword, is_messages_loop});
+        }
+        else if (keyword == "if" || keyword == "filter" || keyword == "generation")
+        {
+          stack.push_back({keyword, false});
+        }
+        else if (keyword == "set")
+        {
+          bool block_set = std::none_of(tokens.begin(), tokens.end(), [](const TemplateToken &t) { return t.text == "="; });
+          if (in_loop && innermost_for_is_loop())
+          {
+            bool at_body_top = !stack.empty() && stack.back().messages_loop;
+            auto equals = std::find_if(tokens.begin(), tokens.end(), [](const TemplateToken &t) { return t.text == "="; });
+            // Names the right-hand side reads, evaluated before the assignment happens.
+            std::unordered_set<std::string_view> reads;
+            for (auto it = equals; it != tokens.end(); ++it)
+            {
+              if (it->kind == TemplateToken::Kind::Identifier && (it == tokens.begin() || std::prev(it)->text != "."))
+              {
+                reads.insert(it->text);
+              }
+            }
+            for (size_t i = 1; i < tokens.size() && tokens[i].text != "="; ++i)
+            {
+              if (tokens[i].kind != TemplateToken::Kind::Identifier)
+              {
+                continue;
+              }
+              std::string_view name = tokens[i].text;
+              if (at_body_top)
+              {
+                // A name read earlier in the body, or by this set's own right-hand side
+                // (`n = (n or 0) + 1`), would see the previous iteration's value.
+                if ((used.count(name) || reads.count(name)) && !assigned.count(name))
+                {
+                  return std::nullopt;
+                }
+                assigned.insert(name);
+              }
+              else if (!assigned.count(name))
+              {
+                // Conditional assignment that is not reset at the start of every iteration.
+                return std::nullopt;
+              }
+            }
+          }
+          if (block_set)
+          {
+            stack.push_back({keyword, false});
+          }
+        }
+        else if (keyword == "else" || keyword == "elif")
+        {
+          if (!stack.empty() && stack.back().messages_loop)
+          {
+            return std::nullopt;
+          }
+        }
+        else if (keyword == "break")
+        {
+          if (in_loop && innermost_for_is_loop())
+          {
+            return std::nullopt;
+          }
+        }
+        else if (keyword == "endraw")
+        {
+          // The scanner already turned the raw block's contents into text; raw opens no block.
+        }
+        else if (keyword.substr(0, 3) == "end")
+        {
+          if (stack.empty())
+          {
+            return std::nullopt;
+          }
+          if (stack.back().messages_loop)
+          {
+            in_loop = false;
+            loop.end = segment.end;
+          }
+          stack.pop_back();
+        }
+      }
+
+      for (size_t i = first; i < tokens.size(); ++i)
+      {
+        const auto &token = tokens[i];
+        if (token.kind != TemplateToken::Kind::Identifier || (i > 0 && tokens[i - 1].text == "."))
+        {
+          continue; // Not a variable (attribute names are looked up on their object)
+        }
+        if (token.text == array || token.text == "namespace" || token.text == "strftime_now")
+        {
+          return std::nullopt;
+        }
+        if (in_loop)
+        {
+          if (token.text == "loop" && innermost_for_is_loop())
+          {
+            return std::nullopt;
+          }
+          used.insert(token.text);
+        }
+      }
+    }
+
+    if (!seen_loop || !stack.empty())
+    {
+      return std::nullopt;
+    }
+    return loop;
+  }
+
+  bool is_separable_chat_template(std::string_view source)
+  {
+    return find_separable_loop(source, "messages").has_value();
+  }
+
+  ChatSession::ChatSession(std::shared_ptr<ShimTemplate> tpl, minja::Value root)
+      : tpl_(std::move(tpl)), root_(root.is_null() ? minja::Value::object() : std::move(root))
+  {
+    if (!root_.is_object())
+    {
+      throw std::invalid_argument("Chat session root must be an object");
+    }
+
+    minja::Value key("messages");
+    if (root_.contains(key))
+    {
+      messages_ = root_.at(key);
+      if (!messages_.is_array())
+      {
+        throw std::invalid_argument("'messages' must be an array");
+      }
+    }
+    else
+    {
+      messages_ = minja::Value::array();
+      root_.set(key, messages_);
+    }
+
+    // The context shares root_'s object, so appended messages are visible to it.
+    base_ = minja::Context::make(minja::Value(root_), shim_builtins());
+    separable_ = is_separable_chat_template(tpl_->source);
+  }
+
+  void ChatSession::append(minja::Value &&message)
+  {
+    push_back_moved(messages_, std::move(message));
+  }
+
+  void ChatSession::set(const std::string &key, minja::Value &&value)
+  {
+    minja::Value name(key);
+    if (key == "messages" && !value.is_array())
+    {
+      throw std::invalid_argument("'messages' must be an array");
+    }
+    set_moved(root_, name, std::move(value));
+    if (key == "messages")
+    {
+      messages_ = root_.at(name);
+    }
+    output_valid_ = false;
+    empty_valid_ = false;
+  }
+
+  const std::string &ChatSession::render()
+  {
+    size_t count = messages_.size();
+    if (output_valid_ && count == rendered_count_)
+    {
+      return output_;
+    }
+
+    if (!(separable_ && output_valid_ && count > rendered_count_ && rendered_count_ > 0 && render_appended()))
+    {
+      render_full();
+    }
+    return output_;
+  }
+
+  void ChatSession::render_into(std::string &out, const minja::Value *messages)
+  {
+    // Render over a fresh overlay so top-level `set`s never leak into the shared root.
+    auto overlay = minja::Value::object();
+    if (messages)
+    {
+      overlay.set(minja::Value("messages"), *messages);
+    }
+    auto ctx = minja::Context::make(std::move(overlay), base_);
+
+    out.clear();
+    StringSink sink(out);
+    render_template(*tpl_, ctx, sink);
+  }
+
+  void ChatSession::render_full()
+  {
+    output_valid_ = false;
+    render_into(output_, nullptr);
+    rendered_count_ = messages_.size();
+    output_valid_ = true;
+  }
+
+  bool ChatSession::render_appended()
+  {
+    if (!empty_valid_)
+    {
+      auto none = minja::Value::array();
+      render_into(empty_output_, &none);
+      empty_valid_ = true;
+    }
+
+    size_t count = messages_.size();
+    auto tail = minja::Value::array();
+    for (size_t i = rendered_count_; i < count; ++i)
+    {
+      tail.push_back(messages_.at(i));
+    }
+    std::string tail_output;
+    render_into(tail_output, &tail);
+
+    // The empty render is header + footer. Find a split of it that prefixes the tail render and
+    // suffixes both renders; the previous output minus the footer plus the tail render minus the
+    // header is then the full render. Any split that satisfies both conditions gives the same result.
+    const std::string &empty = empty_output_;
+    auto ends_with = [](const std::string &s, std::string_view suffix) {
+      return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    size_t prefix = 0;
+    while (prefix < empty.size() && prefix < tail_output.size() && empty[prefix] == tail_output[prefix])
+    {
+      ++prefix;
+    }
+    for (size_t header = prefix + 1; header-- > 0;)
+    {
+      std::string_view footer = std::string_view(empty).substr(header);
+      if (tail_output.size() >= empty.size() && ends_with(tail_output, footer) && ends_with(output_, footer))
+      {
+        output_.resize(output_.size() - footer.size());
+        output_.append(tail_output, header, std::string::npos);
+        rendered_count_ = count;
+        return true;
+      }
+    }
+    return false;
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,74 @@
+#pragma once
+#include "handles.h"
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace minja_shim_ext_internal
+{
+  // True when a lexical scan shows that the template renders `messages` as
+  //   header + body(messages[0]) + ... + body(messages[n-1]) + footer
+  // with header and footer independent of the messages and each body depending only on its own
+  // message. That holds when the template has exactly one top-level `for <name> in messages` loop
+  // (optionally with an `if` condition, but no filters, slices or `recursive`), mentions `messages`
+  // nowhere else, and the loop body
+  //   - does not read `loop` (index, first, last, ...),
+  //   - only uses `set` at its own top level, before any other use of the name, including by the
+  //     set's own right-hand side (variables set in the body survive into the next iteration),
+  //   - has no `else` branch.
+  // Templates using namespace(), macros, call blocks or strftime_now are treated as not separable.
+  // The check is conservative: anything it cannot classify is reported as not separable.
+  bool is_separable_chat_template(std::string_view source);
+
+  // Source range of a separable loop, from the start of its `for` tag to the end of its `endfor`.
+  struct SeparableLoop
+  {
+    size_t begin;
+    size_t end;
+  };
+
+  // The same analysis for a loop over any top-level array. Returns the loop's range when the
+  // template renders `array` element by element, nullopt otherwise.
+  std::optional<SeparableLoop> find_separable_loop(std::string_view source, std::string_view array);
+
+  // Holds a chat context and the output of its last render. While messages are only appended to a
+  // separable template, a render covers just the new messages and splices them into the previous
+  // output; anything else falls back to a full render. Not thread-safe.
+  class ChatSession
+  {
+  public:
+    ChatSession(std::shared_ptr<ShimTemplate> tpl, minja::Value root);
+
+    // Appends a message. The session shares the value, so it must not be modified afterwards.
+    void append(minja::Value &&message);
+
+    // Replaces a top-level variable, which invalidates the retained output.
+    void set(const std::string &key, minja::Value &&value);
+
+    // Renders the conversation. The returned string stays valid until the next call on the session.
+    const std::string &render();
+
+    bool incremental() const { return separable_; }
+
+  private:
+    void render_into(std::string &out, const minja::Value *messages);
+    void render_full();
+    bool render_appended();
+
+    std::shared_ptr<ShimTemplate> tpl_;
+    minja::Value root_;
+    minja::Value messages_; // Shares the array stored under root_["messages"]
+    std::shared_ptr<minja::Context> base_;
+    bool separable_;
+
+    std::string output_;
+    size_t rendered_count_ = 0;
+    bool output_valid_ = false;
+
+    // Output for an empty conversation: the header followed by the footer.
+    std::string empty_output_;
+    bool empty_valid_ = false;
+  };
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,175 @@
+#include "context_path.h"
+#include "value_buffer.h"
+#include <cstdint>
+#include <vector>
+
+namespace minja_shim_ext_internal
+{
+  namespace
+  {
+    // Context keeps its own variables in a protected member with no accessor. Naming it through a
+    // derived class yields a member pointer that applies to any Context.
+    struct ContextValues : minja::Context
+    {
+      static minja::Value &of(minja::Context &ctx) { return ctx.*(&ContextValues::values_); }
+    };
+
+    std::vector<std::string_view> split_path(std::string_view path)
+    {
+      std::vector<std::string_view> segments;
+      size_t start = 0;
+      while (true)
+      {
+        size_t dot = path.find('.', start);
+        auto segment = path.substr(start, dot == std::string_view::npos ? std::string_view::npos : dot - start);
+        if (segment.empty())
+        {
+          throw ContextPathError("empty segment in path '" + std::string(path) + "'");
+        }
+        segments.push_back(segment);
+        if (dot == std::string_view::npos)
+        {
+          return segments;
+        }
+        start = dot + 1;
+      }
+    }
+
+    size_t parse_index(const minja::Value &array, std::string_view segment)
+    {
+      size_t index = 0;
+      for (char c : segment)
+      {
+        if (c < '0' || c > '9' || index > (SIZE_MAX - 9) / 10)
+        {
+          throw ContextPathError("'" + std::string(segment) + "' is not an array index");
+        }
+        index = index * 10 + static_cast<size_t>(c - '0');
+      }
+      if (index >= array.size())
+      {
+        throw ContextPathError("index " + std::string(segment) + " is out of range for an array of " + std::to_string(array.size()));
+      }
+      return index;
+    }
+
+    minja::Value &variable(minja::Context &ctx, std::string_view name)
+    {
+      auto &values = ContextValues::of(ctx);
+      std::string key(name);
+      if (!values.contains(key))
+      {
+        // Lazy contexts fetch the variable into their own values on lookup.
+        bool defined = ctx.contains(minja::Value(key));
+        if (!values.contains(key))
+        {
+          throw ContextPathError(defined ? "'" + key + "' is defined by a parent context and cannot be edited through this one"
+                                         : "'" + key + "' is not defined");
+        }
+      }
+      return values.at(minja::Value(key));
+    }
+
+    minja::Value &child(minja::Value &container, std::string_view segment)
+    {
+      if (container.is_object())
+      {
+        std::string key(segment);
+        if (!container.contains(key))
+        {
+          throw ContextPathError("no member '" + key + "'");
+        }
+        return container.at(minja::Value(key));
+      }
+      if (container.is_array())
+      {
+        return container.at(parse_index(container, segment));
+      }
+      throw ContextPathError("'" + std::string(segment) + "' is inside a value that is not an object or array");
+    }
+
+    // The value reached by the first `count` segments.
+    minja::Value &resolve(minja::Context &ctx, const std::vector<std::string_view> &segments, size_t count)
+    {
+      minja::Value *current = &variable(ctx, segments[0]);
+      for (size_t i = 1; i < count; ++i)
+      {
+        current = &child(*current, segments[i]);
+      }
+      return *current;
+    }
+  } // namespace
+
+  void context_set_path(minja::Context &ctx, std::string_view path, minja::Value &&value)
+  {
+    auto segments = split_path(path);
+    if (segments.size() == 1)
+    {
+      // Through the context, so a lazy context stops asking the host for this name.
+      ctx.set(minja::Value(std::string(segments[0])), value);
+      return;
+    }
+
+    auto &parent = resolve(ctx, segments, segments.size() - 1);
+    auto last = segments.back();
+    if (parent.is_object())
+    {
+      set_moved(parent, minja::Value(std::string(last)), std::move(value));
+    }
+    else if (parent.is_array())
+    {
+      parent.at(parse_index(parent, last)) = std::move(value);
+    }
+    else
+    {
+      throw ContextPathError("'" + std::string(last) + "' is inside a value that is not an object or array");
+    }
+  }
+
+  void context_append(minja::Context &ctx, std::string_view path, minja::Value &&value)
+  {
+    auto segments = split_path(path);
+    auto &target = resolve(ctx, segments, segments.size());
+    if (!target.is_array())
+    {
+      throw ContextPathError("'" + std::string(path) + "' is not an array");
+    }
+    push_back_moved(target, std::move(value));
+  }
+
+  void context_remove_path(minja::Context &ctx, std::string_view path)
+  {
+    auto segments = split_path(path);
+    if (segments.size() == 1)
+    {
+      auto &values = ContextValues::of(ctx);
+      std::string key(segments[0]);
+      if (!values.contains(key))
+      {
+        throw ContextPathError("'" + key + "' is not defined by this context");
+      }
+      values.erase(key);
+      return;
+    }
+
+    auto &parent = resolve(ctx, segments, segments.size() - 1);
+    auto last = segments.back();
+    if (parent.is_object())
+    {
+      std::string key(last);
+      if (!parent.contains(key))
+      {
+        throw ContextPathError("no member '" + key + "'");
+      }
+      parent.erase(key);
+    }
+    else if (parent.is_array())
+    {
+      parent.erase(parse_index(parent, last));
+    }
+    else
+    {
+      throw ContextPathError("'" + std::string(last) + "' is inside a value that is not an object or array");
+    }
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,33 @@
+#pragma once
+#include <minja/minja.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace minja_shim_ext_internal
+{
+  // Raised for a path that is empty, malformed or does not lead to a value that can be changed.
+  struct ContextPathError : std::invalid_argument
+  {
+    explicit ContextPathError(const std::string &message) : std::invalid_argument(message) {}
+  };
+
+  // In-place edits of a context's variables, addressed by a dotted path: the first segment names a
+  // variable, later segments are object keys or array indices ("messages.3.content"). Values are
+  // moved into place, so appending to a long history costs the same as appending to a short one.
+  //
+  // Only variables the context defines itself can be reached through a path. Paths into a variable
+  // that comes from a base context (mj_context_derive) or the builtins are rejected rather than
+  // writing into the shared parent; a single-segment set still shadows such a variable. Lazy
+  // contexts fetch a variable from the host before editing inside it.
+  //
+  // Sets the value at `path`, adding the last key to its object or replacing an existing array
+  // element. Intermediate segments must exist.
+  void context_set_path(minja::Context &ctx, std::string_view path, minja::Value &&value);
+
+  // Appends to the array at `path`.
+  void context_append(minja::Context &ctx, std::string_view path, minja::Value &&value);
+
+  // Removes the object member or array element at `path`.
+  void context_remove_path(minja::Context &ctx, std::string_view path);
+} // namespace minja_shim_ext_internal
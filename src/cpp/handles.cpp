@@ -0,0 +1,67 @@
+#include "handles.h"
+
+namespace minja_shim_ext_internal
+{
+  ValueHandle *new_value_handle(minja::Value &&value)
+  {
+    auto handle = new ValueHandle{std::move(value)};
+    if (stats_enabled())
+    {
+      handle->counted = true;
+      ShimStats::instance().live_values.fetch_add(1, std::memory_order_relaxed);
+    }
+    init_digest(*handle);
+    return handle;
+  }
+
+  ContextHandle *new_context_handle(std::shared_ptr<minja::Context> context)
+  {
+    auto handle = new ContextHandle{std::move(context)};
+    if (stats_enabled())
+    {
+      handle->counted = true;
+      ShimStats::instance().live_contexts.fetch_add(1, std::memory_order_relaxed);
+    }
+    return handle;
+  }
+
+  void *new_template_handle(std::shared_ptr<ShimTemplate> tpl)
+  {
+    auto handle = new std::shared_ptr<ShimTemplate>(std::move(tpl));
+    ShimStats::instance().live_templates.fetch_add(1, std::memory_order_relaxed);
+    return handle;
+  }
+
+  void free_value_handle(ValueHandle *handle)
+  {
+    if (handle)
+    {
+      if (handle->counted)
+      {
+        ShimStats::instance().live_values.fetch_sub(1, std::memory_order_relaxed);
+      }
+      delete handle;
+    }
+  }
+
+  void free_context_handle(ContextHandle *handle)
+  {
+    if (handle)
+    {
+      if (handle->counted)
+      {
+        ShimStats::instance().live_contexts.fetch_sub(1, std::memory_order_relaxed);
+      }
+      delete handle;
+    }
+  }
+
+  void free_template_handle(void *handle)
+  {
+    if (handle)
+    {
+      ShimStats::instance().live_templates.fetch_sub(1, std::memory_order_relaxed);
+      delete static_cast<std::shared_ptr<ShimTemplate> *>(handle);
+    }
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,142 @@
+#pragma once
+#include "print_filter.h"
+#include "render_sink.h"
+#include "shim_stats.h"
+#include "template_analysis.h"
+#include "value_digest.h"
+#include <minja/minja.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace minja_shim_ext_internal
+{
+  // Objects behind the opaque value and context handles of the C API. `counted` is set when the
+  // handle was included in the live handle gauge.
+  // `digest` is the value's structural hash while it is known, and `digest_shared` is set once
+  // other handles or contexts may change the value (see value_digest.h).
+  struct ValueHandle
+  {
+    minja::Value value;
+    bool counted = false;
+    ValueDigest digest{};
+    bool digest_shared = false;
+  };
+
+  struct ContextHandle
+  {
+    std::shared_ptr<minja::Context> context;
+    bool counted = false;
+  };
+
+  // Parsed template behind a template handle. Handles returned for the same cached source share
+  // one instance, and so share its statistics.
+  struct ShimTemplate
+  {
+    std::shared_ptr<minja::TemplateNode> root;
+    std::string source;
+    // Keyed digest of `source`; identifies the template in the result cache.
+    ValueDigest source_digest{};
+    // The source mentions strftime_now, so its output can change with the date alone and must not
+    // be served from the result cache.
+    bool reads_clock = false;
+    // The source calls a method that edits a value in place (`.append()`, `.update()`, ...) or
+    // sets an attribute, so a render can change the value it reads.
+    bool edits_values = false;
+    RenderCounters stats;
+    uint64_t parse_ns = 0;
+    // Running estimate of the output size, used to reserve string capacity before rendering.
+    std::atomic<size_t> output_hint{0};
+  };
+
+  inline std::shared_ptr<ShimTemplate> parse_template(std::string source)
+  {
+    StatsTimer timer;
+    auto tpl = std::make_shared<ShimTemplate>();
+    try
+    {
+      tpl->root = parse_printing(source);
+    }
+    catch (...)
+    {
+      ShimStats::instance().record_parse(timer, false);
+      throw;
+    }
+    tpl->parse_ns = ShimStats::instance().record_parse(timer, true);
+    tpl->source_digest = minja_shim_ext_internal::source_digest(source);
+    tpl->reads_clock = source.find("strftime_now") != std::string::npos;
+    tpl->edits_values = may_edit_values(source);
+    tpl->source = std::move(source);
+    return tpl;
+  }
+
+  // Render a parsed template into a sink, recording the render in the process-wide and
+  // per-template statistics when collection is on. Error locations refer to the template source
+  // as written, not to its print-filtered form.
+  inline void render_template(ShimTemplate &tpl, const std::shared_ptr<minja::Context> &ctx, RenderSink &sink)
+  {
+    StatsTimer timer;
+    size_t before = sink.bytes_written();
+    try
+    {
+      render_to_sink(tpl.root, ctx, sink);
+    }
+    catch (...)
+    {
+      if (timer.active())
+      {
+        uint64_t ns = timer.elapsed_ns();
+        ShimStats::instance().renders().record(ns, 0, false);
+        tpl.stats.record(ns, 0, false);
+      }
+      rethrow_located(tpl.source);
+    }
+    if (!timer.active())
+    {
+      return;
+    }
+    uint64_t ns = timer.elapsed_ns();
+    size_t bytes = sink.bytes_written() - before;
+    ShimStats::instance().renders().record(ns, bytes, true);
+    tpl.stats.record(ns, bytes, true);
+  }
+
+  // Render a parsed template into a string, reserving the template's typical output size up
+  // front instead of growing the string by repeated reallocation. The estimate is a running
+  // average that weighs the newest render by 1/4.
+  inline void render_to_string(ShimTemplate &tpl, const std::shared_ptr<minja::Context> &ctx, std::string &output)
+  {
+    size_t hint = tpl.output_hint.load(std::memory_order_relaxed);
+    output.reserve(output.size() + hint + hint / 4);
+    StringSink sink(output);
+    render_template(tpl, ctx, sink);
+    size_t bytes = sink.bytes_written();
+    tpl.output_hint.store(hint ? hint - hint / 4 + bytes / 4 : bytes, std::memory_order_relaxed);
+  }
+
+  // Template handles are heap-allocated shared pointers, so handles for one cached source can
+  // share a template.
+  void *new_template_handle(std::shared_ptr<ShimTemplate> tpl);
+  void free_template_handle(void *handle);
+
+  // Value and context handles are heap-allocated; these also keep the live handle gauges.
+  ValueHandle *new_value_handle(minja::Value &&value);
+  ContextHandle *new_context_handle(std::shared_ptr<minja::Context> context);
+  void free_value_handle(ValueHandle *handle);
+  void free_context_handle(ContextHandle *handle);
+
+  inline const std::shared_ptr<ShimTemplate> &template_of(void *handle)
+  {
+    return *static_cast<std::shared_ptr<ShimTemplate> *>(handle);
+  }
+
+  inline minja::Value &value_of(void *handle)
+  {
+    return static_cast<ValueHandle *>(handle)->value;
+  }
+
+  inline const std::shared_ptr<minja::Context> &context_of(void *handle)
+  {
+    return static_cast<ContextHandle *>(handle)->context;
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,101 @@
+#include "json_reader.h"
+#include "value_buffer.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace minja_shim_ext_internal
+{
+  namespace
+  {
+    // Receives nlohmann's SAX events and assembles the Value tree bottom-up. Finished scalars
+    // and containers are moved into their parent, so no node is copied.
+    class ValueSax
+    {
+    public:
+      using number_integer_t = minja::json::number_integer_t;
+      using number_unsigned_t = minja::json::number_unsigned_t;
+      using number_float_t = minja::json::number_float_t;
+      using string_t = minja::json::string_t;
+      using binary_t = minja::json::binary_t;
+
+      bool null() { return add(minja::Value()); }
+      bool boolean(bool b) { return add(minja::Value(b)); }
+      bool number_integer(number_integer_t i) { return add(minja::Value(static_cast<int64_t>(i))); }
+      bool number_unsigned(number_unsigned_t u) { return add(minja::Value(minja::json(u))); }
+      bool number_float(number_float_t d, const string_t &) { return add(minja::Value(static_cast<double>(d))); }
+      bool string(string_t &s) { return add(minja::Value(std::move(s))); }
+      bool binary(binary_t &) { return false; } // Not produced by the JSON input format
+
+      bool start_object(std::size_t)
+      {
+        stack_.push_back({minja::Value::object(), minja::Value()});
+        return true;
+      }
+
+      bool key(string_t &k)
+      {
+        stack_.back().key = minja::Value(std::move(k));
+        return true;
+      }
+
+      bool end_object() { return close(); }
+
+      bool start_array(std::size_t)
+      {
+        stack_.push_back({minja::Value::array(), minja::Value()});
+        return true;
+      }
+
+      bool end_array() { return close(); }
+
+      bool parse_error(std::size_t, const std::string &, const minja::json::exception &e)
+      {
+        throw JsonReadError(e.what());
+      }
+
+      minja::Value take_result() { return std::move(result_); }
+
+    private:
+      struct Frame
+      {
+        minja::Value container;
+        minja::Value key; // Pending key while filling an object
+      };
+
+      bool add(minja::Value &&value)
+      {
+        if (stack_.empty())
+        {
+          result_ = std::move(value);
+        }
+        else if (stack_.back().container.is_array())
+        {
+          push_back_moved(stack_.back().container, std::move(value));
+        }
+        else
+        {
+          set_moved(stack_.back().container, stack_.back().key, std::move(value));
+        }
+        return true;
+      }
+
+      bool close()
+      {
+        minja::Value finished = std::move(stack_.back().container);
+        stack_.pop_back();
+        return add(std::move(finished));
+      }
+
+      std::vector<Frame> stack_;
+      minja::Value result_;
+    };
+  } // namespace
+
+  minja::Value read_json_value(std::string_view utf8)
+  {
+    ValueSax sax;
+    minja::json::sax_parse(utf8.data(), utf8.data() + utf8.size(), &sax);
+    return sax.take_result();
+  }
+} // namespace minja_shim_ext_internal
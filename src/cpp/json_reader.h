@@ -0,0 +1,18 @@
+#pragma once
+#include <minja/minja.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace minja_shim_ext_internal
+{
+  // Raised when JSON input is malformed; the message carries nlohmann's position details.
+  struct JsonReadError : std::runtime_error
+  {
+    explicit JsonReadError(const std::string &message) : std::runtime_error(message) {}
+  };
+
+  // Parses UTF-8 JSON straight into a minja::Value from SAX events, without building an
+  // intermediate nlohmann::json document. Object keys keep their document order.
+  minja::Value read_json_value(std::string_view utf8);
+} // namespace minja_shim_ext_internal
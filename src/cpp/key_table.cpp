@@ -0,0 +1,50 @@
+#include "key_table.h"
+#include <stdexcept>
+
+namespace minja_shim_ext_internal
+{
+  KeyTable &KeyTable::instance()
+  {
+    // Never destroyed: ids handed out stay valid until the process exits.
+    static KeyTable *table = new KeyTable();
+    return *table;
+  }
+
+  uint32_t KeyTable::intern(std::string_view key)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string name(key);
+    auto it = ids_.find(name);
+    if (it != ids_.end())
+    {
+      return it->second;
+    }
+
+    uint32_t id = count_.load(std::memory_order_relaxed);
+    if (id == kMaxKeys)
+    {
+      throw std::length_error("Interned key table is full");
+    }
+    auto &chunk = chunks_[id >> kChunkBits];
+    minja::Value *keys = chunk.load(std::memory_order_relaxed);
+    if (!keys)
+    {
+      keys = new minja::Value[kChunkSize];
+      chunk.store(keys, std::memory_order_relaxed);
+    }
+    keys[id & (kChunkSize - 1)] = minja::Value(name);
+    ids_.emplace(std::move(name), id);
+    // Publishes the key (and its chunk) to readers that see the new count.
+    count_.store(id + 1, std::memory_order_release);
+    return id;
+  }
+
+  const minja::Value *KeyTable::find(uint32_t id) const
+  {
+    if (id >= count_.load(std::memory_order_acquire))
+    {
+      return nullptr;
+    }
+    return chunks_[id >> kChunkBits].load(std::memory_order_relaxed) + (id & (kChunkSize - 1));
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,48 @@
+#pragma once
+#include <minja/minja.hpp>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace minja_shim_ext_internal
+{
+  // Process-wide table of interned object keys. Each key string is turned into a minja::Value once
+  // and afterwards referred to by a small id, so hot keys ("role", "content", property names) are
+  // not rebuilt from C strings for every object they appear in. Entries live until the process
+  // exits, so only bounded sets of names should be interned, not keys taken from data.
+  //
+  // minja stores object keys inside its own ordered map, so an insert still copies the key into
+  // the object; short keys stay within the string's inline buffer and do not allocate.
+  class KeyTable
+  {
+  public:
+    static constexpr uint32_t kMaxKeys = uint32_t(1) << 20;
+
+    static KeyTable &instance();
+
+    // Returns the id of `key`, adding it on first use. Thread-safe. Throws std::length_error once
+    // kMaxKeys keys have been interned.
+    uint32_t intern(std::string_view key);
+
+    // The key for an id returned by intern, or nullptr for an unknown id. Lock-free.
+    const minja::Value *find(uint32_t id) const;
+
+  private:
+    static constexpr uint32_t kChunkBits = 10;
+    static constexpr uint32_t kChunkSize = uint32_t(1) << kChunkBits;
+
+    KeyTable() = default;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, uint32_t> ids_;
+    // Keys are stored in fixed-size chunks that never move, so readers need no lock.
+    std::array<std::atomic<minja::Value *>, kMaxKeys / kChunkSize> chunks_{};
+    std::atomic<uint32_t> count_{0};
+  };
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,75 @@
+#include "lazy_context.h"
+#include "handles.h"
+#include "tojson_filter.h"
+#include <stdexcept>
+
+namespace minja_shim_ext_internal
+{
+  LazyContext::LazyContext(const mj_lazy_vtable &vtable, void *user_data)
+      : minja::Context(minja::Value::object(), shim_builtins()), vtable_(vtable), user_data_(user_data)
+  {
+  }
+
+  LazyContext::~LazyContext()
+  {
+    if (owns_user_data_ && vtable_.release)
+    {
+      vtable_.release(user_data_);
+    }
+  }
+
+  void LazyContext::fetch(const minja::Value &key)
+  {
+    if (!key.is_string())
+    {
+      return;
+    }
+    auto name = key.get<std::string>();
+    if (resolved_.count(name))
+    {
+      return;
+    }
+
+    void *handle = nullptr;
+    int code = vtable_.get(user_data_, name.data(), name.size(), &handle);
+    if (code != MJ_OK)
+    {
+      throw std::runtime_error("Host callback failed to provide variable '" + name + "' (code " + std::to_string(code) + ")");
+    }
+    if (handle)
+    {
+      auto value = static_cast<ValueHandle *>(handle);
+      values_.set(key, std::move(value->value));
+      free_value_handle(value);
+    }
+    resolved_.insert(std::move(name));
+  }
+
+  minja::Value LazyContext::get(const minja::Value &key)
+  {
+    fetch(key);
+    return minja::Context::get(key);
+  }
+
+  minja::Value &LazyContext::at(const minja::Value &key)
+  {
+    fetch(key);
+    return minja::Context::at(key);
+  }
+
+  bool LazyContext::contains(const minja::Value &key)
+  {
+    fetch(key);
+    return minja::Context::contains(key);
+  }
+
+  void LazyContext::set(const minja::Value &key, const minja::Value &value)
+  {
+    // A variable set by the template shadows the host's for the rest of the render.
+    if (key.is_string())
+    {
+      resolved_.insert(key.get<std::string>());
+    }
+    minja::Context::set(key, value);
+  }
+} // namespace minja_shim_ext_internal
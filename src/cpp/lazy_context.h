@@ -0,0 +1,41 @@
+#pragma once
+#include "minja_shim_ext.h"
+#include <minja/minja.hpp>
+#include <string>
+#include <unordered_set>
+
+namespace minja_shim_ext_internal
+{
+  // Context whose top-level variables come from a host callback. A name is requested the first
+  // time the template looks it up and is kept afterwards, so a variable the template never reads
+  // is never marshalled. Names the host does not define, and anything not found, fall through to
+  // the parent (the builtins).
+  //
+  // minja values are concrete types without extension points, so laziness stops at the top level:
+  // a fetched variable is a complete value tree.
+  //
+  // Lookups can insert variables, so a lazy context is not safe for concurrent use, including as
+  // the base of derived contexts rendered on several threads.
+  class LazyContext : public minja::Context
+  {
+  public:
+    LazyContext(const mj_lazy_vtable &vtable, void *user_data);
+    ~LazyContext() override;
+
+    // Hands user_data over to the context, which passes it to the release callback when it is destroyed.
+    void take_ownership() { owns_user_data_ = true; }
+
+    minja::Value get(const minja::Value &key) override;
+    minja::Value &at(const minja::Value &key) override;
+    bool contains(const minja::Value &key) override;
+    void set(const minja::Value &key, const minja::Value &value) override;
+
+  private:
+    void fetch(const minja::Value &key);
+
+    mj_lazy_vtable vtable_;
+    void *user_data_;
+    bool owns_user_data_ = false;
+    std::unordered_set<std::string> resolved_; // Names already requested from the host or set by the template
+  };
+} // namespace minja_shim_ext_internal
@@ -1,9 +1,28 @@
 #include "minja_shim_ext.h" 
+#include "value_buffer.h"
+#include "chat_session.h"
+#include "context_path.h"
+#include "handles.h"
+#include "json_reader.h"
+#include "key_table.h"
+#include "lazy_context.h"
+#include "render_budget.h"
+#include "render_sink.h"
+#include "render_spans.h"
+#include "result_cache.h"
+#include "shim_stats.h"
+#include "template_analysis.h"
+#include "template_cache.h"
+#include "thread_pool.h"
+#include "tojson_filter.h"
 #include <minja/minja.hpp>
 #include <cstdlib>
 #include <cstring>
 #include <nlohmann/json.hpp>
+#include <algorithm>
 #include <exception>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <utility>  // For std::move
@@ -46,25 +65,137 @@ namespace minja_shim_ext_internal
 // Utility functions (kept in anonymous namespace as they are local to this file)
 namespace
 {
-  // Convert a string to use lowercase boolean values (true/false instead of True/False)
-  std::string convert_boolean_representation(const std::string &input)
+  using minja_shim_ext_internal::RenderSink;
+  using minja_shim_ext_internal::record_error;
+  using minja_shim_ext_internal::render_template;
+  using minja_shim_ext_internal::render_to_string;
+
+  // Writes rendered output straight into caller-owned memory.
+  // Once the buffer is full it keeps counting, so the caller learns the size it needs.
+  class FixedBufferSink : public RenderSink
   {
-    std::string result = input;
-    size_t pos = result.find("True");
-    while (pos != std::string::npos)
+  public:
+    FixedBufferSink(char *data, size_t capacity) : data_(data), capacity_(capacity) {}
+
+    size_t size() const { return size_; }
+    bool fits() const { return size_ <= capacity_; }
+
+  protected:
+    void write(const char *s, size_t n) override
     {
-      result.replace(pos, 4, "true");
-      pos = result.find("True", pos + 4);
+      if (size_ < capacity_)
+      {
+        std::memcpy(data_ + size_, s, std::min(n, capacity_ - size_));
+      }
+      size_ += n;
     }
-    pos = result.find("False");
-    while (pos != std::string::npos)
+
+  private:
+    char *data_;
+    size_t capacity_;
+    size_t size_ = 0;
+  };
+
+  // Thrown by ChunkSink when the host callback asks to stop rendering.
+  struct SinkAborted : std::runtime_error
+  {
+    SinkAborted() : std::runtime_error("Output callback aborted the render") {}
+  };
+
+  // Batches rendered output into fixed-size chunks and hands each one to a host callback.
+  // Only one chunk is ever held in memory.
+  class ChunkSink : public RenderSink
+  {
+  public:
+    static constexpr size_t kDefaultChunkSize = 4096;
+    static constexpr size_t kMaxChunkSize = size_t(1) << 26;
+
+    ChunkSink(mj_chunk_sink_fn sink_fn, void *user_data, size_t chunk_size)
+        : sink_fn_(sink_fn), user_data_(user_data),
+          buffer_(chunk_size ? std::min(chunk_size, kMaxChunkSize) : kDefaultChunkSize)
     {
-      result.replace(pos, 5, "false");
-      pos = result.find("False", pos + 5);
     }
-    return result;
+
+    bool aborted() const { return aborted_; }
+
+    // Emit whatever is still buffered.
+    void finish() { flush(); }
+
+  protected:
+    void write(const char *s, size_t n) override
+    {
+      while (n > 0)
+      {
+        if (used_ == buffer_.size())
+        {
+          flush();
+        }
+        size_t count = std::min(n, buffer_.size() - used_);
+        std::memcpy(buffer_.data() + used_, s, count);
+        used_ += count;
+        s += count;
+        n -= count;
+      }
+    }
+
+  private:
+    void flush()
+    {
+      if (used_ > 0 && sink_fn_(buffer_.data(), used_, user_data_) != 0)
+      {
+        aborted_ = true;
+        throw SinkAborted();
+      }
+      used_ = 0;
+    }
+
+    mj_chunk_sink_fn sink_fn_;
+    void *user_data_;
+    std::vector<char> buffer_;
+    size_t used_ = 0;
+    bool aborted_ = false;
+  };
+
+  // Per-thread output buffer handed out by the _retained renders.
+  thread_local std::string g_retained_output;
+
+  // Capacity the retained buffer may keep between renders. One oversized render would otherwise pin
+  // its allocation on the thread for as long as the thread lives.
+  constexpr size_t kRetainedOutputCap = size_t(1) << 20;
+
+  // Buffer for a retained render, emptied. clear() keeps the capacity from earlier renders on
+  // this thread, up to kRetainedOutputCap; a larger buffer is released here, once the previous
+  // output is no longer valid.
+  std::string &retained_output()
+  {
+    if (g_retained_output.capacity() > kRetainedOutputCap)
+    {
+      std::string().swap(g_retained_output);
+    }
+    g_retained_output.clear();
+    return g_retained_output;
   }
 
+  // Spans of the last mj_render_ctx_spans call on this thread.
+  thread_local minja_shim_ext_internal::SpanLayout g_span_layout;
+
+  // State behind a renderer handle. The output string keeps its capacity between renders, so
+  // once it has grown to the largest output its owner renders, rendering stops allocating it.
+  struct Renderer
+  {
+    std::string output;
+  };
+
+  // Owns everything a finished batch exposes through mj_batch_result.
+  struct BatchResult
+  {
+    std::string data;
+    std::vector<size_t> offsets;
+    std::vector<int> codes;
+    std::vector<std::string> errors;
+    size_t failed = 0;
+  };
+
   // Allocate and return a C-string. Returns nullptr on allocation failure.
   char *create_c_string(const std::string &str)
   {
@@ -82,7 +213,7 @@ namespace
   int create_value_helper(Func f, void** out_value_handle, const char* func_name) {
       if (!out_value_handle) {
           minja_shim_ext_internal::set_last_error(std::string(func_name) + ": Output parameter 'out_value_handle' is null.");
-          return MJ_ERROR_INVALID_ARGUMENT;
+          return record_error(MJ_ERROR_INVALID_ARGUMENT);
       }
       *out_value_handle = nullptr;
       minja_shim_ext_internal::clear_last_error();
@@ -93,18 +224,18 @@ namespace
                // Other `new Value(...)` could fail by throwing bad_alloc.
                // If `new` itself returns `nullptr` (non-standard but possible with `nothrow`), this would catch it.
                minja_shim_ext_internal::format_and_set_error(func_name, "Allocation failed (new returned null)");
-               return MJ_ERROR_ALLOCATION_FAILED;
+               return record_error(MJ_ERROR_ALLOCATION_FAILED);
           }
           return MJ_OK;
       } catch (const std::bad_alloc& e) {
           minja_shim_ext_internal::format_and_set_error(func_name, e.what());
-          return MJ_ERROR_ALLOCATION_FAILED;
+          return record_error(MJ_ERROR_ALLOCATION_FAILED);
       } catch (const std::exception& e) {
           minja_shim_ext_internal::format_and_set_error(func_name, e.what());
-          return MJ_ERROR;
+          return record_error(MJ_ERROR);
       } catch (...) {
           minja_shim_ext_internal::format_and_set_error(func_name, "Unknown exception occurred");
-          return MJ_ERROR;
+          return record_error(MJ_ERROR);
       }
   }
 } // namespace
@@ -137,7 +268,7 @@ extern "C"
         // We can't use format_and_set_error safely if we don't know if g_last_error_message itself is safe.
         // However, for consistency, we'll try.
         minja_shim_ext_internal::set_last_error("mj_parse: Output parameter 'out_template_handle' is null.");
-        return MJ_ERROR_INVALID_ARGUMENT;
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
     }
     *out_template_handle = nullptr;
     minja_shim_ext_internal::clear_last_error();
@@ -145,32 +276,30 @@ extern "C"
     if (!tmpl_str)
     {
       minja_shim_ext_internal::format_and_set_error("mj_parse: Input template string is null");
-      return MJ_ERROR_INVALID_ARGUMENT;
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
     }
 
     try
     {
-      auto options = Options{};
-      auto tpl = Parser::parse(tmpl_str, options);
-      // The void* handle stores a pointer to a heap-allocated std::shared_ptr<TemplateNode>
-      *out_template_handle = new std::shared_ptr<TemplateNode>(tpl); 
+      auto tpl = minja_shim_ext_internal::parse_template(tmpl_str);
+      *out_template_handle = minja_shim_ext_internal::new_template_handle(std::move(tpl));
       return MJ_OK;
     }
     catch (const std::bad_alloc &e)
     {
       minja_shim_ext_internal::format_and_set_error("mj_parse: Allocation failed", e.what());
-      return MJ_ERROR_ALLOCATION_FAILED;
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
     }
     catch (const std::exception &e)
     {
       // Handle all parse errors with the same exception type, since we can't rely on parse_error being accessible
       minja_shim_ext_internal::format_and_set_error("mj_parse: Template parsing failed", e.what());
-      return MJ_ERROR_TEMPLATE_PARSE;
+      return record_error(MJ_ERROR_TEMPLATE_PARSE);
     }
     catch (...)
     {
       minja_shim_ext_internal::format_and_set_error("mj_parse: Unknown exception occurred");
-      return MJ_ERROR;
+      return record_error(MJ_ERROR);
     }
   }
 
@@ -178,14 +307,143 @@ extern "C"
   {
     try
     {
-      if (template_handle)
+      minja_shim_ext_internal::free_template_handle(template_handle);
+    }
+    catch (...)
+    {
+      // Ignore exceptions during cleanup as per original design
+    }
+  }
+
+  SHIM_EXPORT int mj_parse_cached(const char *tmpl_str, size_t length, void **out_template_handle)
+  {
+    if (!out_template_handle) {
+        minja_shim_ext_internal::set_last_error("mj_parse_cached: Output parameter 'out_template_handle' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_template_handle = nullptr;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!tmpl_str && length > 0)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_parse_cached: Input template string is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto tpl = minja_shim_ext_internal::TemplateCache::instance().get_or_parse(std::string_view(tmpl_str ? tmpl_str : "", length));
+      *out_template_handle = minja_shim_ext_internal::new_template_handle(std::move(tpl));
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_parse_cached: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_parse_cached: Template parsing failed", e.what());
+      return record_error(MJ_ERROR_TEMPLATE_PARSE);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_parse_cached: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT void mj_template_cache_set_budget(size_t bytes)
+  {
+    try
+    {
+      minja_shim_ext_internal::TemplateCache::instance().set_budget(bytes);
+    }
+    catch (...)
+    {
+      // Eviction only releases memory
+    }
+  }
+
+  SHIM_EXPORT void mj_template_cache_clear()
+  {
+    try
+    {
+      minja_shim_ext_internal::TemplateCache::instance().clear();
+    }
+    catch (...)
+    {
+      // Ignore exceptions during cleanup
+    }
+  }
+
+  SHIM_EXPORT int mj_template_cache_get_stats(mj_template_cache_stats *out_stats)
+  {
+    minja_shim_ext_internal::clear_last_error();
+    if (!out_stats)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_template_cache_get_stats: Output parameter 'out_stats' is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto stats = minja_shim_ext_internal::TemplateCache::instance().stats();
+      out_stats->hits = stats.hits;
+      out_stats->misses = stats.misses;
+      out_stats->evictions = stats.evictions;
+      out_stats->entries = stats.entries;
+      out_stats->bytes = stats.bytes;
+      out_stats->budget = stats.budget;
+      return MJ_OK;
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_template_cache_get_stats: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_template_analyze(void *template_handle, char **out_json)
+  {
+    if (!out_json) {
+        minja_shim_ext_internal::set_last_error("mj_template_analyze: Output parameter 'out_json' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_json = nullptr;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!template_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_template_analyze: Template handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto &tpl = minja_shim_ext_internal::template_of(template_handle);
+      *out_json = create_c_string(minja_shim_ext_internal::analysis_to_json(minja_shim_ext_internal::analyze_template(tpl->source)));
+      if (!*out_json)
       {
-        delete static_cast<std::shared_ptr<TemplateNode> *>(template_handle);
+        minja_shim_ext_internal::format_and_set_error("mj_template_analyze: Failed to allocate memory for output string");
+        return record_error(MJ_ERROR_ALLOCATION_FAILED);
       }
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_template_analyze: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_template_analyze: Unexpected error", e.what());
+      return record_error(MJ_ERROR);
     }
     catch (...)
     {
-      // Ignore exceptions during cleanup as per original design
+      minja_shim_ext_internal::format_and_set_error("mj_template_analyze: Unknown exception occurred");
+      return record_error(MJ_ERROR);
     }
   }
 
@@ -193,7 +451,7 @@ extern "C"
   {
     if (!out_rendered_string) {
         minja_shim_ext_internal::set_last_error("mj_render_json: Output parameter 'out_rendered_string' is null.");
-        return MJ_ERROR_INVALID_ARGUMENT;
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
     }
     *out_rendered_string = nullptr;
     minja_shim_ext_internal::clear_last_error();
@@ -201,84 +459,193 @@ extern "C"
     if (!template_handle || !json_ctx_str)
     {
       minja_shim_ext_internal::format_and_set_error("mj_render_json: Template handle or JSON context string is null");
-      return MJ_ERROR_INVALID_ARGUMENT;
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
     }
 
     try
     {
-      auto tpl_ptr = static_cast<std::shared_ptr<TemplateNode> *>(template_handle);
+      auto &tpl = minja_shim_ext_internal::template_of(template_handle);
 
-      nlohmann::json parsed_json;
+      Value val;
       try
       {
-        parsed_json = nlohmann::json::parse(json_ctx_str);
+        val = minja_shim_ext_internal::read_json_value(json_ctx_str);
       }
-      catch (const nlohmann::json::parse_error &e)
+      catch (const minja_shim_ext_internal::JsonReadError &e)
       {
         minja_shim_ext_internal::format_and_set_error("mj_render_json: JSON parse error", e.what());
-        return MJ_ERROR_JSON_PARSE;
+        return record_error(MJ_ERROR_JSON_PARSE);
       }
 
-      json minja_json_val = parsed_json; // Assuming minja::json is nlohmann::json or compatible
-      auto val = Value(minja_json_val);
-      auto ctx = Context::make(std::move(val));
+      auto ctx = Context::make(std::move(val), minja_shim_ext_internal::shim_builtins());
 
       std::string out_str;
       try
       {
-        out_str = (*tpl_ptr)->render(ctx);
+        render_to_string(*tpl, ctx, out_str);
       }
       catch (const std::exception &e)
       {
         minja_shim_ext_internal::format_and_set_error("mj_render_json: Template rendering failed", e.what());
-        return MJ_ERROR_TEMPLATE_RENDER;
+        return record_error(MJ_ERROR_TEMPLATE_RENDER);
       }
 
-      out_str = convert_boolean_representation(out_str);
       *out_rendered_string = create_c_string(out_str);
 
       if (!*out_rendered_string)
       {
         minja_shim_ext_internal::format_and_set_error("mj_render_json: Failed to allocate memory for output string");
-        return MJ_ERROR_ALLOCATION_FAILED;
+        return record_error(MJ_ERROR_ALLOCATION_FAILED);
       }
       return MJ_OK;
     }
     catch (const std::bad_alloc &e)
     {
       minja_shim_ext_internal::format_and_set_error("mj_render_json: Allocation failed", e.what());
-      return MJ_ERROR_ALLOCATION_FAILED;
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
     }
     catch (const std::exception &e)
     {
       minja_shim_ext_internal::format_and_set_error("mj_render_json: Unexpected error", e.what());
-      return MJ_ERROR;
+      return record_error(MJ_ERROR);
     }
     catch (...)
     {
       minja_shim_ext_internal::format_and_set_error("mj_render_json: Unknown exception occurred");
-      return MJ_ERROR;
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_render_json_retained(void *template_handle, const char *json_utf8, size_t length, const char **out_data, size_t *out_length)
+  {
+    if (!out_data || !out_length) {
+        minja_shim_ext_internal::set_last_error("mj_render_json_retained: Output parameter 'out_data' or 'out_length' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_data = nullptr;
+    *out_length = 0;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!template_handle || (!json_utf8 && length > 0))
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_json_retained: Template handle or JSON input is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto &tpl = minja_shim_ext_internal::template_of(template_handle);
+
+      Value val;
+      try
+      {
+        val = minja_shim_ext_internal::read_json_value(std::string_view(json_utf8 ? json_utf8 : "", length));
+      }
+      catch (const minja_shim_ext_internal::JsonReadError &e)
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_render_json_retained: JSON parse error", e.what());
+        return record_error(MJ_ERROR_JSON_PARSE);
+      }
+      if (!val.is_object() && !val.is_null())
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_render_json_retained: JSON context must be an object");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+      }
+      auto ctx = Context::make(std::move(val), minja_shim_ext_internal::shim_builtins());
+
+      std::string &output = retained_output();
+      try
+      {
+        render_to_string(*tpl, ctx, output);
+      }
+      catch (const std::exception &e)
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_render_json_retained: Template rendering failed", e.what());
+        return record_error(MJ_ERROR_TEMPLATE_RENDER);
+      }
+
+      *out_data = output.data();
+      *out_length = output.size();
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_json_retained: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_json_retained: Unexpected error", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_json_retained: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_value_from_json(const char *json_utf8, size_t length, void **out_value_handle)
+  {
+    if (!out_value_handle) {
+        minja_shim_ext_internal::set_last_error("mj_value_from_json: Output parameter 'out_value_handle' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_value_handle = nullptr;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!json_utf8 && length > 0)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_value_from_json: JSON input is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto val = minja_shim_ext_internal::read_json_value(std::string_view(json_utf8 ? json_utf8 : "", length));
+      *out_value_handle = minja_shim_ext_internal::new_value_handle(std::move(val));
+      return MJ_OK;
+    }
+    catch (const minja_shim_ext_internal::JsonReadError &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_value_from_json: JSON parse error", e.what());
+      return record_error(MJ_ERROR_JSON_PARSE);
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_value_from_json: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_value_from_json: Failed to build value", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_value_from_json: Unknown exception occurred");
+      return record_error(MJ_ERROR);
     }
   }
 
   SHIM_EXPORT int mj_value_null(void **out_value_handle)
   {
-    return create_value_helper([]{ return new Value(); }, out_value_handle, "mj_value_null");
+    return create_value_helper([]{ return minja_shim_ext_internal::new_value_handle(Value()); }, out_value_handle, "mj_value_null");
   }
 
   SHIM_EXPORT int mj_value_bool(bool b, void **out_value_handle)
   {
-    return create_value_helper([b]{ return new Value(b); }, out_value_handle, "mj_value_bool");
+    return create_value_helper([b]{ return minja_shim_ext_internal::new_value_handle(Value(b)); }, out_value_handle, "mj_value_bool");
   }
 
   SHIM_EXPORT int mj_value_int(int64_t i, void **out_value_handle)
   {
-    return create_value_helper([i]{ return new Value(i); }, out_value_handle, "mj_value_int");
+    return create_value_helper([i]{ return minja_shim_ext_internal::new_value_handle(Value(i)); }, out_value_handle, "mj_value_int");
   }
 
   SHIM_EXPORT int mj_value_double(double d, void **out_value_handle)
   {
-    return create_value_helper([d]{ return new Value(d); }, out_value_handle, "mj_value_double");
+    return create_value_helper([d]{ return minja_shim_ext_internal::new_value_handle(Value(d)); }, out_value_handle, "mj_value_double");
   }
 
   SHIM_EXPORT int mj_value_string(const char *s, void **out_value_handle)
@@ -287,16 +654,16 @@ extern "C"
         if (out_value_handle) *out_value_handle = nullptr;
         minja_shim_ext_internal::clear_last_error();
         minja_shim_ext_internal::format_and_set_error("mj_value_string", "Input string is null");
-        return MJ_ERROR_INVALID_ARGUMENT;
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
     }
-    return create_value_helper([s]{ return new Value(std::string(s)); }, out_value_handle, "mj_value_string");
+    return create_value_helper([s]{ return minja_shim_ext_internal::new_value_handle(Value(std::string(s))); }, out_value_handle, "mj_value_string");
   }
 
   SHIM_EXPORT int mj_value_array(void **out_value_handle)
   {
     return create_value_helper([]{ 
         // Create an array value by creating an empty JSON array
-        auto val = new Value(json::array());
+        auto val = minja_shim_ext_internal::new_value_handle(Value(json::array()));
         return val;
     }, out_value_handle, "mj_value_array");
   }
@@ -307,29 +674,30 @@ extern "C"
     if (!array_handle || !value_handle)
     {
       minja_shim_ext_internal::format_and_set_error("mj_array_push: Array or value handle is null");
-      return MJ_ERROR_INVALID_ARGUMENT;
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
     }
 
     try
     {
-      auto arr_val = static_cast<Value *>(array_handle);
-      auto val_to_push = static_cast<Value *>(value_handle);
-      arr_val->push_back(*val_to_push);
+      auto array = static_cast<minja_shim_ext_internal::ValueHandle *>(array_handle);
+      auto val_to_push = static_cast<minja_shim_ext_internal::ValueHandle *>(value_handle);
+      array->value.push_back(val_to_push->value);
+      minja_shim_ext_internal::note_appended(*array, *val_to_push, false);
       return MJ_OK;
     }
     catch (const std::bad_alloc &e) {
         minja_shim_ext_internal::format_and_set_error("mj_array_push: Allocation failed", e.what());
-        return MJ_ERROR_ALLOCATION_FAILED;
+        return record_error(MJ_ERROR_ALLOCATION_FAILED);
     }
     catch (const std::exception &e)
     {
       minja_shim_ext_internal::format_and_set_error("mj_array_push: Failed to push value", e.what());
-      return MJ_ERROR_OPERATION_FAILED;
+      return record_error(MJ_ERROR_OPERATION_FAILED);
     }
     catch (...)
     {
       minja_shim_ext_internal::format_and_set_error("mj_array_push: Unknown exception occurred");
-      return MJ_ERROR;
+      return record_error(MJ_ERROR);
     }
   }
 
@@ -337,7 +705,7 @@ extern "C"
   {
     return create_value_helper([]{ 
         // Create an object value by creating an empty JSON object
-        auto val = new Value(json::object());
+        auto val = minja_shim_ext_internal::new_value_handle(Value(json::object()));
         return val;
     }, out_value_handle, "mj_value_object");
   }
@@ -348,167 +716,1590 @@ extern "C"
     if (!object_handle || !key || !value_handle)
     {
       minja_shim_ext_internal::format_and_set_error("mj_object_set: Object handle, key, or value handle is null");
-      return MJ_ERROR_INVALID_ARGUMENT;
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
     }
 
     try
     {
-      auto obj_val = static_cast<Value *>(object_handle);
-      auto val_to_set = static_cast<Value *>(value_handle);
+      auto object = static_cast<minja_shim_ext_internal::ValueHandle *>(object_handle);
+      auto val_to_set = static_cast<minja_shim_ext_internal::ValueHandle *>(value_handle);
+      size_t size_before = object->value.is_object() ? object->value.size() : 0;
+      Value key_val(key);
       // Assuming minja::Value::set throws on type error or other issues.
-      obj_val->set(key, *val_to_set);
+      object->value.set(key_val, val_to_set->value);
+      minja_shim_ext_internal::note_member_set(*object, key_val, *val_to_set, false, size_before);
       return MJ_OK;
     }
     catch (const std::bad_alloc &e) {
         minja_shim_ext_internal::format_and_set_error("mj_object_set: Allocation failed", e.what());
-        return MJ_ERROR_ALLOCATION_FAILED;
+        return record_error(MJ_ERROR_ALLOCATION_FAILED);
     }
     catch (const std::exception &e)
     {
       minja_shim_ext_internal::format_and_set_error("mj_object_set: Failed to set object property", e.what());
-      return MJ_ERROR_OPERATION_FAILED;
+      return record_error(MJ_ERROR_OPERATION_FAILED);
     }
     catch (...)
     {
       minja_shim_ext_internal::format_and_set_error("mj_object_set: Unknown exception occurred");
-      return MJ_ERROR;
+      return record_error(MJ_ERROR);
     }
   }
 
-  SHIM_EXPORT int mj_context_make(void *root_value_handle, void **out_context_handle)
+  SHIM_EXPORT int mj_array_push_take(void *array_handle, void *value_handle)
   {
-    if (!out_context_handle) {
-        minja_shim_ext_internal::set_last_error("mj_context_make: Output parameter 'out_context_handle' is null.");
-        return MJ_ERROR_INVALID_ARGUMENT;
-    }
-    *out_context_handle = nullptr;
     minja_shim_ext_internal::clear_last_error();
-
-    if (!root_value_handle)
+    if (!array_handle || !value_handle || array_handle == value_handle)
     {
-      minja_shim_ext_internal::format_and_set_error("mj_context_make: Root value handle is null");
-      return MJ_ERROR_INVALID_ARGUMENT;
+      minja_shim_ext_internal::format_and_set_error("mj_array_push_take: Array or value handle is null, or they are the same handle");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
     }
 
     try
     {
-      Value val_copy = *static_cast<Value *>(root_value_handle);
-      auto ctx = Context::make(std::move(val_copy));
-      *out_context_handle = new std::shared_ptr<Context>(ctx);
+      auto array = static_cast<minja_shim_ext_internal::ValueHandle *>(array_handle);
+      auto val_to_push = static_cast<minja_shim_ext_internal::ValueHandle *>(value_handle);
+      if (!array->value.is_array())
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_array_push_take: Target value is not an array");
+        return record_error(MJ_ERROR_OPERATION_FAILED);
+      }
+      minja_shim_ext_internal::push_back_moved(array->value, std::move(val_to_push->value));
+      minja_shim_ext_internal::note_appended(*array, *val_to_push, true);
+      minja_shim_ext_internal::free_value_handle(val_to_push);
       return MJ_OK;
     }
-    catch (const std::bad_alloc &e)
-    {
-      minja_shim_ext_internal::format_and_set_error("mj_context_make: Allocation failed", e.what());
-      return MJ_ERROR_ALLOCATION_FAILED;
+    catch (const std::bad_alloc &e) {
+        minja_shim_ext_internal::format_and_set_error("mj_array_push_take: Allocation failed", e.what());
+        return record_error(MJ_ERROR_ALLOCATION_FAILED);
     }
     catch (const std::exception &e)
     {
-      minja_shim_ext_internal::format_and_set_error("mj_context_make: Failed to create context", e.what());
-      return MJ_ERROR;
+      minja_shim_ext_internal::format_and_set_error("mj_array_push_take: Failed to push value", e.what());
+      return record_error(MJ_ERROR_OPERATION_FAILED);
     }
     catch (...)
     {
-      minja_shim_ext_internal::format_and_set_error("mj_context_make: Unknown exception occurred");
-      return MJ_ERROR;
+      minja_shim_ext_internal::format_and_set_error("mj_array_push_take: Unknown exception occurred");
+      return record_error(MJ_ERROR);
     }
   }
 
-  SHIM_EXPORT void mj_free_context(void *context_handle)
+  SHIM_EXPORT int mj_object_set_take(void *object_handle, const char *key, void *value_handle)
   {
+    minja_shim_ext_internal::clear_last_error();
+    if (!object_handle || !key || !value_handle || object_handle == value_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_object_set_take: Object handle, key, or value handle is null, or the handles are the same");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
     try
     {
-      if (context_handle)
+      auto object = static_cast<minja_shim_ext_internal::ValueHandle *>(object_handle);
+      auto val_to_set = static_cast<minja_shim_ext_internal::ValueHandle *>(value_handle);
+      if (!object->value.is_object())
       {
-        delete static_cast<std::shared_ptr<Context> *>(context_handle);
+        minja_shim_ext_internal::format_and_set_error("mj_object_set_take: Target value is not an object");
+        return record_error(MJ_ERROR_OPERATION_FAILED);
       }
+      size_t size_before = object->value.size();
+      Value key_val(key);
+      minja_shim_ext_internal::set_moved(object->value, key_val, std::move(val_to_set->value));
+      minja_shim_ext_internal::note_member_set(*object, key_val, *val_to_set, true, size_before);
+      minja_shim_ext_internal::free_value_handle(val_to_set);
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e) {
+        minja_shim_ext_internal::format_and_set_error("mj_object_set_take: Allocation failed", e.what());
+        return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_object_set_take: Failed to set object property", e.what());
+      return record_error(MJ_ERROR_OPERATION_FAILED);
     }
     catch (...)
     {
-      // Ignore exceptions during cleanup
+      minja_shim_ext_internal::format_and_set_error("mj_object_set_take: Unknown exception occurred");
+      return record_error(MJ_ERROR);
     }
   }
 
-  SHIM_EXPORT int mj_render_ctx(void *template_handle, void *context_handle, char **out_rendered_string)
+  SHIM_EXPORT int mj_intern_key(const char *key, size_t key_length, uint32_t *out_key_id)
   {
-    if (!out_rendered_string) {
-        minja_shim_ext_internal::set_last_error("mj_render_ctx: Output parameter 'out_rendered_string' is null.");
-        return MJ_ERROR_INVALID_ARGUMENT;
+    if (!out_key_id) {
+        minja_shim_ext_internal::set_last_error("mj_intern_key: Output parameter 'out_key_id' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
     }
-    *out_rendered_string = nullptr;
+    *out_key_id = 0;
     minja_shim_ext_internal::clear_last_error();
-
-    if (!template_handle || !context_handle)
+    if (!key && key_length > 0)
     {
-      minja_shim_ext_internal::format_and_set_error("mj_render_ctx: Template or context handle is null");
-      return MJ_ERROR_INVALID_ARGUMENT;
+      minja_shim_ext_internal::format_and_set_error("mj_intern_key: Key is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
     }
 
     try
     {
-      auto tpl_ptr = static_cast<std::shared_ptr<TemplateNode> *>(template_handle);
-      auto ctx_ptr = static_cast<std::shared_ptr<Context> *>(context_handle);
-
-      std::string out_str;
-      try
-      {
-        // Fixed this line to correctly use the shared_ptr
-        out_str = (*tpl_ptr)->render(*ctx_ptr); 
-      }
-      catch (const std::exception &e)
-      {
-        minja_shim_ext_internal::format_and_set_error("mj_render_ctx: Template rendering failed", e.what());
-        return MJ_ERROR_TEMPLATE_RENDER;
-      }
-
-      out_str = convert_boolean_representation(out_str);
-      *out_rendered_string = create_c_string(out_str);
-
-      if (!*out_rendered_string)
-      {
-        minja_shim_ext_internal::format_and_set_error("mj_render_ctx: Failed to allocate memory for output string");
-        return MJ_ERROR_ALLOCATION_FAILED;
-      }
+      *out_key_id = minja_shim_ext_internal::KeyTable::instance().intern(std::string_view(key ? key : "", key_length));
       return MJ_OK;
     }
-    catch (const std::bad_alloc &e)
-    {
-      minja_shim_ext_internal::format_and_set_error("mj_render_ctx: Allocation failed", e.what());
-      return MJ_ERROR_ALLOCATION_FAILED;
+    catch (const std::bad_alloc &e) {
+        minja_shim_ext_internal::format_and_set_error("mj_intern_key: Allocation failed", e.what());
+        return record_error(MJ_ERROR_ALLOCATION_FAILED);
     }
     catch (const std::exception &e)
     {
-      minja_shim_ext_internal::format_and_set_error("mj_render_ctx: Unexpected error", e.what());
-      return MJ_ERROR;
+      minja_shim_ext_internal::format_and_set_error("mj_intern_key: Failed to intern key", e.what());
+      return record_error(MJ_ERROR_OPERATION_FAILED);
     }
     catch (...)
     {
-      minja_shim_ext_internal::format_and_set_error("mj_render_ctx: Unknown exception occurred");
-      return MJ_ERROR;
+      minja_shim_ext_internal::format_and_set_error("mj_intern_key: Unknown exception occurred");
+      return record_error(MJ_ERROR);
     }
   }
 
-  SHIM_EXPORT void mj_free_string(char *s)
+  SHIM_EXPORT int mj_object_set_key(void *object_handle, uint32_t key_id, void *value_handle)
   {
+    minja_shim_ext_internal::clear_last_error();
+    const Value *key = minja_shim_ext_internal::KeyTable::instance().find(key_id);
+    if (!object_handle || !value_handle || !key)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_object_set_key: Object or value handle is null, or the key id is unknown");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
     try
     {
-      if (s) { // Check for null before freeing
-        std::free(s);
-      }
+      auto object = static_cast<minja_shim_ext_internal::ValueHandle *>(object_handle);
+      auto val_to_set = static_cast<minja_shim_ext_internal::ValueHandle *>(value_handle);
+      size_t size_before = object->value.is_object() ? object->value.size() : 0;
+      object->value.set(*key, val_to_set->value);
+      minja_shim_ext_internal::note_member_set(*object, *key, *val_to_set, false, size_before);
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e) {
+        minja_shim_ext_internal::format_and_set_error("mj_object_set_key: Allocation failed", e.what());
+        return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_object_set_key: Failed to set object property", e.what());
+      return record_error(MJ_ERROR_OPERATION_FAILED);
     }
     catch (...)
     {
-      // Ignore exceptions during cleanup
+      minja_shim_ext_internal::format_and_set_error("mj_object_set_key: Unknown exception occurred");
+      return record_error(MJ_ERROR);
     }
   }
 
-  SHIM_EXPORT void mj_free_value(void *value_handle)
+  SHIM_EXPORT int mj_object_set_key_take(void *object_handle, uint32_t key_id, void *value_handle)
   {
-    try
+    minja_shim_ext_internal::clear_last_error();
+    const Value *key = minja_shim_ext_internal::KeyTable::instance().find(key_id);
+    if (!object_handle || !value_handle || object_handle == value_handle || !key)
     {
-      if (value_handle)
+      minja_shim_ext_internal::format_and_set_error("mj_object_set_key_take: Object or value handle is null, the handles are the same, or the key id is unknown");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto object = static_cast<minja_shim_ext_internal::ValueHandle *>(object_handle);
+      auto val_to_set = static_cast<minja_shim_ext_internal::ValueHandle *>(value_handle);
+      if (!object->value.is_object())
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_object_set_key_take: Target value is not an object");
+        return record_error(MJ_ERROR_OPERATION_FAILED);
+      }
+      size_t size_before = object->value.size();
+      minja_shim_ext_internal::set_moved(object->value, *key, std::move(val_to_set->value));
+      minja_shim_ext_internal::note_member_set(*object, *key, *val_to_set, true, size_before);
+      minja_shim_ext_internal::free_value_handle(val_to_set);
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e) {
+        minja_shim_ext_internal::format_and_set_error("mj_object_set_key_take: Allocation failed", e.what());
+        return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_object_set_key_take: Failed to set object property", e.what());
+      return record_error(MJ_ERROR_OPERATION_FAILED);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_object_set_key_take: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_value_from_buffer(const void *data, size_t length, void **out_value_handle)
+  {
+    if (!out_value_handle) {
+        minja_shim_ext_internal::set_last_error("mj_value_from_buffer: Output parameter 'out_value_handle' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_value_handle = nullptr;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!data && length > 0)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_value_from_buffer: Input buffer is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto root = minja_shim_ext_internal::decode_value_buffer(static_cast<const uint8_t *>(data), length);
+      *out_value_handle = minja_shim_ext_internal::new_value_handle(std::move(root));
+      return MJ_OK;
+    }
+    catch (const minja_shim_ext_internal::ValueBufferError &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_value_from_buffer: Malformed value buffer", e.what());
+      return record_error(MJ_ERROR_BUFFER_FORMAT);
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_value_from_buffer: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_value_from_buffer: Failed to decode value", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_value_from_buffer: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_context_make(void *root_value_handle, void **out_context_handle)
+  {
+    if (!out_context_handle) {
+        minja_shim_ext_internal::set_last_error("mj_context_make: Output parameter 'out_context_handle' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_context_handle = nullptr;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!root_value_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_make: Root value handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto root = static_cast<minja_shim_ext_internal::ValueHandle *>(root_value_handle);
+      Value val_copy = root->value;
+      auto ctx = Context::make(std::move(val_copy), minja_shim_ext_internal::shim_builtins());
+      *out_context_handle = minja_shim_ext_internal::new_context_handle(std::move(ctx));
+      // The copy shares the root's members, and renders can `set` into them.
+      minja_shim_ext_internal::share_digest(*root);
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_make: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_make: Failed to create context", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_make: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_context_make_take(void *root_value_handle, void **out_context_handle)
+  {
+    if (!out_context_handle) {
+        minja_shim_ext_internal::set_last_error("mj_context_make_take: Output parameter 'out_context_handle' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_context_handle = nullptr;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!root_value_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_make_take: Root value handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto root = static_cast<minja_shim_ext_internal::ValueHandle *>(root_value_handle);
+      // Context rejects non-object roots only after taking the value, so check first to
+      // leave the caller's handle intact on failure.
+      if (!root->value.is_object() && !root->value.is_null())
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_context_make_take: Root value must be an object");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+      }
+      auto ctx = Context::make(std::move(root->value), minja_shim_ext_internal::shim_builtins());
+      *out_context_handle = minja_shim_ext_internal::new_context_handle(std::move(ctx));
+      minja_shim_ext_internal::free_value_handle(root);
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_make_take: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_make_take: Failed to create context", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_make_take: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_context_make_lazy(const mj_lazy_vtable *vtable, void *user_data, void **out_context_handle)
+  {
+    if (!out_context_handle) {
+        minja_shim_ext_internal::set_last_error("mj_context_make_lazy: Output parameter 'out_context_handle' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_context_handle = nullptr;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!vtable || !vtable->get)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_make_lazy: Vtable or its get callback is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto ctx = std::make_shared<minja_shim_ext_internal::LazyContext>(*vtable, user_data);
+      *out_context_handle = minja_shim_ext_internal::new_context_handle(ctx);
+      ctx->take_ownership();
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_make_lazy: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_make_lazy: Failed to create context", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_make_lazy: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_context_derive(void *base_context_handle, void *overlay_value_handle, void **out_context_handle)
+  {
+    if (!out_context_handle) {
+        minja_shim_ext_internal::set_last_error("mj_context_derive: Output parameter 'out_context_handle' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_context_handle = nullptr;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!base_context_handle || !overlay_value_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_derive: Base context or overlay value handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto overlay = static_cast<minja_shim_ext_internal::ValueHandle *>(overlay_value_handle);
+      if (!overlay->value.is_object() && !overlay->value.is_null())
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_context_derive: Overlay value must be an object");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+      }
+      Value overlay_copy = overlay->value;
+      auto ctx = Context::make(std::move(overlay_copy), minja_shim_ext_internal::context_of(base_context_handle));
+      *out_context_handle = minja_shim_ext_internal::new_context_handle(std::move(ctx));
+      minja_shim_ext_internal::share_digest(*overlay);
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_derive: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_derive: Failed to create context", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_derive: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_context_derive_take(void *base_context_handle, void *overlay_value_handle, void **out_context_handle)
+  {
+    if (!out_context_handle) {
+        minja_shim_ext_internal::set_last_error("mj_context_derive_take: Output parameter 'out_context_handle' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_context_handle = nullptr;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!base_context_handle || !overlay_value_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_derive_take: Base context or overlay value handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto overlay = static_cast<minja_shim_ext_internal::ValueHandle *>(overlay_value_handle);
+      if (!overlay->value.is_object() && !overlay->value.is_null())
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_context_derive_take: Overlay value must be an object");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+      }
+      auto ctx = Context::make(std::move(overlay->value), minja_shim_ext_internal::context_of(base_context_handle));
+      *out_context_handle = minja_shim_ext_internal::new_context_handle(std::move(ctx));
+      minja_shim_ext_internal::free_value_handle(overlay);
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_derive_take: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_derive_take: Failed to create context", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_derive_take: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_context_set_path(void *context_handle, const char *path, void *value_handle)
+  {
+    minja_shim_ext_internal::clear_last_error();
+    if (!context_handle || !path || !value_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_set_path: Context handle, path, or value handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto value = static_cast<minja_shim_ext_internal::ValueHandle *>(value_handle);
+      minja_shim_ext_internal::context_set_path(*minja_shim_ext_internal::context_of(context_handle), path, std::move(value->value));
+      minja_shim_ext_internal::free_value_handle(value);
+      return MJ_OK;
+    }
+    catch (const minja_shim_ext_internal::ContextPathError &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_set_path: Invalid path", e.what());
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_set_path: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_set_path: Failed to set the value", e.what());
+      return record_error(MJ_ERROR_OPERATION_FAILED);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_set_path: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_context_append(void *context_handle, const char *path, void *value_handle)
+  {
+    minja_shim_ext_internal::clear_last_error();
+    if (!context_handle || !path || !value_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_append: Context handle, path, or value handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto value = static_cast<minja_shim_ext_internal::ValueHandle *>(value_handle);
+      minja_shim_ext_internal::context_append(*minja_shim_ext_internal::context_of(context_handle), path, std::move(value->value));
+      minja_shim_ext_internal::free_value_handle(value);
+      return MJ_OK;
+    }
+    catch (const minja_shim_ext_internal::ContextPathError &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_append: Invalid path", e.what());
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_append: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_append: Failed to append the value", e.what());
+      return record_error(MJ_ERROR_OPERATION_FAILED);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_append: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_context_remove_path(void *context_handle, const char *path)
+  {
+    minja_shim_ext_internal::clear_last_error();
+    if (!context_handle || !path)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_remove_path: Context handle or path is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      minja_shim_ext_internal::context_remove_path(*minja_shim_ext_internal::context_of(context_handle), path);
+      return MJ_OK;
+    }
+    catch (const minja_shim_ext_internal::ContextPathError &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_remove_path: Invalid path", e.what());
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_remove_path: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_remove_path: Failed to remove the value", e.what());
+      return record_error(MJ_ERROR_OPERATION_FAILED);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_context_remove_path: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT void mj_free_context(void *context_handle)
+  {
+    try
+    {
+      if (context_handle)
+      {
+        minja_shim_ext_internal::free_context_handle(static_cast<minja_shim_ext_internal::ContextHandle *>(context_handle));
+      }
+    }
+    catch (...)
+    {
+      // Ignore exceptions during cleanup
+    }
+  }
+
+  SHIM_EXPORT int mj_render_ctx(void *template_handle, void *context_handle, char **out_rendered_string)
+  {
+    if (!out_rendered_string) {
+        minja_shim_ext_internal::set_last_error("mj_render_ctx: Output parameter 'out_rendered_string' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_rendered_string = nullptr;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!template_handle || !context_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx: Template or context handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto &tpl = minja_shim_ext_internal::template_of(template_handle);
+      auto &ctx = minja_shim_ext_internal::context_of(context_handle);
+
+      std::string out_str;
+      try
+      {
+        render_to_string(*tpl, ctx, out_str);
+      }
+      catch (const std::exception &e)
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_render_ctx: Template rendering failed", e.what());
+        return record_error(MJ_ERROR_TEMPLATE_RENDER);
+      }
+
+      *out_rendered_string = create_c_string(out_str);
+
+      if (!*out_rendered_string)
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_render_ctx: Failed to allocate memory for output string");
+        return record_error(MJ_ERROR_ALLOCATION_FAILED);
+      }
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx: Unexpected error", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_render_ctx_into(void *template_handle, void *context_handle, char *buffer, size_t buffer_size, size_t *out_length)
+  {
+    if (!out_length) {
+        minja_shim_ext_internal::set_last_error("mj_render_ctx_into: Output parameter 'out_length' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_length = 0;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!template_handle || !context_handle || (!buffer && buffer_size > 0))
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx_into: Template handle, context handle or buffer is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto &tpl = minja_shim_ext_internal::template_of(template_handle);
+      auto &ctx = minja_shim_ext_internal::context_of(context_handle);
+
+      FixedBufferSink sink(buffer, buffer_size);
+      try
+      {
+        render_template(*tpl, ctx, sink);
+      }
+      catch (const std::exception &e)
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_render_ctx_into: Template rendering failed", e.what());
+        return record_error(MJ_ERROR_TEMPLATE_RENDER);
+      }
+
+      *out_length = sink.size();
+      if (!sink.fits())
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_render_ctx_into: Output buffer is too small for the rendered template");
+        return record_error(MJ_ERROR_BUFFER_TOO_SMALL);
+      }
+
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx_into: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx_into: Unexpected error", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx_into: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_render_ctx_retained(void *template_handle, void *context_handle, const char **out_data, size_t *out_length)
+  {
+    if (!out_data || !out_length) {
+        minja_shim_ext_internal::set_last_error("mj_render_ctx_retained: Output parameter 'out_data' or 'out_length' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_data = nullptr;
+    *out_length = 0;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!template_handle || !context_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx_retained: Template or context handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto &tpl = minja_shim_ext_internal::template_of(template_handle);
+      auto &ctx = minja_shim_ext_internal::context_of(context_handle);
+
+      std::string &output = retained_output();
+      try
+      {
+        render_to_string(*tpl, ctx, output);
+      }
+      catch (const std::exception &e)
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_render_ctx_retained: Template rendering failed", e.what());
+        return record_error(MJ_ERROR_TEMPLATE_RENDER);
+      }
+
+      *out_data = output.data();
+      *out_length = output.size();
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx_retained: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx_retained: Unexpected error", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx_retained: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT void mj_result_cache_set_budget(size_t bytes)
+  {
+    try
+    {
+      minja_shim_ext_internal::ResultCache::instance().set_budget(bytes);
+    }
+    catch (...)
+    {
+      // Eviction only releases memory
+    }
+  }
+
+  SHIM_EXPORT void mj_result_cache_clear()
+  {
+    try
+    {
+      minja_shim_ext_internal::ResultCache::instance().clear();
+    }
+    catch (...)
+    {
+      // Ignore exceptions during cleanup
+    }
+  }
+
+  SHIM_EXPORT int mj_result_cache_get_stats(mj_result_cache_stats *out_stats)
+  {
+    minja_shim_ext_internal::clear_last_error();
+    if (!out_stats)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_result_cache_get_stats: Output parameter 'out_stats' is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto stats = minja_shim_ext_internal::ResultCache::instance().stats();
+      out_stats->hits = stats.hits;
+      out_stats->misses = stats.misses;
+      out_stats->evictions = stats.evictions;
+      out_stats->entries = stats.entries;
+      out_stats->bytes = stats.bytes;
+      out_stats->budget = stats.budget;
+      return MJ_OK;
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_result_cache_get_stats: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_render_cached(void *template_handle, void *root_value_handle, const char **out_data, size_t *out_length)
+  {
+    if (!out_data || !out_length) {
+        minja_shim_ext_internal::set_last_error("mj_render_cached: Output parameter 'out_data' or 'out_length' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_data = nullptr;
+    *out_length = 0;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!template_handle || !root_value_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_cached: Template or root value handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto &tpl = minja_shim_ext_internal::template_of(template_handle);
+      auto root = static_cast<minja_shim_ext_internal::ValueHandle *>(root_value_handle);
+      if (!root->value.is_object() && !root->value.is_null())
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_render_cached: Root value must be an object");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+      }
+
+      auto &cache = minja_shim_ext_internal::ResultCache::instance();
+      minja_shim_ext_internal::ValueDigest digest;
+      if (cache.enabled() && !tpl->reads_clock)
+      {
+        digest = minja_shim_ext_internal::digest_for(*root);
+      }
+
+      std::string &output = retained_output();
+      if (digest.known())
+      {
+        if (auto cached = cache.find(tpl->source_digest, digest))
+        {
+          output.assign(*cached);
+          *out_data = output.data();
+          *out_length = output.size();
+          return MJ_OK;
+        }
+      }
+
+      // Rendering into a child context keeps `set` from writing into the caller's value.
+      auto base = Context::make(Value(root->value), minja_shim_ext_internal::shim_builtins());
+      auto ctx = Context::make(Value::object(), base);
+      try
+      {
+        render_to_string(*tpl, ctx, output);
+      }
+      catch (const std::exception &e)
+      {
+        if (tpl->edits_values)
+        {
+          minja_shim_ext_internal::forget_digest(*root);
+        }
+        minja_shim_ext_internal::format_and_set_error("mj_render_cached: Template rendering failed", e.what());
+        return record_error(MJ_ERROR_TEMPLATE_RENDER);
+      }
+      // The template may have edited the root's members in place. The output still belongs to
+      // the value as it was looked up.
+      if (tpl->edits_values)
+      {
+        minja_shim_ext_internal::forget_digest(*root);
+      }
+
+      if (digest.known())
+      {
+        cache.insert(tpl->source_digest, digest, output);
+      }
+      *out_data = output.data();
+      *out_length = output.size();
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_cached: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_cached: Unexpected error", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_cached: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_renderer_create(void **out_renderer_handle)
+  {
+    if (!out_renderer_handle) {
+        minja_shim_ext_internal::set_last_error("mj_renderer_create: Output parameter 'out_renderer_handle' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_renderer_handle = nullptr;
+    minja_shim_ext_internal::clear_last_error();
+
+    try
+    {
+      *out_renderer_handle = new Renderer();
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_renderer_create: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_renderer_create: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_renderer_render(void *renderer_handle, void *template_handle, void *context_handle, const char **out_data, size_t *out_length)
+  {
+    if (!out_data || !out_length) {
+        minja_shim_ext_internal::set_last_error("mj_renderer_render: Output parameter 'out_data' or 'out_length' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_data = nullptr;
+    *out_length = 0;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!renderer_handle || !template_handle || !context_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_renderer_render: Renderer, template or context handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto renderer = static_cast<Renderer *>(renderer_handle);
+      auto &tpl = minja_shim_ext_internal::template_of(template_handle);
+      auto &ctx = minja_shim_ext_internal::context_of(context_handle);
+
+      renderer->output.clear();
+      try
+      {
+        render_to_string(*tpl, ctx, renderer->output);
+      }
+      catch (const std::exception &e)
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_renderer_render: Template rendering failed", e.what());
+        return record_error(MJ_ERROR_TEMPLATE_RENDER);
+      }
+
+      *out_data = renderer->output.data();
+      *out_length = renderer->output.size();
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_renderer_render: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_renderer_render: Unexpected error", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_renderer_render: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT void mj_free_renderer(void *renderer_handle)
+  {
+    try
+    {
+      delete static_cast<Renderer *>(renderer_handle);
+    }
+    catch (...)
+    {
+      // Ignore exceptions during cleanup
+    }
+  }
+
+  SHIM_EXPORT int mj_render_ctx_spans(void *template_handle, void *context_handle, const char *array_name,
+                                      const char **out_data, size_t *out_length,
+                                      const mj_span **out_spans, size_t *out_span_count, mj_span *out_tail)
+  {
+    if (!out_data || !out_length || !out_spans || !out_span_count || !out_tail) {
+        minja_shim_ext_internal::set_last_error("mj_render_ctx_spans: Output parameter 'out_data', 'out_length', 'out_spans', 'out_span_count' or 'out_tail' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_data = nullptr;
+    *out_length = 0;
+    *out_spans = nullptr;
+    *out_span_count = 0;
+    *out_tail = mj_span{0, 0};
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!template_handle || !context_handle || !array_name)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx_spans: Template handle, context handle or array name is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto &tpl = minja_shim_ext_internal::template_of(template_handle);
+      auto &ctx = minja_shim_ext_internal::context_of(context_handle);
+
+      std::string &output = retained_output();
+      try
+      {
+        minja_shim_ext_internal::render_with_spans(*tpl, ctx, array_name, output, g_span_layout);
+      }
+      catch (const minja_shim_ext_internal::UnsupportedSpansError &e)
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_render_ctx_spans: Spans not available", e.what());
+        return record_error(MJ_ERROR_UNSUPPORTED);
+      }
+      catch (const std::invalid_argument &e)
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_render_ctx_spans: Invalid array", e.what());
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+      }
+      catch (const std::exception &e)
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_render_ctx_spans: Template rendering failed", e.what());
+        return record_error(MJ_ERROR_TEMPLATE_RENDER);
+      }
+
+      *out_data = output.data();
+      *out_length = output.size();
+      *out_spans = g_span_layout.elements.data();
+      *out_span_count = g_span_layout.elements.size();
+      *out_tail = g_span_layout.tail;
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx_spans: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx_spans: Unexpected error", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_ctx_spans: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_render_stream(void *template_handle, void *context_handle, mj_chunk_sink_fn sink_fn, void *user_data, size_t flush_threshold)
+  {
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!template_handle || !context_handle || !sink_fn)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_stream: Template handle, context handle or sink callback is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto &tpl = minja_shim_ext_internal::template_of(template_handle);
+      auto &ctx = minja_shim_ext_internal::context_of(context_handle);
+
+      ChunkSink sink(sink_fn, user_data, flush_threshold);
+      try
+      {
+        render_template(*tpl, ctx, sink);
+        sink.finish();
+      }
+      catch (const std::exception &e)
+      {
+        // minja rewraps exceptions with location details, so check the sink rather than the type.
+        if (sink.aborted())
+        {
+          minja_shim_ext_internal::format_and_set_error("mj_render_stream: Output callback aborted the render");
+          return record_error(MJ_ERROR_SINK_ABORTED);
+        }
+        minja_shim_ext_internal::format_and_set_error("mj_render_stream: Template rendering failed", e.what());
+        return record_error(MJ_ERROR_TEMPLATE_RENDER);
+      }
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_stream: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_stream: Unexpected error", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_stream: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_render_batch(void *template_handle, void *const *context_handles, size_t count,
+                                  const mj_batch_options *options, void **out_batch_handle, mj_batch_result *out_result)
+  {
+    if (!out_batch_handle || !out_result) {
+        minja_shim_ext_internal::set_last_error("mj_render_batch: Output parameter 'out_batch_handle' or 'out_result' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_batch_handle = nullptr;
+    *out_result = mj_batch_result{};
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!template_handle || (!context_handles && count > 0))
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_batch: Template handle or context array is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto &tpl = minja_shim_ext_internal::template_of(template_handle);
+      auto batch = std::make_unique<BatchResult>();
+      batch->codes.assign(count, MJ_OK);
+      batch->errors.resize(count);
+      std::vector<std::string> outputs(count);
+
+      minja_shim_ext_internal::WorkStealingPool::instance().parallel_for(
+          count, options ? options->thread_count : 0, [&](size_t i) {
+            if (!context_handles[i])
+            {
+              batch->codes[i] = MJ_ERROR_INVALID_ARGUMENT;
+              batch->errors[i] = "Context handle is null";
+              return;
+            }
+            try
+            {
+              render_to_string(*tpl, minja_shim_ext_internal::context_of(context_handles[i]), outputs[i]);
+            }
+            catch (const std::bad_alloc &e)
+            {
+              outputs[i].clear();
+              batch->codes[i] = MJ_ERROR_ALLOCATION_FAILED;
+              batch->errors[i] = std::string("Allocation failed: ") + e.what();
+            }
+            catch (const std::exception &e)
+            {
+              outputs[i].clear();
+              batch->codes[i] = MJ_ERROR_TEMPLATE_RENDER;
+              batch->errors[i] = std::string("Template rendering failed: ") + e.what();
+            }
+            catch (...)
+            {
+              outputs[i].clear();
+              batch->codes[i] = MJ_ERROR;
+              batch->errors[i] = "Unknown exception occurred";
+            }
+          });
+
+      size_t total = 0;
+      for (const auto &output : outputs)
+      {
+        total += output.size();
+      }
+      batch->data.reserve(total);
+      batch->offsets.reserve(count + 1);
+      batch->offsets.push_back(0);
+      for (size_t i = 0; i < count; ++i)
+      {
+        batch->data += outputs[i];
+        batch->offsets.push_back(batch->data.size());
+        if (batch->codes[i] != MJ_OK)
+        {
+          ++batch->failed;
+          record_error(batch->codes[i]);
+        }
+      }
+
+      out_result->data = batch->data.data();
+      out_result->data_length = batch->data.size();
+      out_result->offsets = batch->offsets.data();
+      out_result->codes = batch->codes.data();
+      out_result->failed = batch->failed;
+      *out_batch_handle = batch.release();
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_batch: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_batch: Unexpected error", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_batch: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT const char *mj_batch_error(void *batch_handle, size_t index)
+  {
+    auto batch = static_cast<BatchResult *>(batch_handle);
+    if (!batch || index >= batch->codes.size() || batch->codes[index] == MJ_OK)
+    {
+      return nullptr;
+    }
+    return batch->errors[index].c_str();
+  }
+
+  SHIM_EXPORT void mj_free_batch(void *batch_handle)
+  {
+    try
+    {
+      delete static_cast<BatchResult *>(batch_handle);
+    }
+    catch (...)
+    {
+      // Ignore exceptions during cleanup
+    }
+  }
+
+  SHIM_EXPORT int mj_render_async(void *template_handle, void *context_handle, mj_render_completion_fn completion,
+                                  void *user_data, uint64_t timeout_ns, void **out_cancel_token)
+  {
+    if (out_cancel_token)
+    {
+      *out_cancel_token = nullptr;
+    }
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!template_handle || !context_handle || !completion)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_async: Template handle, context handle or completion callback is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      using minja_shim_ext_internal::RenderBudget;
+      std::shared_ptr<minja_shim_ext_internal::ShimTemplate> tpl = minja_shim_ext_internal::template_of(template_handle);
+      std::shared_ptr<minja::Context> ctx = minja_shim_ext_internal::context_of(context_handle);
+      auto budget = std::make_shared<RenderBudget>(timeout_ns);
+      std::unique_ptr<std::shared_ptr<RenderBudget>> token;
+      if (out_cancel_token)
+      {
+        token = std::make_unique<std::shared_ptr<RenderBudget>>(budget);
+      }
+
+      minja_shim_ext_internal::TaskExecutor::instance().post([tpl, ctx, budget, completion, user_data] {
+        std::string output;
+        int status = MJ_OK;
+        minja_shim_ext_internal::clear_last_error();
+        try
+        {
+          try
+          {
+            budget->check();
+            auto guarded = std::make_shared<minja_shim_ext_internal::BudgetContext>(ctx, *budget);
+            minja_shim_ext_internal::BudgetSink sink(output, *budget);
+            render_template(*tpl, guarded, sink);
+          }
+          catch (const std::exception &e)
+          {
+            // minja rewraps exceptions with location details, so ask the budget why the render stopped.
+            switch (budget->stop())
+            {
+            case RenderBudget::Stop::Cancelled:
+              minja_shim_ext_internal::format_and_set_error("mj_render_async: Render was cancelled");
+              status = record_error(MJ_ERROR_CANCELLED);
+              break;
+            case RenderBudget::Stop::DeadlineExceeded:
+              minja_shim_ext_internal::format_and_set_error("mj_render_async: Render deadline exceeded");
+              status = record_error(MJ_ERROR_DEADLINE_EXCEEDED);
+              break;
+            default:
+              minja_shim_ext_internal::format_and_set_error("mj_render_async: Template rendering failed", e.what());
+              status = record_error(MJ_ERROR_TEMPLATE_RENDER);
+              break;
+            }
+          }
+        }
+        catch (...)
+        {
+          minja_shim_ext_internal::format_and_set_error("mj_render_async: Unknown exception occurred");
+          status = record_error(MJ_ERROR);
+        }
+
+        if (status == MJ_OK)
+        {
+          completion(status, output.data(), output.size(), nullptr, user_data);
+        }
+        else
+        {
+          completion(status, nullptr, 0, minja_shim_ext_internal::g_last_error_message.c_str(), user_data);
+          minja_shim_ext_internal::clear_last_error();
+        }
+      });
+
+      if (out_cancel_token)
+      {
+        *out_cancel_token = token.release();
+      }
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_async: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_async: Unexpected error", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_render_async: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT void mj_cancel(void *cancel_token)
+  {
+    if (cancel_token)
+    {
+      (*static_cast<std::shared_ptr<minja_shim_ext_internal::RenderBudget> *>(cancel_token))->cancel();
+    }
+  }
+
+  SHIM_EXPORT void mj_free_cancel_token(void *cancel_token)
+  {
+    delete static_cast<std::shared_ptr<minja_shim_ext_internal::RenderBudget> *>(cancel_token);
+  }
+
+  SHIM_EXPORT int mj_chat_session_create(void *template_handle, void *root_value_handle, void **out_session_handle)
+  {
+    if (!out_session_handle) {
+        minja_shim_ext_internal::set_last_error("mj_chat_session_create: Output parameter 'out_session_handle' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_session_handle = nullptr;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!template_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_create: Template handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto root = static_cast<minja_shim_ext_internal::ValueHandle *>(root_value_handle);
+      if (root && !root->value.is_object() && !root->value.is_null())
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_chat_session_create: Root value must be an object");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+      }
+      // Copying the root is shallow; it only becomes the session's once construction succeeded.
+      *out_session_handle = new minja_shim_ext_internal::ChatSession(
+          minja_shim_ext_internal::template_of(template_handle), root ? root->value : Value());
+      minja_shim_ext_internal::free_value_handle(root);
+      return MJ_OK;
+    }
+    catch (const std::invalid_argument &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_create: Invalid root value", e.what());
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_create: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_create: Failed to create session", e.what());
+      return record_error(MJ_ERROR);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_create: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_chat_session_append_take(void *session_handle, void *value_handle)
+  {
+    minja_shim_ext_internal::clear_last_error();
+    if (!session_handle || !value_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_append_take: Session or value handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto session = static_cast<minja_shim_ext_internal::ChatSession *>(session_handle);
+      auto message = static_cast<minja_shim_ext_internal::ValueHandle *>(value_handle);
+      session->append(std::move(message->value));
+      minja_shim_ext_internal::free_value_handle(message);
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_append_take: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_append_take: Failed to append message", e.what());
+      return record_error(MJ_ERROR_OPERATION_FAILED);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_append_take: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_chat_session_set_take(void *session_handle, const char *key, void *value_handle)
+  {
+    minja_shim_ext_internal::clear_last_error();
+    if (!session_handle || !key || !value_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_set_take: Session handle, key, or value handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto session = static_cast<minja_shim_ext_internal::ChatSession *>(session_handle);
+      auto value = static_cast<minja_shim_ext_internal::ValueHandle *>(value_handle);
+      session->set(key, std::move(value->value));
+      minja_shim_ext_internal::free_value_handle(value);
+      return MJ_OK;
+    }
+    catch (const std::invalid_argument &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_set_take: Invalid value", e.what());
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_set_take: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (const std::exception &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_set_take: Failed to set variable", e.what());
+      return record_error(MJ_ERROR_OPERATION_FAILED);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_set_take: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_chat_session_render(void *session_handle, const char **out_data, size_t *out_length)
+  {
+    if (!out_data || !out_length) {
+        minja_shim_ext_internal::set_last_error("mj_chat_session_render: Output parameter 'out_data' or 'out_length' is null.");
+        return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+    *out_data = nullptr;
+    *out_length = 0;
+    minja_shim_ext_internal::clear_last_error();
+
+    if (!session_handle)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_render: Session handle is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    try
+    {
+      auto session = static_cast<minja_shim_ext_internal::ChatSession *>(session_handle);
+      const std::string *output = nullptr;
+      try
+      {
+        output = &session->render();
+      }
+      catch (const std::bad_alloc &)
+      {
+        throw;
+      }
+      catch (const std::exception &e)
+      {
+        minja_shim_ext_internal::format_and_set_error("mj_chat_session_render: Template rendering failed", e.what());
+        return record_error(MJ_ERROR_TEMPLATE_RENDER);
+      }
+
+      *out_data = output->data();
+      *out_length = output->size();
+      return MJ_OK;
+    }
+    catch (const std::bad_alloc &e)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_render: Allocation failed", e.what());
+      return record_error(MJ_ERROR_ALLOCATION_FAILED);
+    }
+    catch (...)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_chat_session_render: Unknown exception occurred");
+      return record_error(MJ_ERROR);
+    }
+  }
+
+  SHIM_EXPORT int mj_chat_session_is_incremental(void *session_handle)
+  {
+    auto session = static_cast<minja_shim_ext_internal::ChatSession *>(session_handle);
+    return session && session->incremental() ? 1 : 0;
+  }
+
+  SHIM_EXPORT void mj_free_chat_session(void *session_handle)
+  {
+    try
+    {
+      delete static_cast<minja_shim_ext_internal::ChatSession *>(session_handle);
+    }
+    catch (...)
+    {
+      // Ignore exceptions during cleanup
+    }
+  }
+
+  SHIM_EXPORT void mj_free_string(char *s)
+  {
+    try
+    {
+      if (s) { // Check for null before freeing
+        std::free(s);
+      }
+    }
+    catch (...)
+    {
+      // Ignore exceptions during cleanup
+    }
+  }
+
+  SHIM_EXPORT void mj_free_value(void *value_handle)
+  {
+    try
+    {
+      if (value_handle)
       {
-        delete static_cast<Value *>(value_handle);
+        minja_shim_ext_internal::free_value_handle(static_cast<minja_shim_ext_internal::ValueHandle *>(value_handle));
       }
     }
     catch (...)
@@ -517,4 +2308,55 @@ extern "C"
     }
   }
 
-} // extern "C"
\ No newline at end of file
+  SHIM_EXPORT void mj_stats_set_enabled(int enabled)
+  {
+    minja_shim_ext_internal::g_stats_enabled.store(enabled != 0, std::memory_order_relaxed);
+  }
+
+  SHIM_EXPORT int mj_stats_enabled()
+  {
+    return minja_shim_ext_internal::stats_enabled() ? 1 : 0;
+  }
+
+  SHIM_EXPORT int mj_get_stats(mj_stats *out_stats)
+  {
+    minja_shim_ext_internal::clear_last_error();
+    if (!out_stats)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_get_stats: Output parameter 'out_stats' is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    minja_shim_ext_internal::ShimStats::instance().snapshot(*out_stats);
+    return MJ_OK;
+  }
+
+  SHIM_EXPORT int mj_get_template_stats(void *template_handle, mj_template_stats *out_stats)
+  {
+    minja_shim_ext_internal::clear_last_error();
+    if (!template_handle || !out_stats)
+    {
+      minja_shim_ext_internal::format_and_set_error("mj_get_template_stats: Template handle or output parameter 'out_stats' is null");
+      return record_error(MJ_ERROR_INVALID_ARGUMENT);
+    }
+
+    auto &tpl = minja_shim_ext_internal::template_of(template_handle);
+    tpl->stats.snapshot(out_stats->render);
+    out_stats->parse_ns = tpl->parse_ns;
+    return MJ_OK;
+  }
+
+  SHIM_EXPORT void mj_reset_stats()
+  {
+    minja_shim_ext_internal::ShimStats::instance().reset();
+  }
+
+  SHIM_EXPORT void mj_reset_template_stats(void *template_handle)
+  {
+    if (template_handle)
+    {
+      minja_shim_ext_internal::template_of(template_handle)->stats.reset();
+    }
+  }
+
+} // extern "C"
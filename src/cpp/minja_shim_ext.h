@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef> // For size_t
 #include <cstdint> // For int64_t
 
 // --- Error Code Definitions ---
@@ -11,6 +12,12 @@
 #define MJ_ERROR_TEMPLATE_RENDER 5      // Template rendering failed
 #define MJ_ERROR_OPERATION_FAILED 6     // e.g., for array_push, object_set if the operation itself fails (not due to bad_alloc)
 #define MJ_ERROR_TEMPLATE_PARSE 7       // Template parsing failed (specific to mj_parse)
+#define MJ_ERROR_BUFFER_TOO_SMALL 8     // Caller-supplied output buffer is too small (required size is reported)
+#define MJ_ERROR_SINK_ABORTED 9         // A streaming output callback asked to stop rendering
+#define MJ_ERROR_BUFFER_FORMAT 10       // Binary value buffer is truncated, malformed or of an unsupported version
+#define MJ_ERROR_UNSUPPORTED 11         // The template cannot be rendered in the requested mode
+#define MJ_ERROR_CANCELLED 12           // An asynchronous render was cancelled through its token
+#define MJ_ERROR_DEADLINE_EXCEEDED 13   // An asynchronous render ran past its deadline
 
 // --- DLL Export Macro ---
 #ifdef _WIN32
@@ -34,14 +41,63 @@ SHIM_EXPORT const char* mj_get_last_error();
 SHIM_EXPORT int mj_parse(const char* tmpl_str, void** out_template_handle);
 SHIM_EXPORT void mj_free_template(void* template_handle); // Renamed param for consistency
 
+// --- Template cache ---
+// Counters and sizes of the process-wide template cache. bytes and budget are approximate.
+typedef struct mj_template_cache_stats {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  uint64_t entries;
+  uint64_t bytes;
+  uint64_t budget;
+} mj_template_cache_stats;
+
+// Like mj_parse, but takes a length-delimited UTF-8 source and returns a handle to a shared, already
+// parsed template when the same source has been parsed before. The handle is freed with mj_free_template
+// as usual; evicting the cache entry does not invalidate handles already returned.
+SHIM_EXPORT int mj_parse_cached(const char* tmpl_str, size_t length, void** out_template_handle);
+
+// Sets the cache's byte budget, evicting least recently used templates until it fits.
+SHIM_EXPORT void mj_template_cache_set_budget(size_t bytes);
+
+// Drops every cached template. Counters are kept.
+SHIM_EXPORT void mj_template_cache_clear();
+
+SHIM_EXPORT int mj_template_cache_get_stats(mj_template_cache_stats* out_stats);
+
+// --- Template analysis ---
+// Lists what a template may read from its context, as a JSON object:
+//   "variables": top-level variables read (builtins excluded)
+//   "paths":     access paths that may be read in full, e.g. ["messages", "*", "content"]; "*" is any array
+//                element or, after a computed subscript, any key
+//   "shapes":    paths only iterated or tested for type, length or truthiness (all keys of an object count)
+//   "filters", "tests", "functions": names used; functions are called globals, builtins included
+//   "dynamic":   true if a subscript is computed (recorded as "*")
+//   "complete":  false if the template uses a construct the analysis does not follow; the lists may then miss reads
+// Loop variables and unconditional `set name = path` assignments are followed to what they alias; other values
+// assigned with `set` count as read in full. minja does not expose its parsed tree, so the analysis is a lexical
+// pass over the template source. It over-approximates: every read the template can make is covered.
+// The returned string must be freed using mj_free_string.
+SHIM_EXPORT int mj_template_analyze(void* template_handle, char** out_json);
+
 // --- Render by JSON ---
-// Renders a template using a JSON string as context.
+// Renders a template using a JSON string as context. Object keys keep their document order.
 // On success, returns MJ_OK and sets out_rendered_string.
 // On failure, returns an error code and out_rendered_string will be nullptr.
 // The returned string in out_rendered_string must be freed using mj_free_string.
 SHIM_EXPORT int mj_render_json(void* template_handle, const char* json_ctx_str, char** out_rendered_string);
 SHIM_EXPORT void mj_free_string(char* s);
 
+// Renders a template using length-delimited UTF-8 JSON (no NUL terminator needed) as context.
+// The JSON is turned into values directly while it is parsed; object keys keep their document order.
+// Output is handed out like mj_render_ctx_retained: owned by the calling thread and valid until the next
+// retained render there.
+SHIM_EXPORT int mj_render_json_retained(void* template_handle, const char* json_utf8, size_t length, const char** out_data, size_t* out_length);
+
+// Builds a value from length-delimited UTF-8 JSON in a single pass.
+// Returns MJ_ERROR_JSON_PARSE if the input is not valid JSON.
+SHIM_EXPORT int mj_value_from_json(const char* json_utf8, size_t length, void** out_value_handle);
+
 // --- Value constructors ---
 // All value constructors return MJ_OK on success and set out_value_handle.
 // On failure, they return an error code and out_value_handle will be nullptr.
@@ -62,6 +118,45 @@ SHIM_EXPORT int mj_value_object(void** out_value_handle);
 // Returns MJ_OK on success, or an error code on failure.
 SHIM_EXPORT int mj_object_set(void* object_handle, const char* key, void* value_handle);
 
+// --- Consuming (move) variants ---
+// These move the child value (or root value) into its new owner instead of copying it, and free
+// the passed handle. On success that handle is invalid and must not be used or freed again.
+// On failure nothing is moved and the caller still owns the handle.
+SHIM_EXPORT int mj_array_push_take(void* array_handle, void* value_handle);
+SHIM_EXPORT int mj_object_set_take(void* object_handle, const char* key, void* value_handle);
+
+// --- Interned object keys ---
+// Interns `key` (UTF-8, `key_length` bytes) in a process-wide table and sets *out_key_id to its id.
+// Interning the same key again returns the same id. Ids stay valid until the process exits, so intern
+// fixed names (property names, "role", "content"), not keys that come from data. Returns
+// MJ_ERROR_OPERATION_FAILED once the table is full (2^20 keys).
+SHIM_EXPORT int mj_intern_key(const char* key, size_t key_length, uint32_t* out_key_id);
+// Like mj_object_set and mj_object_set_take, but with an interned key id instead of a C string, which
+// skips measuring and converting the key. An unknown id returns MJ_ERROR_INVALID_ARGUMENT.
+SHIM_EXPORT int mj_object_set_key(void* object_handle, uint32_t key_id, void* value_handle);
+SHIM_EXPORT int mj_object_set_key_take(void* object_handle, uint32_t key_id, void* value_handle);
+
+// --- Binary value trees ---
+// Decodes a whole value tree from one contiguous buffer, replacing a native call per node.
+// On success, returns MJ_OK and sets out_value_handle; on failure returns an error code
+// (MJ_ERROR_BUFFER_FORMAT for malformed input) and out_value_handle will be nullptr.
+//
+// Format (all integers little-endian):
+//   header:  'M' 'J' 'V' <version: u8 = 1 or 2>, followed by exactly one node
+//   node:    <tag: u8> <payload>
+//     0x00 null | 0x01 false | 0x02 true
+//     0x03 int64   <i64>
+//     0x04 double  <f64>
+//     0x05 string  <length: u32> <UTF-8 bytes>
+//     0x06 array   <count: u32> <node>*count
+//     0x07 object  <count: u32> (<key length: u32> <UTF-8 key> <node>)*count
+//     0x08 int64 array   <count: u32> <i64>*count
+//     0x09 double array  <count: u32> <f64>*count
+//     0x0A string array  <count: u32> (<length: u32> <UTF-8 bytes>)*count; length 0xFFFFFFFF is null
+//   Version 2 only: an object key length with the top bit set (0x80000000 | id) is an id returned by
+//   mj_intern_key, with no key bytes following.
+SHIM_EXPORT int mj_value_from_buffer(const void* data, size_t length, void** out_value_handle);
+
 // --- Context from a Value, and free it ---
 // Creates a rendering context from a root value.
 // On success, returns MJ_OK and sets out_context_handle.
@@ -69,6 +164,56 @@ SHIM_EXPORT int mj_object_set(void* object_handle, const char* key, void* value_
 SHIM_EXPORT int mj_context_make(void* root_value_handle, void** out_context_handle);
 SHIM_EXPORT void mj_free_context(void* context_handle); // Renamed param for consistency
 
+// Like mj_context_make, but moves the root value into the context and frees root_value_handle on success.
+SHIM_EXPORT int mj_context_make_take(void* root_value_handle, void** out_context_handle);
+
+// Creates a context that layers overlay_value_handle (an object) over base_context_handle. Names missing
+// from the overlay are looked up in the base, and variables set while rendering land in the overlay, so
+// one long-lived base can back many derived contexts, on any number of threads, without being copied.
+// The base must not be rendered or modified directly while it is shared. The derived context keeps the
+// base alive, so the base handle may be freed first.
+SHIM_EXPORT int mj_context_derive(void* base_context_handle, void* overlay_value_handle, void** out_context_handle);
+
+// Like mj_context_derive, but moves the overlay into the context and frees overlay_value_handle on success.
+SHIM_EXPORT int mj_context_derive_take(void* base_context_handle, void* overlay_value_handle, void** out_context_handle);
+
+// --- In-place context edits ---
+// Change a context's variables without rebuilding it, so a long-lived context (an agent loop's history,
+// say) takes O(1) work per step. Paths are dotted: the first segment names a variable, later segments are
+// object keys or array indices ("messages", "messages.3.content"). Values are moved in and value_handle is
+// freed on success; on failure nothing changes and the caller still owns it. Only variables the context
+// defines itself can be edited inside; paths into a base context or the builtins return
+// MJ_ERROR_INVALID_ARGUMENT, as do missing intermediate segments and out-of-range indices.
+//
+// A context must not be edited while it is being rendered, or while it is the base of derived contexts.
+// A context made with mj_context_make shares its members with the root value, so edits show through that
+// value too; mj_context_make_take avoids this.
+//
+// Sets the variable or member at path, or replaces an existing array element.
+SHIM_EXPORT int mj_context_set_path(void* context_handle, const char* path, void* value_handle);
+// Appends value_handle to the array at path.
+SHIM_EXPORT int mj_context_append(void* context_handle, const char* path, void* value_handle);
+// Removes the variable, object member or array element at path.
+SHIM_EXPORT int mj_context_remove_path(void* context_handle, const char* path);
+
+// Host callbacks behind a lazy context.
+typedef struct mj_lazy_vtable {
+  // Looks up the top-level variable `key` (UTF-8, not NUL-terminated). Return MJ_OK and set *out_value_handle
+  // to a new value handle, which the context takes over and frees, or leave it nullptr if the variable is not
+  // defined. Any other return value fails the render that asked for it.
+  int (*get)(void* user_data, const char* key, size_t key_length, void** out_value_handle);
+  // Called once with user_data when the context is destroyed. May be nullptr.
+  void (*release)(void* user_data);
+} mj_lazy_vtable;
+
+// Creates a context whose top-level variables are requested from the host the first time a template reads
+// them, and kept for later lookups; variables the template never reads are never built. Variables set by the
+// template shadow the host's. Fetched variables are complete values, so laziness applies to the top level only.
+// The vtable is copied. On success the context owns user_data and releases it through vtable->release; on
+// failure release is not called. Lookups modify the context, so it must not be used by several threads at
+// once, including as the base of derived contexts.
+SHIM_EXPORT int mj_context_make_lazy(const mj_lazy_vtable* vtable, void* user_data, void** out_context_handle);
+
 // --- Render by Context ---
 // Renders a template using a pre-built context.
 // On success, returns MJ_OK and sets out_rendered_string.
@@ -76,7 +221,228 @@ SHIM_EXPORT void mj_free_context(void* context_handle); // Renamed param for con
 // The returned string in out_rendered_string must be freed using mj_free_string.
 SHIM_EXPORT int mj_render_ctx(void* template_handle, void* context_handle, char** out_rendered_string);
 
+// --- Render into caller-owned or retained memory ---
+// Renders a template directly into a caller-supplied buffer. The output is not NUL-terminated.
+// On success, returns MJ_OK and sets out_length to the number of bytes written.
+// If the buffer is too small, returns MJ_ERROR_BUFFER_TOO_SMALL and sets out_length to the number of
+// bytes required; the buffer contents are then unspecified and the call can be retried with a larger buffer.
+SHIM_EXPORT int mj_render_ctx_into(void* template_handle, void* context_handle, char* buffer, size_t buffer_size, size_t* out_length);
+
+// Renders a template into a native buffer that is owned by the calling thread and reused across calls.
+// On success, returns MJ_OK, sets out_data to the rendered bytes (not NUL-terminated) and out_length to their count.
+// The data must not be freed; it stays valid until the next mj_render_ctx_retained call on the same thread.
+// Other _retained renders share the same buffer. The buffer keeps its capacity between renders up to 1 MiB;
+// a larger one is released at the start of the next retained render on the thread.
+SHIM_EXPORT int mj_render_ctx_retained(void* template_handle, void* context_handle, const char** out_data, size_t* out_length);
+
+// --- Result cache ---
+// Process-wide cache of rendered output keyed by the template's source and a structural hash of the
+// root value, for traffic that renders identical requests (retries, fan-out, evaluation sweeps).
+// It is off until it is given a budget. While it is on, value handles keep a 128-bit hash of their
+// tree up to date as it is built with the mj_value_*, mj_array_push* and mj_object_set* calls, so a
+// lookup does not walk the tree again; values that were shared with a context, or that received a
+// copy of another container, are walked at lookup instead.
+typedef struct mj_result_cache_stats {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  uint64_t entries;
+  uint64_t bytes;
+  uint64_t budget;
+} mj_result_cache_stats;
+
+// Sets the cache's byte budget, evicting least recently used outputs until it fits. 0 (the default)
+// turns the cache off and drops its entries.
+SHIM_EXPORT void mj_result_cache_set_budget(size_t bytes);
+
+// Drops every cached output. Counters are kept.
+SHIM_EXPORT void mj_result_cache_clear();
+
+SHIM_EXPORT int mj_result_cache_get_stats(mj_result_cache_stats* out_stats);
+
+// Renders a template against a context made from root_value_handle (an object, or null), returning the
+// cached output without rendering when the same template has already rendered an equal value. Variables
+// set by the template land in a context of their own; a template that edits the value in place (`.append()`)
+// makes the next call hash it again. Output is handed out like
+// mj_render_ctx_retained. Failed renders are not cached. Roots holding callables, and templates that call
+// strftime_now, are never cached.
+SHIM_EXPORT int mj_render_cached(void* template_handle, void* root_value_handle, const char** out_data, size_t* out_length);
+
+// --- Streaming render ---
+// Receives one chunk of rendered output. The data is only valid for the duration of the call.
+// Return 0 to continue rendering, or any other value to abort the render.
+typedef int (*mj_chunk_sink_fn)(const char* data, size_t length, void* user_data);
+
+// Renders a template and hands the output to sink_fn in chunks as it is produced.
+// Output is buffered internally and flushed whenever flush_threshold bytes have accumulated
+// (0 selects a default), plus once at the end; peak memory scales with the chunk size, not the output.
+// Returns MJ_OK on success, MJ_ERROR_SINK_ABORTED if the callback asked to stop, or another error code.
+SHIM_EXPORT int mj_render_stream(void* template_handle, void* context_handle, mj_chunk_sink_fn sink_fn, void* user_data, size_t flush_threshold);
+
+// --- Renderers ---
+// A renderer owns an output buffer that keeps its capacity between renders, and every template
+// remembers a running estimate of its output size, so renders reserve up front instead of growing the
+// buffer. A renderer must be used by one thread at a time.
+SHIM_EXPORT int mj_renderer_create(void** out_renderer_handle);
+
+// Renders a template with a context into the renderer's buffer. The data is owned by the renderer
+// (not NUL-terminated) and stays valid until the next render on it or mj_free_renderer.
+SHIM_EXPORT int mj_renderer_render(void* renderer_handle, void* template_handle, void* context_handle, const char** out_data, size_t* out_length);
+
+SHIM_EXPORT void mj_free_renderer(void* renderer_handle);
+
+// --- Span render ---
+// Byte range [begin, end) of a rendered output.
+typedef struct mj_span {
+  size_t begin;
+  size_t end;
+} mj_span;
+
+// Renders a template and reports where each element of the top-level array `array_name` (e.g. "messages")
+// starts and ends in the output, so a caller can match cached prompt prefixes on element boundaries.
+// out_spans receives one span per element, in order; consecutive spans are adjacent. out_tail receives the
+// output after the last element, which for chat templates is the generation prompt. Everything before the
+// first span is the header.
+// Spans are only available for templates that render the array element by element (see
+// find_separable_loop in chat_session.h); for others, or when the elements rendered on their own do not
+// reproduce the full output, returns MJ_ERROR_UNSUPPORTED. This costs roughly two renders.
+// Output and spans are owned by the calling thread like mj_render_ctx_retained: the data stays valid until
+// the next retained render there, the spans until the next mj_render_ctx_spans on the thread.
+SHIM_EXPORT int mj_render_ctx_spans(void* template_handle, void* context_handle, const char* array_name,
+                                    const char** out_data, size_t* out_length,
+                                    const mj_span** out_spans, size_t* out_span_count, mj_span* out_tail);
+
+// --- Batch render ---
+typedef struct mj_batch_options {
+  size_t thread_count;   // Threads to render on, the calling thread included; 0 uses one per hardware thread
+} mj_batch_options;
+
+// View of a finished batch. All pointers are owned by the batch handle and stay valid until mj_free_batch.
+typedef struct mj_batch_result {
+  const char* data;      // Output of every item, packed in item order (not NUL-terminated)
+  size_t data_length;
+  const size_t* offsets; // count + 1 entries; item i occupies data[offsets[i], offsets[i + 1])
+  const int* codes;      // count entries; MJ_OK or the error code of that item
+  size_t failed;         // Number of items whose code is not MJ_OK
+} mj_batch_result;
+
+// Renders one template against `count` contexts on the shared native thread pool.
+// Returns MJ_OK once every item has been attempted, even if some items failed; failures are reported
+// per item through codes (their output range is empty) and mj_batch_error. Each context may appear only
+// once, since rendering can modify its context. options may be nullptr for defaults.
+// The batch handle must be freed with mj_free_batch.
+SHIM_EXPORT int mj_render_batch(void* template_handle, void* const* context_handles, size_t count,
+                                const mj_batch_options* options, void** out_batch_handle, mj_batch_result* out_result);
+
+// Returns the error message of a failed item, or nullptr if it succeeded. Owned by the batch handle.
+SHIM_EXPORT const char* mj_batch_error(void* batch_handle, size_t index);
+
+SHIM_EXPORT void mj_free_batch(void* batch_handle);
+
+// --- Asynchronous render ---
+// Receives the result of an asynchronous render on the executor thread that ran it. On MJ_OK, data holds
+// the output (not NUL-terminated) and error_message is nullptr; otherwise data is empty and error_message
+// describes the failure. Both are only valid for the duration of the call.
+typedef void (*mj_render_completion_fn)(int status, const char* data, size_t length, const char* error_message, void* user_data);
+
+// Queues a render on the shared native executor and returns at once; completion is called exactly once
+// when the call returns MJ_OK, and never otherwise. The template and context may be freed right after the
+// call, but the context must not be modified until completion runs.
+// timeout_ns is a time budget measured from this call (0 for none). A render that is cancelled or exceeds
+// its budget finishes with MJ_ERROR_CANCELLED or MJ_ERROR_DEADLINE_EXCEEDED. minja has no hook between its
+// nodes, so the render checks the budget whenever it writes output or looks up a name in its context; a
+// loop that does neither runs to completion.
+// When out_cancel_token is not nullptr it receives a token for mj_cancel, which must be freed with
+// mj_free_cancel_token, before or after completion.
+SHIM_EXPORT int mj_render_async(void* template_handle, void* context_handle, mj_render_completion_fn completion,
+                                void* user_data, uint64_t timeout_ns, void** out_cancel_token);
+
+// Asks the render behind a token to stop. Safe to call from any thread, and after the render has finished.
+SHIM_EXPORT void mj_cancel(void* cancel_token);
+
+SHIM_EXPORT void mj_free_cancel_token(void* cancel_token);
+
+// --- Chat sessions ---
+// A chat session keeps a context and the output of its last render. When messages are only appended,
+// templates whose message loop is separable (see is_separable_chat_template in chat_session.h) render
+// just the new messages and reuse the previous output; other templates, or any other change, fall back
+// to a full render. Output is always identical to a full render. A session is not thread-safe.
+
+// Creates a session for a template. root_value_handle (an object, or nullptr for an empty one) is moved
+// into the session and freed on success; its "messages" entry, if present, must be an array.
+SHIM_EXPORT int mj_chat_session_create(void* template_handle, void* root_value_handle, void** out_session_handle);
+
+// Appends a message, moving it into the session and freeing value_handle on success.
+SHIM_EXPORT int mj_chat_session_append_take(void* session_handle, void* value_handle);
+
+// Replaces a top-level variable, moving the value into the session and freeing value_handle on success.
+// The next render is a full render.
+SHIM_EXPORT int mj_chat_session_set_take(void* session_handle, const char* key, void* value_handle);
+
+// Renders the conversation. The data is owned by the session (not NUL-terminated) and stays valid until
+// the next call on the session.
+SHIM_EXPORT int mj_chat_session_render(void* session_handle, const char** out_data, size_t* out_length);
+
+// Returns 1 if the session's template supports incremental renders, 0 if every render is a full render.
+SHIM_EXPORT int mj_chat_session_is_incremental(void* session_handle);
+
+SHIM_EXPORT void mj_free_chat_session(void* session_handle);
+
 // --- Value memory management ---
 SHIM_EXPORT void mj_free_value(void* value_handle); // Renamed param for consistency
 
+// --- Statistics ---
+// Collection is off by default; while off, the counters and histograms below stay where they are.
+#define MJ_STATS_LATENCY_BUCKETS 40
+#define MJ_STATS_ERROR_CODES 16
+
+// Bucket i counts durations in [2^i, 2^(i+1)) nanoseconds; bucket 0 also takes 0 ns and the last
+// bucket is open-ended.
+typedef struct mj_latency_histogram {
+  uint64_t count;
+  uint64_t total_ns;
+  uint64_t buckets[MJ_STATS_LATENCY_BUCKETS];
+} mj_latency_histogram;
+
+// A render is one call into the template: a batch item, a chat session render, or any mj_render_* call.
+// output_bytes counts the output of successful renders.
+typedef struct mj_render_stats {
+  uint64_t renders;
+  uint64_t errors;
+  uint64_t output_bytes;
+  mj_latency_histogram time;
+} mj_render_stats;
+
+// errors_by_code[c] counts C API calls that returned error code c; slot 0 counts codes outside the table.
+// The live_* gauges are handles created minus handles freed. Value and context handles are only counted
+// when collection was on as they were created; template handles are always counted.
+typedef struct mj_stats {
+  int enabled;
+  mj_render_stats render;
+  uint64_t parses;
+  uint64_t parse_errors;
+  mj_latency_histogram parse_time;
+  uint64_t errors_by_code[MJ_STATS_ERROR_CODES];
+  int64_t live_values;
+  int64_t live_contexts;
+  int64_t live_templates;
+} mj_stats;
+
+// Per parsed template. Handles returned by mj_parse_cached for the same source share these counters.
+// parse_ns is 0 when the template was parsed while collection was off.
+typedef struct mj_template_stats {
+  mj_render_stats render;
+  uint64_t parse_ns;
+} mj_template_stats;
+
+SHIM_EXPORT void mj_stats_set_enabled(int enabled);
+SHIM_EXPORT int mj_stats_enabled();
+
+SHIM_EXPORT int mj_get_stats(mj_stats* out_stats);
+SHIM_EXPORT int mj_get_template_stats(void* template_handle, mj_template_stats* out_stats);
+
+// Zeroes the process-wide counters and histograms; the live handle gauges are kept.
+SHIM_EXPORT void mj_reset_stats();
+SHIM_EXPORT void mj_reset_template_stats(void* template_handle);
+
 }  // extern "C"
\ No newline at end of file
@@ -0,0 +1,292 @@
+#include "print_filter.h"
+#include "template_scan.h"
+#include <algorithm>
+#include <stdexcept>
+#include <typeinfo>
+#include <vector>
+
+namespace minja_shim_ext_internal
+{
+  namespace
+  {
+    // Value::dump without to_json and without indentation, except for booleans.
+    void append_dump(const minja::Value &value, std::string &out)
+    {
+      if (value.is_boolean())
+      {
+        out += value.get<bool>() ? "true" : "false";
+      }
+      else if (value.is_array())
+      {
+        out += '[';
+        for (size_t i = 0, n = value.size(); i < n; ++i)
+        {
+          if (i > 0)
+          {
+            out += ", ";
+          }
+          append_dump(value.at(i), out);
+        }
+        out += ']';
+      }
+      else if (value.is_object())
+      {
+        out += '{';
+        bool first = true;
+        // keys() is not const; the copy shares the object.
+        for (const auto &key : minja::Value(value).keys())
+        {
+          if (!first)
+          {
+            out += ", ";
+          }
+          first = false;
+          if (key.is_string())
+          {
+            out += key.dump();
+          }
+          else
+          {
+            out += '\'';
+            out += key.dump();
+            out += '\'';
+          }
+          out += ": ";
+          append_dump(value.at(key), out);
+        }
+        out += '}';
+      }
+      else
+      {
+        out += value.dump();
+      }
+    }
+
+    // Text added by with_print_filter; `at` is its offset in the source as written.
+    struct Insertion
+    {
+      size_t at;
+      size_t length;
+    };
+
+    std::string print_filtered(std::string_view source, std::vector<Insertion> *insertions)
+    {
+      static const size_t kSuffixLength = std::string_view(") | ").size() + std::string_view(kPrintFilterName).size();
+
+      std::string out;
+      out.reserve(source.size() + source.size() / 8);
+      size_t copied = 0;
+      for (const auto &segment : scan_template(source))
+      {
+        if (segment.kind != TemplateSegment::Kind::Expression || tokenize_tag(segment.body).empty())
+        {
+          continue;
+        }
+        size_t begin = static_cast<size_t>(segment.body.data() - source.data());
+        size_t end = begin + segment.body.size();
+        out.append(source.substr(copied, begin - copied));
+        out += '(';
+        out.append(segment.body);
+        out += ") | ";
+        out += kPrintFilterName;
+        copied = end;
+        if (insertions)
+        {
+          insertions->push_back({begin, 1});
+          insertions->push_back({end, kSuffixLength});
+        }
+      }
+      out.append(source.substr(copied));
+      return out;
+    }
+
+    // Offset in the source as written of `offset` in the filtered source. Offsets inside inserted
+    // text map to where it was inserted.
+    size_t source_offset(const std::vector<Insertion> &insertions, size_t offset)
+    {
+      size_t added = 0;
+      for (const auto &insertion : insertions)
+      {
+        size_t start = insertion.at + added;
+        if (offset < start)
+        {
+          break;
+        }
+        if (offset < start + insertion.length)
+        {
+          return insertion.at;
+        }
+        added += insertion.length;
+      }
+      return offset - added;
+    }
+
+    std::string line_of(const std::string &source, size_t line)
+    {
+      auto start = source.begin();
+      for (size_t i = 1; i < line; ++i)
+      {
+        start = std::find(start, source.end(), '\n') + 1;
+      }
+      return std::string(start, std::find(start, source.end(), '\n'));
+    }
+
+    // The suffix minja appends to an error raised at `pos` of `source`.
+    std::string location_suffix(const std::string &source, size_t pos)
+    {
+      auto it = source.begin() + pos;
+      size_t line = std::count(source.begin(), it, '\n') + 1;
+      size_t max_line = std::count(source.begin(), source.end(), '\n') + 1;
+      size_t line_start = pos == 0 ? std::string::npos : source.rfind('\n', pos - 1);
+      size_t column = line_start == std::string::npos ? pos + 1 : pos - line_start;
+
+      std::string out = " at row " + std::to_string(line) + ", column " + std::to_string(column) + ":\n";
+      if (line > 1)
+      {
+        out += line_of(source, line - 1) + "\n";
+      }
+      out += line_of(source, line) + "\n";
+      out += std::string(column - 1, ' ') + "^\n";
+      if (line < max_line)
+      {
+        out += line_of(source, line + 1) + "\n";
+      }
+      return out;
+    }
+
+    // Offset of row `row`, column `column` (both 1-based) in `source`, or npos.
+    size_t offset_of(const std::string &source, size_t row, size_t column)
+    {
+      size_t start = 0;
+      for (size_t i = 1; i < row; ++i)
+      {
+        start = source.find('\n', start);
+        if (start == std::string::npos)
+        {
+          return std::string::npos;
+        }
+        ++start;
+      }
+      size_t offset = start + column - 1;
+      return column > 0 && offset <= source.size() ? offset : std::string::npos;
+    }
+
+    // Reads the decimal number at `pos`, advancing past it; 0 if there is none.
+    size_t read_number(const std::string &text, size_t &pos)
+    {
+      size_t value = 0;
+      while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+      {
+        value = value * 10 + static_cast<size_t>(text[pos++] - '0');
+      }
+      return value;
+    }
+  } // namespace
+
+  std::string with_print_filter(std::string_view source)
+  {
+    return print_filtered(source, nullptr);
+  }
+
+  std::shared_ptr<minja::TemplateNode> parse_printing(const std::string &source)
+  {
+    try
+    {
+      return minja::Parser::parse(with_print_filter(source), minja::Options{});
+    }
+    catch (const std::bad_alloc &)
+    {
+      throw;
+    }
+    catch (const std::exception &)
+    {
+      minja::Parser::parse(source, minja::Options{});
+      throw;
+    }
+  }
+
+  std::string located_in_source(const std::string &source, const std::string &message)
+  {
+    static const std::string kMarker = " at row ";
+
+    std::vector<Insertion> insertions;
+    std::string filtered = print_filtered(source, &insertions);
+    if (insertions.empty())
+    {
+      return message;
+    }
+
+    std::string out;
+    size_t copied = 0;
+    for (size_t at = message.find(kMarker); at != std::string::npos; at = message.find(kMarker, at + 1))
+    {
+      size_t pos = at + kMarker.size();
+      size_t row = read_number(message, pos);
+      if (message.compare(pos, 9, ", column ") != 0)
+      {
+        continue;
+      }
+      pos += 9;
+      size_t offset = offset_of(filtered, row, read_number(message, pos));
+      if (offset == std::string::npos)
+      {
+        continue;
+      }
+      // Only a suffix minja produced for the filtered source is replaced.
+      std::string suffix = location_suffix(filtered, offset);
+      if (message.compare(at, suffix.size(), suffix) != 0)
+      {
+        continue;
+      }
+      out.append(message, copied, at - copied);
+      out += location_suffix(source, source_offset(insertions, offset));
+      copied = at + suffix.size();
+      at = copied - 1;
+    }
+    if (copied == 0)
+    {
+      return message;
+    }
+    out.append(message, copied, std::string::npos);
+    return out;
+  }
+
+  void rethrow_located(const std::string &source)
+  {
+    try
+    {
+      throw;
+    }
+    catch (const std::runtime_error &e)
+    {
+      if (typeid(e) == typeid(std::runtime_error))
+      {
+        std::string message = located_in_source(source, e.what());
+        if (message != e.what())
+        {
+          throw std::runtime_error(message);
+        }
+      }
+      throw;
+    }
+  }
+
+  minja::Value print_filter()
+  {
+    return minja::Value::callable([](const std::shared_ptr<minja::Context> &, minja::ArgumentsValue &args) {
+      auto &value = args.args.at(0);
+      if (value.is_boolean())
+      {
+        return minja::Value(value.get<bool>() ? "true" : "false");
+      }
+      if (value.is_array() || value.is_object())
+      {
+        std::string out;
+        append_dump(value, out);
+        return minja::Value(out);
+      }
+      // Strings, numbers and null print the way minja prints them; callables fail in minja's dump.
+      return std::move(value);
+    });
+  }
+} // namespace minja_shim_ext_internal
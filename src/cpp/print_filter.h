@@ -0,0 +1,35 @@
+#pragma once
+#include <minja/minja.hpp>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace minja_shim_ext_internal
+{
+  // The shim prints booleans as true/false where minja prints True/False. minja has no hook for how
+  // {{ ... }} writes its result, so every expression tag is parsed as `{{ (...) | _shim_print }}`
+  // and the filter, one of shim_builtins, turns the result into the text that should be printed.
+  // Text, string values and the output of filters such as `string` are never looked at. Each
+  // printed expression costs one more filter lookup through the context chain, and render errors
+  // must go through located_in_source so their excerpts show the source as written.
+  inline constexpr const char *kPrintFilterName = "_shim_print";
+
+  // `source` with the print filter applied to every non-empty expression tag. Delimiters,
+  // whitespace control and line breaks are kept as written.
+  std::string with_print_filter(std::string_view source);
+
+  // Parses `source` with the print filter applied. Parse errors are raised from the source as
+  // written, so their excerpts match what the caller passed in.
+  std::shared_ptr<minja::TemplateNode> parse_printing(const std::string &source);
+
+  // `message` with every location minja appended to it (" at row R, column C:" and the excerpt
+  // after it) moved from the parsed form of `source` back to `source` as written.
+  std::string located_in_source(const std::string &source, const std::string &message);
+
+  // Rethrows the exception being handled. minja's own errors (plain std::runtime_error) are
+  // rethrown with their locations in `source` as written; other exceptions are rethrown unchanged.
+  [[noreturn]] void rethrow_located(const std::string &source);
+
+  // The `_shim_print` filter.
+  minja::Value print_filter();
+} // namespace minja_shim_ext_internal
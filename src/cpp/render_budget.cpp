@@ -0,0 +1,47 @@
+#include "render_budget.h"
+
+namespace minja_shim_ext_internal
+{
+  RenderBudget::RenderBudget(uint64_t timeout_ns)
+      : has_deadline_(timeout_ns != 0),
+        deadline_(std::chrono::steady_clock::now() + std::chrono::nanoseconds(has_deadline_ ? timeout_ns : 0))
+  {
+  }
+
+  void RenderBudget::check()
+  {
+    if (cancelled_.load(std::memory_order_relaxed))
+    {
+      stop_ = Stop::Cancelled;
+      throw RenderStopped("Render was cancelled");
+    }
+    if (has_deadline_ && calls_++ % kClockInterval == 0 && std::chrono::steady_clock::now() >= deadline_)
+    {
+      stop_ = Stop::DeadlineExceeded;
+      throw RenderStopped("Render deadline exceeded");
+    }
+  }
+
+  BudgetContext::BudgetContext(const std::shared_ptr<minja::Context> &parent, RenderBudget &budget)
+      : minja::Context(minja::Value::object(), parent), budget_(budget)
+  {
+  }
+
+  minja::Value BudgetContext::get(const minja::Value &key)
+  {
+    budget_.check();
+    return minja::Context::get(key);
+  }
+
+  minja::Value &BudgetContext::at(const minja::Value &key)
+  {
+    budget_.check();
+    return minja::Context::at(key);
+  }
+
+  bool BudgetContext::contains(const minja::Value &key)
+  {
+    budget_.check();
+    return minja::Context::contains(key);
+  }
+} // namespace minja_shim_ext_internal
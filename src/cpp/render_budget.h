@@ -0,0 +1,87 @@
+#pragma once
+#include "render_sink.h"
+#include <minja/minja.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace minja_shim_ext_internal
+{
+  // Thrown from inside a render that was cancelled or ran past its deadline. minja rewraps
+  // exceptions raised below a node, so callers check RenderBudget::stop() rather than the type.
+  struct RenderStopped : std::runtime_error
+  {
+    explicit RenderStopped(const char *reason) : std::runtime_error(reason) {}
+  };
+
+  // Cancellation flag and deadline of one asynchronous render, shared with its cancel token.
+  class RenderBudget
+  {
+  public:
+    enum class Stop
+    {
+      None,
+      Cancelled,
+      DeadlineExceeded,
+    };
+
+    // timeout_ns is measured from construction; 0 means no deadline.
+    explicit RenderBudget(uint64_t timeout_ns);
+
+    // Safe to call from any thread, at any time.
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+    // Throws RenderStopped once the render has been cancelled or its deadline has passed. Called by
+    // the rendering thread only; the clock is read on every kClockInterval-th call.
+    void check();
+
+    Stop stop() const { return stop_; }
+
+  private:
+    static constexpr uint32_t kClockInterval = 64;
+
+    std::atomic<bool> cancelled_{false};
+    bool has_deadline_;
+    std::chrono::steady_clock::time_point deadline_;
+    uint32_t calls_ = 0;
+    Stop stop_ = Stop::None;
+  };
+
+  // Overlay placed between a render and its context. minja offers no hook inside its loops or
+  // between nodes, but every variable, filter and macro lookup that is not satisfied by a loop or
+  // macro scope reaches this context, so checking the budget here interrupts loops and recursion
+  // that do any lookup. Top-level `set` writes land in the overlay and leave the caller's context
+  // untouched.
+  class BudgetContext : public minja::Context
+  {
+  public:
+    BudgetContext(const std::shared_ptr<minja::Context> &parent, RenderBudget &budget);
+
+    minja::Value get(const minja::Value &key) override;
+    minja::Value &at(const minja::Value &key) override;
+    bool contains(const minja::Value &key) override;
+
+  private:
+    RenderBudget &budget_;
+  };
+
+  // String sink that checks the budget before every write, which covers loops that only print.
+  class BudgetSink : public StringSink
+  {
+  public:
+    BudgetSink(std::string &target, RenderBudget &budget) : StringSink(target), budget_(budget) {}
+
+  protected:
+    void write(const char *s, size_t n) override
+    {
+      budget_.check();
+      StringSink::write(s, n);
+    }
+
+  private:
+    RenderBudget &budget_;
+  };
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,69 @@
+#pragma once
+#include <minja/minja.hpp>
+#include <cstddef>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+namespace minja_shim_ext_internal
+{
+  // Base class for the stream buffers the shim renders into. Writes are passed through as they
+  // arrive; booleans have already been printed as true/false by the print filter (print_filter.h).
+  class RenderSink : public std::streambuf
+  {
+  public:
+    // Bytes handed to the sink so far, whether or not it could keep them.
+    size_t bytes_written() const { return bytes_written_; }
+
+  protected:
+    virtual void write(const char *s, size_t n) = 0;
+
+    std::streamsize xsputn(const char *s, std::streamsize n) final
+    {
+      bytes_written_ += static_cast<size_t>(n);
+      write(s, static_cast<size_t>(n));
+      return n;
+    }
+
+    int_type overflow(int_type ch) final
+    {
+      if (!traits_type::eq_int_type(ch, traits_type::eof()))
+      {
+        char c = traits_type::to_char_type(ch);
+        ++bytes_written_;
+        write(&c, 1);
+      }
+      return traits_type::not_eof(ch);
+    }
+
+  private:
+    size_t bytes_written_ = 0;
+  };
+
+  // Appends rendered output to a std::string. Clearing the string between renders keeps its
+  // capacity, so a retained string stops reallocating once it has grown.
+  class StringSink : public RenderSink
+  {
+  public:
+    explicit StringSink(std::string &target) : target_(target) {}
+
+  protected:
+    void write(const char *s, size_t n) override { target_.append(s, n); }
+
+  private:
+    std::string &target_;
+  };
+
+  // Render a template into a sink. minja renders into a std::ostringstream, so we hand it one
+  // whose buffer has been swapped for ours; the output never lands in the ostringstream's own
+  // string. Errors raised by the sink (allocation failures, aborts) are
+  // rethrown instead of being swallowed into the stream's badbit.
+  inline void render_to_sink(const std::shared_ptr<minja::TemplateNode> &tpl, const std::shared_ptr<minja::Context> &ctx, RenderSink &sink)
+  {
+    std::ostringstream out;
+    out.std::ios::rdbuf(&sink);
+    out.exceptions(std::ios::badbit);
+    tpl->render(out, ctx);
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,85 @@
+#include "render_spans.h"
+#include "chat_session.h"
+#include "render_sink.h"
+#include "template_cache.h"
+#include <string_view>
+
+namespace minja_shim_ext_internal
+{
+  namespace
+  {
+    std::shared_ptr<minja::Context> with_array(const std::shared_ptr<minja::Context> &ctx, const std::string &array, minja::Value items)
+    {
+      auto overlay = minja::Value::object();
+      overlay.set(minja::Value(array), std::move(items));
+      return minja::Context::make(std::move(overlay), ctx);
+    }
+  } // namespace
+
+  void render_with_spans(ShimTemplate &tpl, const std::shared_ptr<minja::Context> &ctx, const std::string &array, std::string &output, SpanLayout &layout)
+  {
+    auto loop = find_separable_loop(tpl.source, array);
+    if (!loop)
+    {
+      throw UnsupportedSpansError("Template does not render '" + array + "' element by element");
+    }
+
+    auto items = ctx->get(minja::Value(array));
+    if (!items.is_array())
+    {
+      throw std::invalid_argument("'" + array + "' must be an array");
+    }
+
+    output.clear();
+    render_to_string(tpl, ctx, output);
+
+    // The loop on its own renders exactly the elements it is given. Its source is cached like
+    // any other template, so repeated span renders parse it once.
+    auto body = TemplateCache::instance().get_or_parse(std::string_view(tpl.source).substr(loop->begin, loop->end - loop->begin));
+    std::string elements;
+    layout.elements.clear();
+    layout.elements.reserve(items.size());
+    for (size_t i = 0, count = items.size(); i < count; ++i)
+    {
+      auto single = minja::Value::array();
+      single.push_back(items.at(i));
+      size_t begin = elements.size();
+      StringSink sink(elements);
+      render_to_sink(body->root, with_array(ctx, array, std::move(single)), sink);
+      layout.elements.push_back({begin, elements.size()});
+    }
+
+    std::string empty;
+    {
+      StringSink sink(empty);
+      render_to_sink(tpl.root, with_array(ctx, array, minja::Value::array()), sink);
+    }
+
+    // Find the header length h with output == empty[0, h) + elements + empty[h, end). Several h
+    // can fit when the header ends or the footer starts like an element; the longest header wins,
+    // as in ChatSession::render_appended.
+    if (output.size() == empty.size() + elements.size())
+    {
+      size_t prefix = 0;
+      while (prefix < empty.size() && output[prefix] == empty[prefix])
+      {
+        ++prefix;
+      }
+      for (size_t header = prefix + 1; header-- > 0;)
+      {
+        if (output.compare(header, elements.size(), elements) == 0 &&
+            output.compare(header + elements.size(), std::string::npos, empty, header, std::string::npos) == 0)
+        {
+          for (auto &span : layout.elements)
+          {
+            span.begin += header;
+            span.end += header;
+          }
+          layout.tail = {header + elements.size(), output.size()};
+          return;
+        }
+      }
+    }
+    throw UnsupportedSpansError("Output of '" + array + "' elements rendered on their own does not match the full render");
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,38 @@
+#pragma once
+#include "handles.h"
+#include "minja_shim_ext.h"
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace minja_shim_ext_internal
+{
+  // Raised when a template does not render the requested array element by element, so the
+  // output cannot be split into per-element spans.
+  struct UnsupportedSpansError : std::runtime_error
+  {
+    explicit UnsupportedSpansError(const std::string &message) : std::runtime_error(message) {}
+  };
+
+  struct SpanLayout
+  {
+    std::vector<mj_span> elements; // One span per element, in order and adjacent
+    mj_span tail{};                // Output after the last element, e.g. the generation prompt
+  };
+
+  // Renders `tpl` into `output` and reports where the rendering of each element of the
+  // top-level array `array` starts and ends.
+  //
+  // minja does not expose loop boundaries while it renders, so the spans are derived instead:
+  // the template must pass the separability check of find_separable_loop. Each element is
+  // rendered on its own through the loop source, the template is rendered once more with an
+  // empty array to get header + footer, and the full output is checked to be exactly
+  // header + elements + footer. The check makes a mismatch (for example a header `set` the loop
+  // body reads) an error rather than wrong offsets.
+  //
+  // Throws UnsupportedSpansError when the template is not separable over `array` or the check
+  // fails, std::invalid_argument when `array` is not an array, and rethrows render errors.
+  void render_with_spans(ShimTemplate &tpl, const std::shared_ptr<minja::Context> &ctx, const std::string &array, std::string &output, SpanLayout &layout);
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,144 @@
+#include "result_cache.h"
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace minja_shim_ext_internal
+{
+  namespace
+  {
+    struct Key
+    {
+      ValueDigest template_digest;
+      ValueDigest digest;
+
+      bool operator==(const Key &other) const { return template_digest == other.template_digest && digest == other.digest; }
+    };
+
+    // Both digests are keyed SipHash output, so any of their bits will do.
+    struct KeyHash
+    {
+      size_t operator()(const Key &key) const { return static_cast<size_t>(key.digest.lo ^ key.template_digest.hi); }
+    };
+
+    struct Entry
+    {
+      Key key;
+      std::shared_ptr<const std::string> output;
+      size_t charge;
+    };
+  } // namespace
+
+  struct ResultCache::Shard
+  {
+    std::mutex mutex;
+    std::list<Entry> lru; // Most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    size_t bytes = 0;
+    size_t budget = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+    // Drops least recently used entries until the shard fits its budget. Caller holds the lock.
+    void trim()
+    {
+      while (bytes > budget && !lru.empty())
+      {
+        erase(std::prev(lru.end()));
+        ++evictions;
+      }
+    }
+
+    void erase(std::list<Entry>::iterator it)
+    {
+      bytes -= it->charge;
+      index.erase(it->key);
+      lru.erase(it);
+    }
+  };
+
+  ResultCache::ResultCache() : shards_(new Shard[kShardCount]) {}
+
+  ResultCache::~ResultCache() = default;
+
+  ResultCache &ResultCache::instance()
+  {
+    // Never destroyed, like the template cache.
+    static ResultCache *cache = new ResultCache();
+    return *cache;
+  }
+
+  std::shared_ptr<const std::string> ResultCache::find(const ValueDigest &template_digest, const ValueDigest &digest)
+  {
+    Key key{template_digest, digest};
+    Shard &shard = shards_[KeyHash{}(key) % kShardCount];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found == shard.index.end())
+    {
+      ++shard.misses;
+      return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+    ++shard.hits;
+    return found->second->output;
+  }
+
+  void ResultCache::insert(const ValueDigest &template_digest, const ValueDigest &digest, const std::string &output)
+  {
+    Key key{template_digest, digest};
+    Shard &shard = shards_[KeyHash{}(key) % kShardCount];
+    size_t charge = sizeof(Entry) + sizeof(std::string) + output.size();
+    auto copy = std::make_shared<const std::string>(output);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (charge > shard.budget || shard.index.count(key))
+    {
+      // Would not fit even in an empty shard, or a concurrent miss stored it first.
+      return;
+    }
+    shard.lru.push_front(Entry{key, std::move(copy), charge});
+    shard.index.emplace(key, shard.lru.begin());
+    shard.bytes += charge;
+    shard.trim();
+  }
+
+  void ResultCache::set_budget(size_t bytes)
+  {
+    g_value_digests_enabled.store(bytes > 0, std::memory_order_relaxed);
+    for (size_t i = 0; i < kShardCount; ++i)
+    {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      shards_[i].budget = bytes / kShardCount;
+      shards_[i].trim();
+    }
+  }
+
+  void ResultCache::clear()
+  {
+    for (size_t i = 0; i < kShardCount; ++i)
+    {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      shards_[i].lru.clear();
+      shards_[i].index.clear();
+      shards_[i].bytes = 0;
+    }
+  }
+
+  ResultCacheStats ResultCache::stats() const
+  {
+    ResultCacheStats stats{};
+    for (size_t i = 0; i < kShardCount; ++i)
+    {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      stats.hits += shards_[i].hits;
+      stats.misses += shards_[i].misses;
+      stats.evictions += shards_[i].evictions;
+      stats.entries += shards_[i].lru.size();
+      stats.bytes += shards_[i].bytes;
+      stats.budget += shards_[i].budget;
+    }
+    return stats;
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,54 @@
+#pragma once
+#include "value_digest.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace minja_shim_ext_internal
+{
+  struct ResultCacheStats
+  {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t entries;
+    uint64_t bytes;
+    uint64_t budget;
+  };
+
+  // Process-wide cache of rendered output keyed by (digest of the template source, digest of the
+  // root value), so identical requests (retries, fan-out, evaluation sweeps) skip the render. A hit
+  // is not compared against the values: both digests are keyed 128-bit SipHash (value_digest.h),
+  // so a collision cannot be found or forced from outside the process. Sharded
+  // and LRU-evicted like TemplateCache. It starts with a budget of zero, which turns it off: no
+  // lookups are made and value handles do not maintain digests.
+  //
+  // Cached renders take a root value rather than a context, so the output depends on nothing but
+  // the template and that value: there is no base context or host callback to go stale.
+  class ResultCache
+  {
+  public:
+    static ResultCache &instance();
+
+    bool enabled() const { return value_digests_enabled(); }
+
+    // The cached output for this key, or null on a miss.
+    std::shared_ptr<const std::string> find(const ValueDigest &template_digest, const ValueDigest &digest);
+    void insert(const ValueDigest &template_digest, const ValueDigest &digest, const std::string &output);
+
+    // A budget of zero turns the cache off and drops its entries.
+    void set_budget(size_t bytes);
+    void clear();
+    ResultCacheStats stats() const;
+
+  private:
+    ResultCache();
+    ~ResultCache();
+
+    struct Shard;
+    static constexpr size_t kShardCount = 16;
+
+    std::unique_ptr<Shard[]> shards_;
+  };
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,128 @@
+#include "shim_stats.h"
+
+namespace minja_shim_ext_internal
+{
+  std::atomic<bool> g_stats_enabled{false};
+
+  namespace
+  {
+    size_t bucket_of(uint64_t ns)
+    {
+      size_t bucket = 0;
+      while (ns > 1 && bucket + 1 < MJ_STATS_LATENCY_BUCKETS)
+      {
+        ns >>= 1;
+        ++bucket;
+      }
+      return bucket;
+    }
+  } // namespace
+
+  void LatencyHistogram::record(uint64_t ns)
+  {
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_ns_.fetch_add(ns, std::memory_order_relaxed);
+    buckets_[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void LatencyHistogram::snapshot(mj_latency_histogram &out) const
+  {
+    out.count = count_.load(std::memory_order_relaxed);
+    out.total_ns = total_ns_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < MJ_STATS_LATENCY_BUCKETS; ++i)
+    {
+      out.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  void LatencyHistogram::reset()
+  {
+    count_.store(0, std::memory_order_relaxed);
+    total_ns_.store(0, std::memory_order_relaxed);
+    for (auto &bucket : buckets_)
+    {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void RenderCounters::record(uint64_t ns, size_t output_bytes, bool succeeded)
+  {
+    renders_.fetch_add(1, std::memory_order_relaxed);
+    if (succeeded)
+    {
+      output_bytes_.fetch_add(output_bytes, std::memory_order_relaxed);
+    }
+    else
+    {
+      errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+    time_.record(ns);
+  }
+
+  void RenderCounters::snapshot(mj_render_stats &out) const
+  {
+    out.renders = renders_.load(std::memory_order_relaxed);
+    out.errors = errors_.load(std::memory_order_relaxed);
+    out.output_bytes = output_bytes_.load(std::memory_order_relaxed);
+    time_.snapshot(out.time);
+  }
+
+  void RenderCounters::reset()
+  {
+    renders_.store(0, std::memory_order_relaxed);
+    errors_.store(0, std::memory_order_relaxed);
+    output_bytes_.store(0, std::memory_order_relaxed);
+    time_.reset();
+  }
+
+  ShimStats &ShimStats::instance()
+  {
+    // Leaked so handles freed during static destruction can still update the gauges.
+    static ShimStats *stats = new ShimStats();
+    return *stats;
+  }
+
+  uint64_t ShimStats::record_parse(const StatsTimer &timer, bool succeeded)
+  {
+    if (!timer.active())
+    {
+      return 0;
+    }
+    uint64_t ns = timer.elapsed_ns();
+    parses_.fetch_add(1, std::memory_order_relaxed);
+    if (!succeeded)
+    {
+      parse_errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+    parse_time_.record(ns);
+    return ns;
+  }
+
+  void ShimStats::snapshot(mj_stats &out) const
+  {
+    out.enabled = stats_enabled() ? 1 : 0;
+    renders_.snapshot(out.render);
+    out.parses = parses_.load(std::memory_order_relaxed);
+    out.parse_errors = parse_errors_.load(std::memory_order_relaxed);
+    parse_time_.snapshot(out.parse_time);
+    for (size_t i = 0; i < MJ_STATS_ERROR_CODES; ++i)
+    {
+      out.errors_by_code[i] = errors_[i].load(std::memory_order_relaxed);
+    }
+    out.live_values = live_values.load(std::memory_order_relaxed);
+    out.live_contexts = live_contexts.load(std::memory_order_relaxed);
+    out.live_templates = live_templates.load(std::memory_order_relaxed);
+  }
+
+  void ShimStats::reset()
+  {
+    renders_.reset();
+    parses_.store(0, std::memory_order_relaxed);
+    parse_errors_.store(0, std::memory_order_relaxed);
+    parse_time_.reset();
+    for (auto &count : errors_)
+    {
+      count.store(0, std::memory_order_relaxed);
+    }
+  }
+} // namespace minja_shim_ext_internal
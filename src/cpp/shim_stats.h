@@ -0,0 +1,126 @@
+#pragma once
+#include "minja_shim_ext.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace minja_shim_ext_internal
+{
+  // Runtime switch for statistics collection. While it is off, every recording site costs one
+  // relaxed load and a branch; no clock is read and no counter is touched.
+  extern std::atomic<bool> g_stats_enabled;
+
+  inline bool stats_enabled()
+  {
+    return g_stats_enabled.load(std::memory_order_relaxed);
+  }
+
+  // Latency histogram with power-of-two buckets: bucket i counts durations in [2^i, 2^(i+1))
+  // nanoseconds, bucket 0 also takes 0 ns, and the last bucket is open-ended.
+  class LatencyHistogram
+  {
+  public:
+    void record(uint64_t ns);
+    void snapshot(mj_latency_histogram &out) const;
+    void reset();
+
+  private:
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> total_ns_{0};
+    std::array<std::atomic<uint64_t>, MJ_STATS_LATENCY_BUCKETS> buckets_{};
+  };
+
+  // Render counters kept both process-wide and for each parsed template.
+  class RenderCounters
+  {
+  public:
+    void record(uint64_t ns, size_t output_bytes, bool succeeded);
+    void snapshot(mj_render_stats &out) const;
+    void reset();
+
+  private:
+    std::atomic<uint64_t> renders_{0};
+    std::atomic<uint64_t> errors_{0};
+    std::atomic<uint64_t> output_bytes_{0};
+    LatencyHistogram time_;
+  };
+
+  // Measures one operation when collection was on as it started; elapsed_ns() is 0 otherwise.
+  class StatsTimer
+  {
+  public:
+    StatsTimer() : active_(stats_enabled())
+    {
+      if (active_)
+      {
+        start_ = std::chrono::steady_clock::now();
+      }
+    }
+
+    bool active() const { return active_; }
+
+    uint64_t elapsed_ns() const
+    {
+      if (!active_)
+      {
+        return 0;
+      }
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+    }
+
+  private:
+    bool active_;
+    std::chrono::steady_clock::time_point start_{};
+  };
+
+  // Process-wide statistics behind mj_get_stats.
+  class ShimStats
+  {
+  public:
+    static ShimStats &instance();
+
+    RenderCounters &renders() { return renders_; }
+
+    // Records a parse and returns its duration, or 0 when the timer was inactive.
+    uint64_t record_parse(const StatsTimer &timer, bool succeeded);
+
+    void record_error(int code)
+    {
+      size_t slot = code > 0 && code < MJ_STATS_ERROR_CODES ? static_cast<size_t>(code) : 0;
+      errors_[slot].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Live handle gauges. Value and context handles are only counted while collection is on
+    // (see ValueHandle::counted); template handles are always counted, since a parse dwarfs
+    // the cost of an atomic increment.
+    std::atomic<int64_t> live_values{0};
+    std::atomic<int64_t> live_contexts{0};
+    std::atomic<int64_t> live_templates{0};
+
+    void snapshot(mj_stats &out) const;
+
+    // Zeroes counters and histograms. Live handle gauges are left alone.
+    void reset();
+
+  private:
+    ShimStats() = default;
+
+    RenderCounters renders_;
+    std::atomic<uint64_t> parses_{0};
+    std::atomic<uint64_t> parse_errors_{0};
+    LatencyHistogram parse_time_;
+    std::array<std::atomic<uint64_t>, MJ_STATS_ERROR_CODES> errors_{};
+  };
+
+  // Counts an error code returned by the C API when collection is on, and passes it through.
+  inline int record_error(int code)
+  {
+    if (stats_enabled())
+    {
+      ShimStats::instance().record_error(code);
+    }
+    return code;
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,640 @@
+#include "template_analysis.h"
+#include "template_scan.h"
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace minja_shim_ext_internal
+{
+  namespace
+  {
+    using Tokens = std::vector<TemplateToken>;
+    using Kind = TemplateToken::Kind;
+
+    const std::unordered_set<std::string_view> kKeywords = {
+        "and", "or", "not", "in", "is", "if", "else", "true", "false", "none", "True", "False", "None", "recursive"};
+
+    // Globals minja defines itself; calling them reads nothing from the context.
+    const std::unordered_set<std::string_view> kBuiltinFunctions = {
+        "range", "namespace", "raise_exception", "strftime_now", "dict", "joiner", "cycler", "lipsum"};
+
+    // Methods of minja lists and dicts that change them in place.
+    const std::unordered_set<std::string_view> kEditingMethods = {
+        "append", "extend", "insert", "pop", "remove", "clear", "update", "setdefault"};
+
+    // Filters that only look at the size of their input.
+    const std::unordered_set<std::string_view> kShapeFilters = {"length", "count"};
+
+    std::optional<std::string> unquote(std::string_view literal)
+    {
+      if (literal.size() < 2 || literal.find('\\') != std::string_view::npos)
+      {
+        return std::nullopt;
+      }
+      return std::string(literal.substr(1, literal.size() - 2));
+    }
+
+    // A name bound by the template. A loop variable over an access path aliases the path's
+    // elements; anything else holds data the template made itself. For `loop` itself, `path` is
+    // the elements' path (empty if the iterable is not one), which loop.previtem and
+    // loop.nextitem alias.
+    struct Binding
+    {
+      bool alias;
+      AccessPath path;
+      bool loop = false;
+    };
+
+    struct Scope
+    {
+      std::unordered_map<std::string_view, Binding> names;
+      int conditional = 0; // Open `if` blocks in this scope
+    };
+
+    // An access chain such as messages[0].content, starting at an identifier.
+    struct Chain
+    {
+      size_t end;           // First token after the chain
+      bool tracked = false; // Rooted in the context rather than in template data
+      bool call = false;    // Ends in a method call; `end` is at its '('
+      AccessPath path;
+    };
+
+    class Analyzer
+    {
+    public:
+      explicit Analyzer(TemplateAnalysis &out) : out_(out), scopes_(1) {}
+
+      void statement(const Tokens &t)
+      {
+        std::string_view keyword = t[0].text;
+        size_t n = t.size();
+
+        if (keyword == "for")
+        {
+          for_statement(t);
+        }
+        else if (keyword == "endfor" || keyword == "endmacro" || keyword == "endcall")
+        {
+          pop_scope();
+        }
+        else if (keyword == "if")
+        {
+          ++scopes_.back().conditional;
+          expression(t, 1, n);
+        }
+        else if (keyword == "elif")
+        {
+          expression(t, 1, n);
+        }
+        else if (keyword == "endif")
+        {
+          scopes_.back().conditional = std::max(0, scopes_.back().conditional - 1);
+        }
+        else if (keyword == "set")
+        {
+          set_statement(t);
+        }
+        else if (keyword == "macro")
+        {
+          // {% macro name(param, param=default) %}
+          if (n > 1 && t[1].kind == Kind::Identifier)
+          {
+            bind(t[1].text, {false, {}});
+          }
+          push_scope();
+          for (std::string_view name : {"caller", "varargs", "kwargs"})
+          {
+            bind(name, {false, {}});
+          }
+          for (size_t i = 3, depth = 1; i < n && depth > 0; ++i)
+          {
+            std::string_view text = t[i].text;
+            if (text == "(" || text == "[" || text == "{")
+            {
+              ++depth;
+            }
+            else if (text == ")" || text == "]" || text == "}")
+            {
+              --depth;
+            }
+            else if (depth == 1 && t[i].kind == Kind::Identifier && (t[i - 1].text == "(" || t[i - 1].text == ","))
+            {
+              bind(text, {false, {}});
+            }
+          }
+          expression(t, 2, n);
+        }
+        else if (keyword == "call")
+        {
+          // {% call(args) macro(...) %}: the arguments are bound inside the call body.
+          size_t i = 1;
+          push_scope();
+          if (i < n && t[i].text == "(")
+          {
+            for (++i; i < n && t[i].text != ")"; ++i)
+            {
+              if (t[i].kind == Kind::Identifier)
+              {
+                bind(t[i].text, {false, {}});
+              }
+            }
+            ++i;
+          }
+          expression(t, i, n);
+        }
+        else if (keyword == "filter")
+        {
+          if (n > 1 && t[1].kind == Kind::Identifier)
+          {
+            out_.filters.insert(std::string(t[1].text));
+          }
+          expression(t, 2, n);
+        }
+        else if (keyword == "else" || keyword == "endset" || keyword == "endfilter" || keyword == "generation" ||
+                 keyword == "endgeneration" || keyword == "break" || keyword == "continue" || keyword == "raw" ||
+                 keyword == "endraw")
+        {
+        }
+        else
+        {
+          // include, import, extends, block, ...: minja rejects most of these, and none are followed.
+          out_.complete = false;
+          expression(t, 1, n);
+        }
+      }
+
+      void expression(const Tokens &t, size_t begin, size_t end)
+      {
+        size_t i = begin;
+        while (i < end)
+        {
+          const auto &token = t[i];
+          if (token.kind != Kind::Identifier)
+          {
+            if (token.text == "|" && i + 1 < end && t[i + 1].kind == Kind::Identifier)
+            {
+              out_.filters.insert(std::string(t[i + 1].text));
+              i += 2;
+              continue;
+            }
+            ++i;
+            continue;
+          }
+
+          std::string_view name = token.text;
+          if (i > begin && t[i - 1].text == ".")
+          {
+            ++i; // Attribute of a value the template computed, e.g. a call result
+          }
+          else if (name == "is")
+          {
+            size_t j = i + 1;
+            if (j < end && t[j].text == "not")
+            {
+              ++j;
+            }
+            if (j < end && t[j].kind == Kind::Identifier)
+            {
+              out_.tests.insert(std::string(t[j].text));
+              ++j;
+            }
+            i = j;
+          }
+          else if (kKeywords.count(name) || (i + 1 < end && t[i + 1].text == "="))
+          {
+            ++i; // Keyword, or the name of a keyword argument
+          }
+          else if (i + 1 < end && t[i + 1].text == "(")
+          {
+            call(name);
+            ++i;
+          }
+          else
+          {
+            Chain chain = parse_chain(t, i, end);
+            if (chain.tracked)
+            {
+              bool shape = !chain.call && chain.end < end &&
+                           (t[chain.end].text == "is" ||
+                            (t[chain.end].text == "|" && chain.end + 1 < end && kShapeFilters.count(t[chain.end + 1].text)));
+              (shape ? out_.shapes : out_.paths).insert(chain.path);
+            }
+            i = chain.end;
+          }
+        }
+      }
+
+    private:
+      void for_statement(const Tokens &t)
+      {
+        // {% for target[, target] in iterable [if condition] [recursive] %}
+        size_t n = t.size();
+        size_t in = 1;
+        while (in < n && t[in].text != "in")
+        {
+          ++in;
+        }
+        size_t iterable_end = in + 1;
+        for (int depth = 0; iterable_end < n; ++iterable_end)
+        {
+          std::string_view text = t[iterable_end].text;
+          if (text == "(" || text == "[" || text == "{")
+          {
+            ++depth;
+          }
+          else if (text == ")" || text == "]" || text == "}")
+          {
+            --depth;
+          }
+          else if (depth == 0 && t[iterable_end].kind == Kind::Identifier && (text == "if" || text == "recursive"))
+          {
+            break;
+          }
+        }
+        if (in >= n)
+        {
+          out_.complete = false;
+          push_scope();
+          return;
+        }
+
+        bool single = in == 2 && t[1].kind == Kind::Identifier;
+        std::optional<AccessPath> source;
+        if (single)
+        {
+          source = exact_path(t, in + 1, iterable_end);
+        }
+        if (source)
+        {
+          out_.shapes.insert(*source);
+        }
+        else
+        {
+          expression(t, in + 1, iterable_end);
+        }
+
+        AccessPath items;
+        if (source)
+        {
+          items = *source;
+          items.push_back("*");
+        }
+        push_scope();
+        bind("loop", {false, items, true});
+        for (size_t i = 1; i < in; ++i)
+        {
+          if (t[i].kind == Kind::Identifier)
+          {
+            bind(t[i].text, {source.has_value(), items});
+          }
+        }
+        if (iterable_end < n && t[iterable_end].text == "if")
+        {
+          expression(t, iterable_end + 1, n);
+        }
+      }
+
+      void set_statement(const Tokens &t)
+      {
+        size_t n = t.size();
+        size_t eq = 1;
+        while (eq < n && t[eq].text != "=")
+        {
+          ++eq;
+        }
+
+        if (eq == n)
+        {
+          // {% set name | filter %}...{% endset %}
+          if (n > 1 && t[1].kind == Kind::Identifier)
+          {
+            rebind(t[1].text);
+          }
+          expression(t, 2, n);
+          return;
+        }
+
+        // An unconditional `set name = path` aliases the path, like a loop variable.
+        if (eq == 2 && t[1].kind == Kind::Identifier && scopes_.back().conditional == 0)
+        {
+          if (auto path = exact_path(t, eq + 1, n))
+          {
+            bind(t[1].text, {true, std::move(*path)});
+            return;
+          }
+        }
+
+        expression(t, eq + 1, n);
+        if (eq == 4 && t[2].text == ".")
+        {
+          return; // Attribute of a namespace object
+        }
+        for (size_t i = 1; i < eq; ++i)
+        {
+          if (t[i].kind == Kind::Identifier)
+          {
+            rebind(t[i].text);
+          }
+        }
+      }
+
+      // The access path of a chain that spans exactly [begin, end), if any.
+      std::optional<AccessPath> exact_path(const Tokens &t, size_t begin, size_t end)
+      {
+        if (begin >= end || t[begin].kind != Kind::Identifier || kKeywords.count(t[begin].text) ||
+            (begin + 1 < end && t[begin + 1].text == "("))
+        {
+          return std::nullopt;
+        }
+        Chain chain = parse_chain(t, begin, end);
+        if (!chain.tracked || chain.call || chain.end != end)
+        {
+          return std::nullopt;
+        }
+        return chain.path;
+      }
+
+      Chain parse_chain(const Tokens &t, size_t i, size_t end)
+      {
+        Chain chain;
+        std::string_view root = t[i].text;
+        if (const Binding *binding = lookup(root))
+        {
+          chain.tracked = binding->alias;
+          chain.path = binding->path;
+          if (binding->loop && neighbour_item(t, i + 1, end))
+          {
+            chain.tracked = !binding->path.empty();
+            i += t[i + 1].text == "." ? 2 : 3;
+          }
+        }
+        else
+        {
+          chain.tracked = true;
+          chain.path = {std::string(root)};
+          out_.variables.insert(std::string(root));
+        }
+
+        ++i;
+        while (i < end)
+        {
+          if (t[i].text == "." && i + 1 < end && t[i + 1].kind == Kind::Identifier)
+          {
+            if (i + 2 < end && t[i + 2].text == "(")
+            {
+              // A method reads the whole value, except get() with a literal key, which reads that key.
+              if (t[i + 1].text == "get" && i + 4 < end && t[i + 3].kind == Kind::String &&
+                  (t[i + 4].text == ")" || t[i + 4].text == ","))
+              {
+                if (auto key = unquote(t[i + 3].text))
+                {
+                  chain.path.push_back(*key);
+                }
+              }
+              chain.call = true;
+              i += 2;
+              break;
+            }
+            chain.path.push_back(std::string(t[i + 1].text));
+            i += 2;
+            continue;
+          }
+
+          if (t[i].text == "[")
+          {
+            if (i + 2 < end && t[i + 1].kind == Kind::String && t[i + 2].text == "]")
+            {
+              if (auto key = unquote(t[i + 1].text))
+              {
+                chain.path.push_back(*key);
+                i += 3;
+                continue;
+              }
+            }
+
+            // A constant index selects an element, a constant slice keeps the array.
+            size_t j = i + 1;
+            bool slice = false;
+            bool constant = true;
+            for (; j < end && t[j].text != "]"; ++j)
+            {
+              if (t[j].text == ":")
+              {
+                slice = true;
+              }
+              else if (t[j].kind != Kind::Number && t[j].text != "-")
+              {
+                constant = false;
+                break;
+              }
+            }
+            if (constant && j < end && j > i + 1)
+            {
+              if (!slice)
+              {
+                chain.path.push_back("*");
+              }
+              i = j + 1;
+              continue;
+            }
+
+            // Computed subscript: any element or key may be selected.
+            size_t close = i + 1;
+            for (int depth = 0; close < end; ++close)
+            {
+              std::string_view text = t[close].text;
+              if (text == "(" || text == "[" || text == "{")
+              {
+                ++depth;
+              }
+              else if (text == ")" || text == "}" || (text == "]" && depth > 0))
+              {
+                --depth;
+              }
+              else if (text == "]")
+              {
+                break;
+              }
+            }
+            expression(t, i + 1, close);
+            if (chain.tracked)
+            {
+              out_.dynamic = true;
+            }
+            chain.path.push_back("*");
+            i = close < end ? close + 1 : end;
+            continue;
+          }
+          break;
+        }
+        chain.end = i;
+        return chain;
+      }
+
+      // `.previtem` / `.nextitem` or `['previtem']` / `['nextitem']` at `i`.
+      static bool neighbour_item(const Tokens &t, size_t i, size_t end)
+      {
+        auto neighbour = [](std::string_view name) { return name == "previtem" || name == "nextitem"; };
+        if (i + 1 < end && t[i].text == "." && t[i + 1].kind == Kind::Identifier)
+        {
+          return neighbour(t[i + 1].text);
+        }
+        if (i + 2 < end && t[i].text == "[" && t[i + 1].kind == Kind::String && t[i + 2].text == "]")
+        {
+          auto key = unquote(t[i + 1].text);
+          return key && neighbour(*key);
+        }
+        return false;
+      }
+
+      void call(std::string_view name)
+      {
+        if (const Binding *binding = lookup(name))
+        {
+          if (binding->loop)
+          {
+            // A recursive loop: the body runs again over whatever loop(...) is passed.
+            out_.complete = false;
+          }
+          else if (binding->alias)
+          {
+            out_.paths.insert(binding->path);
+          }
+          return;
+        }
+        out_.functions.insert(std::string(name));
+        if (!kBuiltinFunctions.count(name))
+        {
+          // A callable supplied through the context.
+          out_.variables.insert(std::string(name));
+          out_.paths.insert({std::string(name)});
+        }
+      }
+
+      const Binding *lookup(std::string_view name) const
+      {
+        for (auto it = scopes_.rbegin(); it != scopes_.rend(); ++it)
+        {
+          auto found = it->names.find(name);
+          if (found != it->names.end())
+          {
+            return &found->second;
+          }
+        }
+        return nullptr;
+      }
+
+      void bind(std::string_view name, Binding binding)
+      {
+        scopes_.back().names[name] = std::move(binding);
+      }
+
+      // Binds a name assigned by `set`. An assignment inside a branch may not run, so whatever the
+      // name meant before may still be read through it afterwards.
+      void rebind(std::string_view name)
+      {
+        if (scopes_.back().conditional > 0)
+        {
+          const Binding *binding = lookup(name);
+          if (!binding)
+          {
+            out_.variables.insert(std::string(name));
+            out_.paths.insert({std::string(name)});
+          }
+          else if (binding->alias)
+          {
+            out_.paths.insert(binding->path);
+          }
+        }
+        bind(name, {false, {}});
+      }
+
+      void push_scope() { scopes_.emplace_back(); }
+
+      void pop_scope()
+      {
+        if (scopes_.size() > 1)
+        {
+          scopes_.pop_back();
+        }
+      }
+
+      TemplateAnalysis &out_;
+      std::vector<Scope> scopes_;
+    };
+  } // namespace
+
+  TemplateAnalysis analyze_template(std::string_view source)
+  {
+    TemplateAnalysis analysis;
+    Analyzer analyzer(analysis);
+    for (const auto &segment : scan_template(source))
+    {
+      if (segment.kind == TemplateSegment::Kind::Text || segment.kind == TemplateSegment::Kind::Comment)
+      {
+        continue;
+      }
+      auto tokens = tokenize_tag(segment.body);
+      if (tokens.empty())
+      {
+        continue;
+      }
+      if (segment.kind == TemplateSegment::Kind::Statement)
+      {
+        analyzer.statement(tokens);
+      }
+      else
+      {
+        analyzer.expression(tokens, 0, tokens.size());
+      }
+    }
+
+    // A full read covers a shape read of the same value.
+    for (const auto &path : analysis.paths)
+    {
+      analysis.shapes.erase(path);
+    }
+    return analysis;
+  }
+
+  bool may_edit_values(std::string_view source)
+  {
+    for (const auto &segment : scan_template(source))
+    {
+      if (segment.kind != TemplateSegment::Kind::Expression && segment.kind != TemplateSegment::Kind::Statement)
+      {
+        continue;
+      }
+      auto t = tokenize_tag(segment.body);
+      bool set = segment.kind == TemplateSegment::Kind::Statement && !t.empty() && t[0].text == "set";
+      for (size_t i = 1; i + 1 < t.size(); ++i)
+      {
+        if (t[i - 1].text != "." || t[i].kind != Kind::Identifier)
+        {
+          continue;
+        }
+        if (t[i + 1].text == "(" ? kEditingMethods.count(t[i].text) > 0 : set && t[i + 1].text == "=")
+        {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  std::string analysis_to_json(const TemplateAnalysis &analysis)
+  {
+    nlohmann::ordered_json json;
+    json["variables"] = analysis.variables;
+    json["paths"] = analysis.paths;
+    json["shapes"] = analysis.shapes;
+    json["filters"] = analysis.filters;
+    json["tests"] = analysis.tests;
+    json["functions"] = analysis.functions;
+    json["dynamic"] = analysis.dynamic;
+    json["complete"] = analysis.complete;
+    return json.dump();
+  }
+} // namespace minja_shim_ext_internal
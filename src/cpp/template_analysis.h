@@ -0,0 +1,43 @@
+#pragma once
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace minja_shim_ext_internal
+{
+  // Access path into the context: a top-level variable followed by object keys, with "*" standing
+  // for any array element (messages[*].content is {"messages", "*", "content"}).
+  using AccessPath = std::vector<std::string>;
+
+  // What a template may read from its context, found by a lexical pass over the source.
+  struct TemplateAnalysis
+  {
+    std::set<std::string> variables; // Top-level variables read, builtins excluded
+    std::set<AccessPath> paths;      // Values that may be read in full (printed, compared, serialised, ...)
+    std::set<AccessPath> shapes;     // Values only inspected for type, length or truthiness, or iterated
+    std::set<std::string> filters;
+    std::set<std::string> tests;
+    std::set<std::string> functions; // Called globals, builtins included
+    bool dynamic = false;            // A key or index is computed; the path up to it is listed in `paths`
+    bool complete = true;            // False when the template uses a construct the pass does not follow
+  };
+
+  // Analyses template source. Names bound by the template (loop variables, `set`, macros and their
+  // parameters) are followed rather than reported: a loop variable stands for an element of what
+  // it iterates, so `{% for m in messages %}{{ m.role }}` reads messages[*].role, and so do
+  // loop.previtem and loop.nextitem. Values reached through `set` are treated as read in full.
+  // Recursive loops are not followed.
+  //
+  // The result over-approximates: every read the template can make at run time is covered by a
+  // path or shape (a shape of an object covers its keys), unless `complete` is false.
+  TemplateAnalysis analyze_template(std::string_view source);
+
+  // True when the source may edit a value it did not create: it calls a method that changes its
+  // object in place (append, pop, update, ...), or `set`s an attribute (`{% set ns.x = ... %}`,
+  // which also writes into context objects). Lexical, so it over-approximates.
+  bool may_edit_values(std::string_view source);
+
+  // Serialises an analysis as the JSON document returned by mj_template_analyze.
+  std::string analysis_to_json(const TemplateAnalysis &analysis);
+} // namespace minja_shim_ext_internal
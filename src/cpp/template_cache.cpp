@@ -0,0 +1,146 @@
+#include "template_cache.h"
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace minja_shim_ext_internal
+{
+  namespace
+  {
+    // The parsed tree is not measurable from outside minja, so each entry is charged a fixed
+    // multiple of its source length (the template keeps its source, which is also used for
+    // collision checks).
+    constexpr size_t kChargePerSourceByte = 4;
+
+    struct Entry
+    {
+      uint64_t hash;
+      std::shared_ptr<ShimTemplate> tpl;
+      size_t charge;
+    };
+  } // namespace
+
+  struct TemplateCache::Shard
+  {
+    std::mutex mutex;
+    std::list<Entry> lru; // Most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    size_t bytes = 0;
+    size_t budget = kDefaultBudget / kShardCount;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+    // Drops least recently used entries until the shard fits its budget. Caller holds the lock.
+    void trim()
+    {
+      while (bytes > budget && !lru.empty())
+      {
+        erase(std::prev(lru.end()));
+        ++evictions;
+      }
+    }
+
+    void erase(std::list<Entry>::iterator it)
+    {
+      bytes -= it->charge;
+      index.erase(it->hash);
+      lru.erase(it);
+    }
+  };
+
+  TemplateCache::TemplateCache() : shards_(new Shard[kShardCount]) {}
+
+  TemplateCache::~TemplateCache() = default;
+
+  TemplateCache &TemplateCache::instance()
+  {
+    // Never destroyed: handles may still be freed from other threads during process exit.
+    static TemplateCache *cache = new TemplateCache();
+    return *cache;
+  }
+
+  std::shared_ptr<ShimTemplate> TemplateCache::get_or_parse(std::string_view source)
+  {
+    const uint64_t hash = std::hash<std::string_view>{}(source);
+    Shard &shard = shards_[hash % kShardCount];
+
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto found = shard.index.find(hash);
+      if (found != shard.index.end() && found->second->tpl->source == source)
+      {
+        shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+        ++shard.hits;
+        return found->second->tpl;
+      }
+      ++shard.misses;
+    }
+
+    // Parse without holding the shard lock; a concurrent miss on the same source may parse
+    // it too, in which case the first insert wins.
+    auto tpl = parse_template(std::string(source));
+    size_t charge = sizeof(Entry) + source.size() * kChargePerSourceByte;
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(hash);
+    if (found != shard.index.end())
+    {
+      if (found->second->tpl->source == source)
+      {
+        return found->second->tpl;
+      }
+      // Hash collision with a different source: the newer template replaces the older one.
+      shard.erase(found->second);
+    }
+    if (charge > shard.budget)
+    {
+      // Would evict the whole shard and still not fit.
+      return tpl;
+    }
+    shard.lru.push_front(Entry{hash, tpl, charge});
+    shard.index.emplace(hash, shard.lru.begin());
+    shard.bytes += charge;
+    shard.trim();
+    return tpl;
+  }
+
+  void TemplateCache::set_budget(size_t bytes)
+  {
+    for (size_t i = 0; i < kShardCount; ++i)
+    {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      shards_[i].budget = bytes / kShardCount;
+      shards_[i].trim();
+    }
+  }
+
+  void TemplateCache::clear()
+  {
+    for (size_t i = 0; i < kShardCount; ++i)
+    {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      shards_[i].lru.clear();
+      shards_[i].index.clear();
+      shards_[i].bytes = 0;
+    }
+  }
+
+  TemplateCacheStats TemplateCache::stats() const
+  {
+    TemplateCacheStats stats{};
+    for (size_t i = 0; i < kShardCount; ++i)
+    {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      stats.hits += shards_[i].hits;
+      stats.misses += shards_[i].misses;
+      stats.evictions += shards_[i].evictions;
+      stats.entries += shards_[i].lru.size();
+      stats.bytes += shards_[i].bytes;
+      stats.budget += shards_[i].budget;
+    }
+    return stats;
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,50 @@
+#pragma once
+#include "handles.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace minja_shim_ext_internal
+{
+  struct TemplateCacheStats
+  {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t entries;
+    uint64_t bytes;
+    uint64_t budget;
+  };
+
+  // Process-wide cache of parsed templates keyed by a hash of their source. Entries are spread
+  // over independently locked shards, each with its own LRU list and an equal share of the byte
+  // budget, so concurrent lookups only contend when they land on the same shard.
+  //
+  // Evicting an entry only drops the cache's reference; templates already handed out stay alive
+  // until their last handle is freed.
+  class TemplateCache
+  {
+  public:
+    static constexpr size_t kDefaultBudget = 64 * 1024 * 1024;
+
+    static TemplateCache &instance();
+
+    // Returns the cached tree for `source`, parsing and inserting it on a miss. Parse errors
+    // propagate and nothing is cached.
+    std::shared_ptr<ShimTemplate> get_or_parse(std::string_view source);
+
+    void set_budget(size_t bytes);
+    void clear();
+    TemplateCacheStats stats() const;
+
+  private:
+    TemplateCache();
+    ~TemplateCache();
+
+    struct Shard;
+    static constexpr size_t kShardCount = 16;
+
+    std::unique_ptr<Shard[]> shards_;
+  };
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,226 @@
+#include "template_scan.h"
+#include <cctype>
+
+namespace minja_shim_ext_internal
+{
+  namespace
+  {
+    bool is_ident_start(char c) { return std::isalpha(static_cast<unsigned char>(c)) || c == '_'; }
+    bool is_ident_char(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+    bool is_space(char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; }
+
+    // Finds `close` (e.g. "}}") after `pos`, skipping over string literals. Returns npos if absent.
+    size_t find_tag_end(std::string_view source, size_t pos, std::string_view close, bool skip_strings)
+    {
+      while (pos < source.size())
+      {
+        char c = source[pos];
+        if (skip_strings && (c == '\'' || c == '"'))
+        {
+          ++pos;
+          while (pos < source.size() && source[pos] != c)
+          {
+            pos += source[pos] == '\\' ? 2 : 1;
+          }
+          ++pos;
+          continue;
+        }
+        if (source.compare(pos, close.size(), close) == 0)
+        {
+          return pos;
+        }
+        ++pos;
+      }
+      return std::string_view::npos;
+    }
+
+    std::string_view trim(std::string_view s)
+    {
+      while (!s.empty() && is_space(s.front()))
+      {
+        s.remove_prefix(1);
+      }
+      while (!s.empty() && is_space(s.back()))
+      {
+        s.remove_suffix(1);
+      }
+      return s;
+    }
+  } // namespace
+
+  std::string_view statement_keyword(std::string_view body)
+  {
+    body = trim(body);
+    size_t n = 0;
+    while (n < body.size() && is_ident_char(body[n]))
+    {
+      ++n;
+    }
+    return body.substr(0, n);
+  }
+
+  std::vector<TemplateSegment> scan_template(std::string_view source)
+  {
+    std::vector<TemplateSegment> segments;
+    size_t text_begin = 0;
+    size_t pos = 0;
+
+    auto emit_text = [&](size_t end) {
+      if (end > text_begin)
+      {
+        segments.push_back({TemplateSegment::Kind::Text, text_begin, end, source.substr(text_begin, end - text_begin)});
+      }
+    };
+
+    while ((pos = source.find('{', pos)) != std::string_view::npos && pos + 1 < source.size())
+    {
+      char opener = source[pos + 1];
+      TemplateSegment::Kind kind;
+      std::string_view close;
+      if (opener == '{')
+      {
+        kind = TemplateSegment::Kind::Expression;
+        close = "}}";
+      }
+      else if (opener == '%')
+      {
+        kind = TemplateSegment::Kind::Statement;
+        close = "%}";
+      }
+      else if (opener == '#')
+      {
+        kind = TemplateSegment::Kind::Comment;
+        close = "#}";
+      }
+      else
+      {
+        ++pos;
+        continue;
+      }
+
+      size_t inner = pos + 2;
+      size_t close_pos = find_tag_end(source, inner, close, kind != TemplateSegment::Kind::Comment);
+      if (close_pos == std::string_view::npos)
+      {
+        break;
+      }
+
+      TemplateSegment segment{kind, pos, close_pos + 2, {}};
+      size_t body_begin = inner;
+      size_t body_end = close_pos;
+      if (body_begin < body_end && (source[body_begin] == '-' || source[body_begin] == '+'))
+      {
+        segment.trim_left = source[body_begin] == '-';
+        ++body_begin;
+      }
+      if (body_end > body_begin && (source[body_end - 1] == '-' || source[body_end - 1] == '+'))
+      {
+        segment.trim_right = source[body_end - 1] == '-';
+        --body_end;
+      }
+      segment.body = source.substr(body_begin, body_end - body_begin);
+
+      emit_text(pos);
+      segments.push_back(segment);
+      pos = segment.end;
+      text_begin = pos;
+
+      if (kind == TemplateSegment::Kind::Statement && statement_keyword(segment.body) == "raw")
+      {
+        // Everything up to the matching {% endraw %} is literal text.
+        size_t search = pos;
+        for (;;)
+        {
+          size_t tag = source.find("{%", search);
+          if (tag == std::string_view::npos)
+          {
+            search = source.size();
+            break;
+          }
+          size_t tag_end = source.find("%}", tag + 2);
+          if (tag_end == std::string_view::npos)
+          {
+            search = source.size();
+            break;
+          }
+          std::string_view body = source.substr(tag + 2, tag_end - tag - 2);
+          if (!body.empty() && (body.front() == '-' || body.front() == '+'))
+          {
+            body.remove_prefix(1);
+          }
+          if (statement_keyword(body) == "endraw")
+          {
+            emit_text(tag);
+            text_begin = pos = tag;
+            break;
+          }
+          search = tag_end + 2;
+        }
+        if (search == source.size())
+        {
+          break;
+        }
+      }
+    }
+
+    emit_text(source.size());
+    return segments;
+  }
+
+  std::vector<TemplateToken> tokenize_tag(std::string_view body)
+  {
+    std::vector<TemplateToken> tokens;
+    size_t pos = 0;
+    while (pos < body.size())
+    {
+      char c = body[pos];
+      if (is_space(c))
+      {
+        ++pos;
+      }
+      else if (is_ident_start(c))
+      {
+        size_t start = pos;
+        while (pos < body.size() && is_ident_char(body[pos]))
+        {
+          ++pos;
+        }
+        tokens.push_back({TemplateToken::Kind::Identifier, body.substr(start, pos - start)});
+      }
+      else if (std::isdigit(static_cast<unsigned char>(c)))
+      {
+        size_t start = pos;
+        while (pos < body.size() && (is_ident_char(body[pos]) || body[pos] == '.'))
+        {
+          ++pos;
+        }
+        tokens.push_back({TemplateToken::Kind::Number, body.substr(start, pos - start)});
+      }
+      else if (c == '\'' || c == '"')
+      {
+        size_t start = pos++;
+        while (pos < body.size() && body[pos] != c)
+        {
+          pos += body[pos] == '\\' ? 2 : 1;
+        }
+        pos = pos < body.size() ? pos + 1 : body.size();
+        tokens.push_back({TemplateToken::Kind::String, body.substr(start, pos - start)});
+      }
+      else
+      {
+        size_t length = 1;
+        if (pos + 1 < body.size())
+        {
+          std::string_view pair = body.substr(pos, 2);
+          if (pair == "==" || pair == "!=" || pair == "<=" || pair == ">=" || pair == "//" || pair == "**")
+          {
+            length = 2;
+          }
+        }
+        tokens.push_back({TemplateToken::Kind::Punct, body.substr(pos, length)});
+        pos += length;
+      }
+    }
+    return tokens;
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace minja_shim_ext_internal
+{
+  // One piece of template source as the lexer sees it. `body` is the text between the
+  // delimiters with whitespace-control markers (`-`, `+`) removed; for Text it is the text.
+  struct TemplateSegment
+  {
+    enum class Kind
+    {
+      Text,
+      Expression, // {{ ... }}
+      Statement,  // {% ... %}
+      Comment,    // {# ... #}
+    };
+
+    Kind kind;
+    size_t begin; // Offset of the segment in the source, delimiters included
+    size_t end;
+    std::string_view body;
+    bool trim_left = false;  // {{- / {%- / {#-
+    bool trim_right = false; // -}} / -%} / -#}
+  };
+
+  struct TemplateToken
+  {
+    enum class Kind
+    {
+      Identifier,
+      String,
+      Number,
+      Punct,
+    };
+
+    Kind kind;
+    std::string_view text; // String tokens keep their quotes
+  };
+
+  // Splits template source into text and tags without parsing expressions. The contents of
+  // {% raw %} blocks are returned as text. An unterminated tag ends the scan with the rest of the
+  // source as text; minja rejects such templates anyway.
+  std::vector<TemplateSegment> scan_template(std::string_view source);
+
+  // Splits the body of a tag into tokens. Multi-character operators are returned one character
+  // at a time except for `==`, `!=`, `<=`, `>=`, `//` and `**`.
+  std::vector<TemplateToken> tokenize_tag(std::string_view body);
+
+  // Leading keyword of a statement body ("for", "endif", ...), or empty.
+  std::string_view statement_keyword(std::string_view body);
+} // namespace minja_shim_ext_internal
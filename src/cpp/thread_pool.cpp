@@ -0,0 +1,230 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+
+namespace minja_shim_ext_internal
+{
+  struct WorkStealingPool::Job
+  {
+    struct Slice
+    {
+      std::mutex mutex;
+      size_t begin = 0;
+      size_t end = 0;
+    };
+
+    Job(size_t count, size_t participants, const std::function<void(size_t)> &body)
+        : body(body), slices(participants), remaining(count)
+    {
+      for (size_t i = 0; i < participants; ++i)
+      {
+        slices[i].begin = count * i / participants;
+        slices[i].end = count * (i + 1) / participants;
+      }
+    }
+
+    const std::function<void(size_t)> &body;
+    std::vector<Slice> slices;
+    std::atomic<size_t> next_slot{1}; // Slot 0 belongs to the calling thread
+    std::atomic<size_t> remaining;
+    std::mutex done_mutex;
+    std::condition_variable done;
+  };
+
+  WorkStealingPool &WorkStealingPool::instance()
+  {
+    // Never destroyed: workers may still be parked when static destructors run at exit.
+    static WorkStealingPool *pool = new WorkStealingPool();
+    return *pool;
+  }
+
+  WorkStealingPool::~WorkStealingPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto &worker : workers_)
+    {
+      worker.join();
+    }
+  }
+
+  void WorkStealingPool::ensure_workers(size_t count)
+  {
+    // Caller holds mutex_.
+    while (workers_.size() < count)
+    {
+      workers_.emplace_back([this] { worker_loop(); });
+    }
+  }
+
+  void WorkStealingPool::worker_loop()
+  {
+    for (;;)
+    {
+      std::shared_ptr<Job> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (stopping_)
+        {
+          return;
+        }
+        job = std::move(queue_.front());
+        queue_.pop_front();
+      }
+
+      size_t slot = job->next_slot.fetch_add(1);
+      if (slot < job->slices.size())
+      {
+        participate(*job, slot);
+      }
+    }
+  }
+
+  void WorkStealingPool::participate(Job &job, size_t slot)
+  {
+    const size_t participants = job.slices.size();
+    for (;;)
+    {
+      size_t index = 0;
+      bool found = false;
+
+      {
+        auto &own = job.slices[slot];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.begin < own.end)
+        {
+          index = own.begin++;
+          found = true;
+        }
+      }
+
+      // Own slice is empty: steal the back half of the first non-empty slice after ours.
+      for (size_t step = 1; !found && step < participants; ++step)
+      {
+        auto &victim = job.slices[(slot + step) % participants];
+        size_t begin = 0, end = 0;
+        {
+          std::lock_guard<std::mutex> lock(victim.mutex);
+          if (victim.begin < victim.end)
+          {
+            size_t half = (victim.end - victim.begin + 1) / 2;
+            end = victim.end;
+            begin = victim.end - half;
+            victim.end = begin;
+          }
+        }
+        if (begin < end)
+        {
+          index = begin;
+          found = true;
+          auto &own = job.slices[slot];
+          std::lock_guard<std::mutex> lock(own.mutex);
+          own.begin = begin + 1;
+          own.end = end;
+        }
+      }
+
+      if (!found)
+      {
+        return;
+      }
+
+      job.body(index);
+      if (job.remaining.fetch_sub(1) == 1)
+      {
+        std::lock_guard<std::mutex> lock(job.done_mutex);
+        job.done.notify_all();
+      }
+    }
+  }
+
+  void WorkStealingPool::parallel_for(size_t count, size_t parallelism, const std::function<void(size_t)> &body)
+  {
+    if (count == 0)
+    {
+      return;
+    }
+    if (parallelism == 0)
+    {
+      parallelism = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    size_t participants = std::min({parallelism, count, kMaxThreads});
+
+    auto job = std::make_shared<Job>(count, participants, body);
+    if (participants > 1)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ensure_workers(participants - 1);
+      for (size_t i = 1; i < participants; ++i)
+      {
+        queue_.push_back(job);
+      }
+    }
+    wake_.notify_all();
+
+    participate(*job, 0);
+
+    // Helpers that start after the last item only find empty slices and never touch body.
+    std::unique_lock<std::mutex> lock(job->done_mutex);
+    job->done.wait(lock, [&] { return job->remaining.load() == 0; });
+  }
+
+  TaskExecutor &TaskExecutor::instance()
+  {
+    // Never destroyed, for the same reason as WorkStealingPool.
+    static TaskExecutor *executor = new TaskExecutor();
+    return *executor;
+  }
+
+  TaskExecutor::~TaskExecutor()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto &worker : workers_)
+    {
+      worker.join();
+    }
+  }
+
+  void TaskExecutor::post(std::function<void()> task)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(std::move(task));
+      size_t limit = std::max<size_t>(1, std::thread::hardware_concurrency());
+      if (idle_ < queue_.size() && workers_.size() < limit)
+      {
+        workers_.emplace_back([this] { worker_loop(); });
+      }
+    }
+    wake_.notify_one();
+  }
+
+  void TaskExecutor::worker_loop()
+  {
+    for (;;)
+    {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++idle_;
+        wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        --idle_;
+        if (stopping_)
+        {
+          return;
+        }
+        task = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      task();
+    }
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,68 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace minja_shim_ext_internal
+{
+  // Process-wide pool that runs index ranges in parallel. Each participant of a job starts with
+  // an equal slice of the range and takes items from its front; once its slice is empty it steals
+  // the back half of another participant's slice, so uneven item costs still balance out.
+  // The calling thread takes part in its own job, which keeps nested or single-threaded use cheap.
+  class WorkStealingPool
+  {
+  public:
+    static constexpr size_t kMaxThreads = 256;
+
+    static WorkStealingPool &instance();
+
+    // Runs body(i) for every i in [0, count) on up to `parallelism` threads, the caller included
+    // (0 means one per hardware thread), and returns once every item has run. body must not throw.
+    void parallel_for(size_t count, size_t parallelism, const std::function<void(size_t)> &body);
+
+  private:
+    struct Job;
+
+    WorkStealingPool() = default;
+    ~WorkStealingPool();
+
+    void ensure_workers(size_t count);
+    void worker_loop();
+    static void participate(Job &job, size_t slot);
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::shared_ptr<Job>> queue_;
+    std::vector<std::thread> workers_;
+    bool stopping_ = false;
+  };
+
+  // Process-wide queue of independent tasks, used for asynchronous renders. Workers start on
+  // demand, one per hardware thread at most; tasks beyond that wait in the queue in order.
+  class TaskExecutor
+  {
+  public:
+    static TaskExecutor &instance();
+
+    // Queues a task. Tasks must not throw.
+    void post(std::function<void()> task);
+
+  private:
+    TaskExecutor() = default;
+    ~TaskExecutor();
+
+    void worker_loop();
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::function<void()>> queue_;
+    std::vector<std::thread> workers_;
+    size_t idle_ = 0;
+    bool stopping_ = false;
+  };
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,254 @@
+#include "tojson_filter.h"
+#include "print_filter.h"
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MINJA_SHIM_JSON_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define MINJA_SHIM_JSON_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace minja_shim_ext_internal
+{
+  namespace
+  {
+    bool needs_attention(unsigned char c) { return c == '"' || c == '\\' || c < 0x20 || c >= 0x80; }
+
+    // Index of the first byte in [begin, end) that cannot be copied as is: a quote, a backslash,
+    // a control character or the start of a multi-byte sequence. Returns `end` if there is none.
+    size_t find_attention(const char *data, size_t begin, size_t end)
+    {
+      size_t i = begin;
+#if defined(MINJA_SHIM_JSON_SSE2)
+      const __m128i quote = _mm_set1_epi8('"');
+      const __m128i backslash = _mm_set1_epi8('\\');
+      const __m128i space = _mm_set1_epi8(0x20);
+      for (; i + 16 <= end; i += 16)
+      {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        // Signed comparison: bytes >= 0x80 are negative, so they count as below 0x20 too.
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, quote), _mm_cmpeq_epi8(bytes, backslash)), _mm_cmplt_epi8(bytes, space));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        if (mask != 0)
+        {
+#if defined(_MSC_VER)
+          unsigned long bit;
+          _BitScanForward(&bit, mask);
+          return i + bit;
+#else
+          return i + static_cast<size_t>(__builtin_ctz(mask));
+#endif
+        }
+      }
+#elif defined(MINJA_SHIM_JSON_NEON)
+      const uint8x16_t quote = vdupq_n_u8('"');
+      const uint8x16_t backslash = vdupq_n_u8('\\');
+      const uint8x16_t space = vdupq_n_u8(0x20);
+      const uint8x16_t high = vdupq_n_u8(0x80);
+      for (; i + 16 <= end; i += 16)
+      {
+        uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t *>(data + i));
+        uint8x16_t hits = vorrq_u8(vorrq_u8(vceqq_u8(bytes, quote), vceqq_u8(bytes, backslash)),
+                                   vorrq_u8(vcltq_u8(bytes, space), vcgeq_u8(bytes, high)));
+        if (vmaxvq_u8(hits) != 0)
+        {
+          break; // The scalar loop below finds the byte within this block
+        }
+      }
+#endif
+      for (; i < end; ++i)
+      {
+        if (needs_attention(static_cast<unsigned char>(data[i])))
+        {
+          return i;
+        }
+      }
+      return end;
+    }
+
+    // Length of the well-formed UTF-8 sequence starting at `i`, or 0 if it is malformed. Accepts
+    // what nlohmann's decoder accepts: no overlong forms, surrogates or code points past U+10FFFF.
+    size_t utf8_sequence_length(const unsigned char *s, size_t i, size_t end)
+    {
+      auto continuation = [&](size_t k, unsigned char low = 0x80, unsigned char high = 0xBF) {
+        return k < end && s[k] >= low && s[k] <= high;
+      };
+      unsigned char lead = s[i];
+      if (lead >= 0xC2 && lead <= 0xDF)
+      {
+        return continuation(i + 1) ? 2 : 0;
+      }
+      if (lead >= 0xE0 && lead <= 0xEF)
+      {
+        unsigned char low = lead == 0xE0 ? 0xA0 : 0x80;
+        unsigned char high = lead == 0xED ? 0x9F : 0xBF;
+        return continuation(i + 1, low, high) && continuation(i + 2) ? 3 : 0;
+      }
+      if (lead >= 0xF0 && lead <= 0xF4)
+      {
+        unsigned char low = lead == 0xF0 ? 0x90 : 0x80;
+        unsigned char high = lead == 0xF4 ? 0x8F : 0xBF;
+        return continuation(i + 1, low, high) && continuation(i + 2) && continuation(i + 3) ? 4 : 0;
+      }
+      return 0;
+    }
+  } // namespace
+
+  void append_json_string(std::string_view text, std::string &out)
+  {
+    static const char hex[] = "0123456789abcdef";
+    const char *data = text.data();
+    const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+    size_t size = text.size();
+
+    out.reserve(out.size() + size + 2);
+    out += '"';
+    size_t run = 0;
+    size_t i = 0;
+    while ((i = find_attention(data, i, size)) < size)
+    {
+      unsigned char c = bytes[i];
+      if (c >= 0x80)
+      {
+        size_t length = utf8_sequence_length(bytes, i, size);
+        if (length == 0)
+        {
+          // Let nlohmann raise the error minja would have raised, message included.
+          (void)minja::json(std::string(text)).dump();
+        }
+        i += length;
+        continue;
+      }
+
+      out.append(data + run, i - run);
+      switch (c)
+      {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\b':
+        out += "\\b";
+        break;
+      case '\f':
+        out += "\\f";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        out += "\\u00";
+        out += hex[c >> 4];
+        out += hex[c & 0xF];
+        break;
+      }
+      run = ++i;
+    }
+    out.append(data + run, size - run);
+    out += '"';
+  }
+
+  bool append_json(const minja::Value &value, std::string &out)
+  {
+    if (value.is_null())
+    {
+      out += "null";
+    }
+    else if (value.is_array())
+    {
+      out += '[';
+      for (size_t i = 0, n = value.size(); i < n; ++i)
+      {
+        if (i > 0)
+        {
+          out += ", ";
+        }
+        if (!append_json(value.at(i), out))
+        {
+          return false;
+        }
+      }
+      out += ']';
+    }
+    else if (value.is_object())
+    {
+      out += '{';
+      bool first = true;
+      // keys() is not const; the copy shares the object.
+      for (const auto &key : minja::Value(value).keys())
+      {
+        if (!key.is_string())
+        {
+          return false;
+        }
+        if (!first)
+        {
+          out += ", ";
+        }
+        first = false;
+        append_json_string(key.get<std::string>(), out);
+        out += ": ";
+        if (!append_json(value.at(key), out))
+        {
+          return false;
+        }
+      }
+      out += '}';
+    }
+    else if (value.is_callable())
+    {
+      return false;
+    }
+    else if (value.is_string())
+    {
+      append_json_string(value.get<std::string>(), out);
+    }
+    else if (value.is_boolean())
+    {
+      out += value.get<bool>() ? "true" : "false";
+    }
+    else
+    {
+      // Numbers keep nlohmann's formatting (shortest round-trip doubles, unsigned integers).
+      out += value.get<minja::json>().dump();
+    }
+    return true;
+  }
+
+  const std::shared_ptr<minja::Context> &shim_builtins()
+  {
+    static const std::shared_ptr<minja::Context> builtins = [] {
+      auto context = minja::Context::builtins();
+      minja::Value name("tojson");
+      auto original = context->get(name);
+      context->set(name, minja::Value::callable([original](const std::shared_ptr<minja::Context> &ctx, minja::ArgumentsValue &args) {
+        // Indentation and other keyword arguments are rare; they keep minja's implementation.
+        if (args.args.size() == 1 && args.kwargs.empty())
+        {
+          std::string out;
+          if (append_json(args.args[0], out))
+          {
+            return minja::Value(out);
+          }
+        }
+        return original.call(ctx, args);
+      }));
+      context->set(minja::Value(kPrintFilterName), print_filter());
+      return context;
+    }();
+    return builtins;
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,26 @@
+#pragma once
+#include <minja/minja.hpp>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace minja_shim_ext_internal
+{
+  // minja's builtins with `tojson` replaced by append_json and the print filter (print_filter.h)
+  // added, created once per process. Root contexts
+  // made by the shim use it as their parent instead of a fresh Context::builtins() each, which also
+  // saves rebuilding the builtin table for every context. Templates can only `set` into their own
+  // context, so sharing it between threads is safe.
+  const std::shared_ptr<minja::Context> &shim_builtins();
+
+  // Appends `value` as minja's tojson filter prints it (Value::dump with to_json and no indent:
+  // Python-style ", " and ": " separators, non-ASCII text unescaped). Strings are copied in runs
+  // between the characters that need escaping, found 16 bytes at a time with SSE2 or NEON where
+  // available. Returns false, leaving `out` unspecified, for values it does not handle itself
+  // (callables, non-string object keys); the filter then falls back to minja's implementation.
+  bool append_json(const minja::Value &value, std::string &out);
+
+  // Appends `text` as a JSON string literal, escaped like nlohmann::json::dump. Invalid UTF-8 throws
+  // nlohmann's type_error, as it does in minja.
+  void append_json_string(std::string_view text, std::string &out);
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,230 @@
+#include "value_buffer.h"
+#include "key_table.h"
+#include <cstring>
+#include <utility>
+
+using namespace minja;
+
+namespace minja_shim_ext_internal
+{
+  namespace
+  {
+    constexpr uint8_t kMagic[3] = {'M', 'J', 'V'};
+    constexpr uint8_t kVersion = 2;
+    constexpr uint32_t kNullLength = 0xFFFFFFFFu;
+    // Version 2: an object key length with this bit set is an interned key id instead.
+    constexpr uint32_t kInternedKey = 0x80000000u;
+    // Guards the recursive decoder against stack exhaustion on hostile input.
+    constexpr int kMaxDepth = 512;
+
+    enum Tag : uint8_t
+    {
+      kTagNull = 0x00,
+      kTagFalse = 0x01,
+      kTagTrue = 0x02,
+      kTagInt64 = 0x03,
+      kTagDouble = 0x04,
+      kTagString = 0x05,
+      kTagArray = 0x06,
+      kTagObject = 0x07,
+      kTagInt64Array = 0x08,
+      kTagDoubleArray = 0x09,
+      kTagStringArray = 0x0A,
+    };
+
+    class Reader
+    {
+    public:
+      Reader(const uint8_t *data, size_t length) : pos_(data), end_(data + length) {}
+
+      bool at_end() const { return pos_ == end_; }
+
+      uint8_t read_u8()
+      {
+        require(1);
+        return *pos_++;
+      }
+
+      uint32_t read_u32()
+      {
+        require(4);
+        uint32_t v = uint32_t(pos_[0]) | (uint32_t(pos_[1]) << 8) | (uint32_t(pos_[2]) << 16) | (uint32_t(pos_[3]) << 24);
+        pos_ += 4;
+        return v;
+      }
+
+      uint64_t read_u64()
+      {
+        uint64_t lo = read_u32();
+        uint64_t hi = read_u32();
+        return lo | (hi << 32);
+      }
+
+      int64_t read_i64() { return static_cast<int64_t>(read_u64()); }
+
+      double read_f64()
+      {
+        uint64_t bits = read_u64();
+        double d;
+        std::memcpy(&d, &bits, sizeof d);
+        return d;
+      }
+
+      std::string read_string(uint32_t length)
+      {
+        require(length);
+        std::string s(reinterpret_cast<const char *>(pos_), length);
+        pos_ += length;
+        return s;
+      }
+
+      // Element counts are checked against the bytes left so a corrupt count can't
+      // trigger a huge allocation or a long loop.
+      uint32_t read_count(size_t min_element_size)
+      {
+        uint32_t count = read_u32();
+        if (min_element_size && count > static_cast<size_t>(end_ - pos_) / min_element_size)
+        {
+          throw ValueBufferError("element count exceeds buffer size");
+        }
+        return count;
+      }
+
+    private:
+      void require(size_t n)
+      {
+        if (static_cast<size_t>(end_ - pos_) < n)
+        {
+          throw ValueBufferError("unexpected end of buffer");
+        }
+      }
+
+      const uint8_t *pos_;
+      const uint8_t *end_;
+    };
+
+    Value decode_node(Reader &reader, uint8_t version, int depth)
+    {
+      if (depth > kMaxDepth)
+      {
+        throw ValueBufferError("value tree is nested too deeply");
+      }
+
+      uint8_t tag = reader.read_u8();
+      switch (tag)
+      {
+      case kTagNull:
+        return Value();
+      case kTagFalse:
+        return Value(false);
+      case kTagTrue:
+        return Value(true);
+      case kTagInt64:
+        return Value(reader.read_i64());
+      case kTagDouble:
+        return Value(reader.read_f64());
+      case kTagString:
+        return Value(reader.read_string(reader.read_u32()));
+      case kTagArray:
+      {
+        auto array = Value::array();
+        for (uint32_t i = 0, n = reader.read_count(1); i < n; ++i)
+        {
+          push_back_moved(array, decode_node(reader, version, depth + 1));
+        }
+        return array;
+      }
+      case kTagObject:
+      {
+        auto object = Value::object();
+        for (uint32_t i = 0, n = reader.read_count(5); i < n; ++i)
+        {
+          uint32_t length = reader.read_u32();
+          if (version >= 2 && (length & kInternedKey))
+          {
+            const Value *key = KeyTable::instance().find(length & ~kInternedKey);
+            if (!key)
+            {
+              throw ValueBufferError("unknown interned key " + std::to_string(length & ~kInternedKey));
+            }
+            set_moved(object, *key, decode_node(reader, version, depth + 1));
+          }
+          else
+          {
+            Value key(reader.read_string(length));
+            set_moved(object, key, decode_node(reader, version, depth + 1));
+          }
+        }
+        return object;
+      }
+      case kTagInt64Array:
+      {
+        auto array = Value::array();
+        for (uint32_t i = 0, n = reader.read_count(8); i < n; ++i)
+        {
+          array.push_back(Value(reader.read_i64()));
+        }
+        return array;
+      }
+      case kTagDoubleArray:
+      {
+        auto array = Value::array();
+        for (uint32_t i = 0, n = reader.read_count(8); i < n; ++i)
+        {
+          array.push_back(Value(reader.read_f64()));
+        }
+        return array;
+      }
+      case kTagStringArray:
+      {
+        auto array = Value::array();
+        for (uint32_t i = 0, n = reader.read_count(4); i < n; ++i)
+        {
+          uint32_t length = reader.read_u32();
+          push_back_moved(array, length == kNullLength ? Value() : Value(reader.read_string(length)));
+        }
+        return array;
+      }
+      default:
+        throw ValueBufferError("unknown value tag " + std::to_string(tag));
+      }
+    }
+  } // namespace
+
+  void push_back_moved(Value &array, Value &&item)
+  {
+    array.push_back(Value());
+    array.at(array.size() - 1) = std::move(item);
+  }
+
+  void set_moved(Value &object, const Value &key, Value &&item)
+  {
+    object.set(key, Value());
+    object.at(key) = std::move(item);
+  }
+
+  Value decode_value_buffer(const uint8_t *data, size_t length)
+  {
+    Reader reader(data, length);
+    for (uint8_t expected : kMagic)
+    {
+      if (reader.read_u8() != expected)
+      {
+        throw ValueBufferError("missing value buffer header");
+      }
+    }
+
+    uint8_t version = reader.read_u8();
+    if (version == 0 || version > kVersion)
+    {
+      throw ValueBufferError("unsupported value buffer version " + std::to_string(version));
+    }
+
+    auto root = decode_node(reader, version, 0);
+    if (!reader.at_end())
+    {
+      throw ValueBufferError("trailing bytes after root value");
+    }
+    return root;
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,24 @@
+#pragma once
+#include <minja/minja.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace minja_shim_ext_internal
+{
+  // Raised when a binary value buffer is truncated, malformed or of an unsupported version.
+  struct ValueBufferError : std::runtime_error
+  {
+    explicit ValueBufferError(const std::string &message) : std::runtime_error(message) {}
+  };
+
+  // Decodes a binary value buffer (format described next to mj_value_from_buffer in
+  // minja_shim_ext.h) into a minja::Value in a single pass.
+  minja::Value decode_value_buffer(const uint8_t *data, size_t length);
+
+  // minja::Value only offers copying inserts. These insert a null placeholder and move the
+  // item into it, so strings and containers are moved instead of copied.
+  void push_back_moved(minja::Value &array, minja::Value &&item);
+  void set_moved(minja::Value &object, const minja::Value &key, minja::Value &&item);
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,331 @@
+#include "value_digest.h"
+#include "handles.h"
+#include <array>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace minja_shim_ext_internal
+{
+  std::atomic<bool> g_value_digests_enabled{false};
+
+  namespace
+  {
+    enum Tag : uint8_t
+    {
+      kNull = 1,
+      kFalse,
+      kTrue,
+      kInteger,
+      kFloat,
+      kString,
+      kArray,
+      kObject,
+      kFold,
+      kSource,
+    };
+
+    uint64_t rotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+    // SipHash-2-4 with 128-bit output, fed incrementally.
+    class SipHasher
+    {
+    public:
+      SipHasher(uint64_t k0, uint64_t k1)
+          : v0_(0x736f6d6570736575ull ^ k0), v1_(0x646f72616e646f6dull ^ k1 ^ 0xee), v2_(0x6c7967656e657261ull ^ k0),
+            v3_(0x7465646279746573ull ^ k1)
+      {
+      }
+
+      void update(const void *data, size_t n)
+      {
+        auto bytes = static_cast<const unsigned char *>(data);
+        length_ += n;
+        while (n > 0)
+        {
+          if (fill_ == 0 && n >= 8)
+          {
+            uint64_t m = 0;
+            for (int i = 7; i >= 0; --i)
+            {
+              m = (m << 8) | bytes[i];
+            }
+            compress(m);
+            bytes += 8;
+            n -= 8;
+            continue;
+          }
+          tail_ |= uint64_t(*bytes++) << (8 * fill_);
+          --n;
+          if (++fill_ == 8)
+          {
+            compress(tail_);
+            tail_ = 0;
+            fill_ = 0;
+          }
+        }
+      }
+
+      void update_u64(uint64_t v)
+      {
+        unsigned char bytes[8];
+        for (int i = 0; i < 8; ++i)
+        {
+          bytes[i] = static_cast<unsigned char>(v >> (8 * i));
+        }
+        update(bytes, sizeof(bytes));
+      }
+
+      ValueDigest finish()
+      {
+        compress(tail_ | (uint64_t(length_ & 0xff) << 56));
+        v2_ ^= 0xee;
+        rounds(4);
+        uint64_t lo = v0_ ^ v1_ ^ v2_ ^ v3_;
+        v1_ ^= 0xdd;
+        rounds(4);
+        uint64_t hi = v0_ ^ v1_ ^ v2_ ^ v3_;
+        return {lo, hi};
+      }
+
+    private:
+      void compress(uint64_t m)
+      {
+        v3_ ^= m;
+        rounds(2);
+        v0_ ^= m;
+      }
+
+      void rounds(int count)
+      {
+        for (int i = 0; i < count; ++i)
+        {
+          v0_ += v1_;
+          v1_ = rotl(v1_, 13) ^ v0_;
+          v0_ = rotl(v0_, 32);
+          v2_ += v3_;
+          v3_ = rotl(v3_, 16) ^ v2_;
+          v0_ += v3_;
+          v3_ = rotl(v3_, 21) ^ v0_;
+          v2_ += v1_;
+          v1_ = rotl(v1_, 17) ^ v2_;
+          v2_ = rotl(v2_, 32);
+        }
+      }
+
+      uint64_t v0_, v1_, v2_, v3_;
+      uint64_t tail_ = 0;
+      size_t fill_ = 0;
+      size_t length_ = 0;
+    };
+
+    // The key is drawn once per process, so digests cannot be predicted, nor collisions searched
+    // for, from outside it.
+    SipHasher hasher(Tag tag)
+    {
+      static const std::array<uint64_t, 2> key = [] {
+        std::random_device device;
+        std::array<uint64_t, 2> words{};
+        for (auto &word : words)
+        {
+          word = (uint64_t(device()) << 32) ^ device();
+        }
+        return words;
+      }();
+      SipHasher h(key[0], key[1]);
+      h.update(&tag, 1);
+      return h;
+    }
+
+    ValueDigest nonzero(ValueDigest digest)
+    {
+      if (!digest.known())
+      {
+        digest.lo = 1;
+      }
+      return digest;
+    }
+
+    ValueDigest scalar(Tag tag, uint64_t bits)
+    {
+      SipHasher h = hasher(tag);
+      h.update_u64(bits);
+      return nonzero(h.finish());
+    }
+
+    ValueDigest text_digest(Tag tag, std::string_view text)
+    {
+      SipHasher h = hasher(tag);
+      h.update_u64(text.size());
+      h.update(text.data(), text.size());
+      return nonzero(h.finish());
+    }
+
+    ValueDigest fold(ValueDigest state, ValueDigest item)
+    {
+      SipHasher h = hasher(kFold);
+      h.update_u64(state.lo);
+      h.update_u64(state.hi);
+      h.update_u64(item.lo);
+      h.update_u64(item.hi);
+      return nonzero(h.finish());
+    }
+
+    ValueDigest member(ValueDigest state, const minja::Value &key, ValueDigest item)
+    {
+      ValueDigest key_digest = digest_of(key);
+      if (!key_digest.known())
+      {
+        return {};
+      }
+      return fold(fold(state, key_digest), item);
+    }
+
+    bool is_container(const minja::Value &value)
+    {
+      return value.is_array() || value.is_object();
+    }
+  } // namespace
+
+  ValueDigest digest_of(const minja::Value &value)
+  {
+    if (value.is_null())
+    {
+      return scalar(kNull, 0);
+    }
+    if (value.is_boolean())
+    {
+      return scalar(value.get<bool>() ? kTrue : kFalse, 0);
+    }
+    if (value.is_number_integer())
+    {
+      return scalar(kInteger, static_cast<uint64_t>(value.get<int64_t>()));
+    }
+    if (value.is_number_float())
+    {
+      double d = value.get<double>();
+      uint64_t bits;
+      std::memcpy(&bits, &d, sizeof(bits));
+      return scalar(kFloat, bits);
+    }
+    if (value.is_string())
+    {
+      return text_digest(kString, value.get<std::string>());
+    }
+    if (value.is_array())
+    {
+      ValueDigest state = scalar(kArray, 0);
+      for (size_t i = 0, n = value.size(); i < n; ++i)
+      {
+        ValueDigest item = digest_of(value.at(i));
+        if (!item.known())
+        {
+          return {};
+        }
+        state = fold(state, item);
+      }
+      return state;
+    }
+    if (value.is_object())
+    {
+      ValueDigest state = scalar(kObject, 0);
+      // keys() is not const; the copy shares the object.
+      for (const auto &key : minja::Value(value).keys())
+      {
+        ValueDigest item = digest_of(value.at(key));
+        if (!item.known())
+        {
+          return {};
+        }
+        state = member(state, key, item);
+        if (!state.known())
+        {
+          return {};
+        }
+      }
+      return state;
+    }
+    return {}; // Callables
+  }
+
+  void init_digest(ValueHandle &handle) noexcept
+  {
+    handle.digest = {};
+    if (value_digests_enabled())
+    {
+      try
+      {
+        handle.digest = digest_of(handle.value);
+      }
+      catch (...)
+      {
+        // The digest is optional; the cache walks the value when it is needed instead.
+      }
+    }
+  }
+
+  ValueDigest source_digest(std::string_view source)
+  {
+    return text_digest(kSource, source);
+  }
+
+  void note_appended(ValueHandle &array, ValueHandle &item, bool moved)
+  {
+    if (!moved && is_container(item.value))
+    {
+      // Both handles now share the container, and either side can be edited in place later
+      // (mj_context_append on a context made from one of them, say).
+      share_digest(array);
+      share_digest(item);
+      return;
+    }
+    if (!array.digest.known() || !item.digest.known() || !value_digests_enabled())
+    {
+      array.digest = {};
+      return;
+    }
+    array.digest = fold(array.digest, item.digest);
+  }
+
+  void note_member_set(ValueHandle &object, const minja::Value &key, ValueHandle &item, bool moved, size_t size_before)
+  {
+    if (!moved && is_container(item.value))
+    {
+      share_digest(object);
+      share_digest(item);
+      return;
+    }
+    // A replaced member keeps its position, so the running digest cannot be patched.
+    if (!object.digest.known() || !item.digest.known() || !value_digests_enabled() || object.value.size() == size_before)
+    {
+      object.digest = {};
+      return;
+    }
+    object.digest = member(object.digest, key, item.digest);
+  }
+
+  void forget_digest(ValueHandle &handle)
+  {
+    handle.digest = {};
+  }
+
+  void share_digest(ValueHandle &handle)
+  {
+    handle.digest = {};
+    handle.digest_shared = true;
+  }
+
+  ValueDigest digest_for(ValueHandle &handle)
+  {
+    if (handle.digest.known())
+    {
+      return handle.digest;
+    }
+    ValueDigest digest = digest_of(handle.value);
+    if (!handle.digest_shared)
+    {
+      handle.digest = digest;
+    }
+    return digest;
+  }
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,62 @@
+#pragma once
+#include <minja/minja.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace minja_shim_ext_internal
+{
+  struct ValueHandle;
+
+  // 128-bit structural hash of a value tree: equal trees have equal digests. Object members are
+  // hashed in order, since their order shows in the output; integers and floats are kept apart,
+  // since 1 and 1.0 print differently. {0, 0} means "not known"; real digests are never zero.
+  //
+  // Digests are built from SipHash-2-4 (128-bit output) under a key drawn at random once per
+  // process. The result cache trusts a digest match without comparing values, so the digest must
+  // be a keyed cryptographic hash: request content is user-controlled, and a collision would hand
+  // one request another's rendered prompt.
+  struct ValueDigest
+  {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+
+    bool known() const { return (lo | hi) != 0; }
+    bool operator==(const ValueDigest &other) const { return lo == other.lo && hi == other.hi; }
+  };
+
+  // Digests are only maintained while the result cache is on (see ResultCache::set_budget). While
+  // it is off, handles skip hashing and a mutation only clears the container's digest.
+  extern std::atomic<bool> g_value_digests_enabled;
+
+  inline bool value_digests_enabled()
+  {
+    return g_value_digests_enabled.load(std::memory_order_relaxed);
+  }
+
+  // Hashes a whole tree. Unknown if it contains a callable.
+  ValueDigest digest_of(const minja::Value &value);
+
+  // Digest of template source, which identifies a template in the result cache.
+  ValueDigest source_digest(std::string_view source);
+
+  // Digest bookkeeping for the C API. A handle's digest is maintained as the value is built: set
+  // when the handle is created, then folded forward as elements and members are added, so the
+  // digest of a tree built node by node is ready without walking it again.
+  //
+  // It is only kept where nothing else can change the value behind the handle's back. Value
+  // copies are shallow, so when a container is copied (not moved) into another, or a context is
+  // made from a value, the handles involved are marked shared (share_digest) and from then on are
+  // walked on every lookup. Otherwise a walked digest is stored on the handle until the value
+  // changes: forget_digest drops it after an edit the bookkeeping cannot follow, such as a
+  // template calling `.append()` on the value it renders.
+  void init_digest(ValueHandle &handle) noexcept;
+  void note_appended(ValueHandle &array, ValueHandle &item, bool moved);
+  void note_member_set(ValueHandle &object, const minja::Value &key, ValueHandle &item, bool moved, size_t size_before);
+  void forget_digest(ValueHandle &handle);
+  void share_digest(ValueHandle &handle);
+
+  // The handle's digest, walking the value (and keeping the result, unless shared) if it has none.
+  ValueDigest digest_for(ValueHandle &handle);
+} // namespace minja_shim_ext_internal
@@ -0,0 +1,96 @@
+using System.Collections.Generic;
+using Xunit;
+using MinjaSharp;
+
+namespace MinjaSharp.Tests
+{
+    public class ChatSessionTests
+    {
+        private const string ChatMlTemplate =
+            "{%- for message in messages %}" +
+            "{%- set content = message.content %}" +
+            "{%- if message.role == 'tool' %}{%- set content = '<tool_response>' + content + '</tool_response>' %}{%- endif %}" +
+            "{{- '<|im_start|>' + message.role + '\\n' + content + '<|im_end|>\\n' }}" +
+            "{%- endfor %}" +
+            "{%- if add_generation_prompt %}{{- '<|im_start|>assistant\\n' }}{%- endif %}";
+
+        private static readonly ChatMessage[] Turns =
+        [
+            new() { Role = "system", Content = "You are a helpful AI assistant." },
+            new() { Role = "user", Content = "What's the weather in Paris?" },
+            new() { Role = "assistant", Content = "Let me check." },
+            new() { Role = "tool", Content = "{\"temp\": 21}" },
+            new() { Role = "assistant", Content = "It is 21 degrees. <|im_end|> True" },
+            new() { Role = "user", Content = "Thanks!" },
+        ];
+
+        [Fact]
+        public void AppendedTurnsRenderIdenticallyToFullRenders()
+        {
+            using var template = new Template(ChatMlTemplate);
+            AssertMatchesFullRenders(template, expectIncremental: true);
+        }
+
+        [Fact]
+        public void QwenTemplateFallsBackToFullRenders()
+        {
+            using var template = new Template(QwenChatTemplate.QwenTemplate);
+            AssertMatchesFullRenders(template, expectIncremental: false);
+        }
+
+        [Fact]
+        public void SpansMarkEachMessageAndTheGenerationPrompt()
+        {
+            using var template = new Template(ChatMlTemplate);
+            ChatMessage[] messages = [.. Turns, new() { Role = "user", Content = "Merci — à bientôt 👋" }];
+            using var ctx = Context.From(new Qwen3ChatRequest { Messages = messages, AddGenerationPrompt = true });
+
+            var render = template.RenderWithSpans(ctx);
+            Assert.Equal(template.Render(ctx), render.Output);
+            Assert.Equal(messages.Length, render.Elements.Count);
+            Assert.Equal("", render.Output[render.Header]);
+            for (var i = 0; i < messages.Length; i++)
+            {
+                Assert.StartsWith($"<|im_start|>{messages[i].Role}\n", render.Output[render.Elements[i]]);
+                Assert.EndsWith("<|im_end|>\n", render.Output[render.Elements[i]]);
+            }
+            Assert.Equal("<|im_start|>assistant\n", render.Output[render.Tail]);
+
+            using var qwen = new Template(QwenChatTemplate.QwenTemplate);
+            Assert.Throws<NotSupportedException>(() => qwen.RenderWithSpans(ctx));
+        }
+
+        [Theory]
+        [InlineData("{%- for message in messages %}{%- set n = (n or 0) + 1 %}{{ n }}:{{ message.content }}\n{%- endfor %}")]
+        [InlineData("{%- for message in messages | reverse %}{{ message.role }}: {{ message.content }}\n{%- endfor %}")]
+        [InlineData("{%- for message in messages[1:] %}{{ message.role }}: {{ message.content }}\n{%- endfor %}")]
+        public void LoopsThatDependOnEarlierMessagesFallBackToFullRenders(string source)
+        {
+            using var template = new Template(source);
+            AssertMatchesFullRenders(template, expectIncremental: false);
+        }
+
+        private static void AssertMatchesFullRenders(Template template, bool expectIncremental)
+        {
+            var request = new Qwen3ChatRequest { AddGenerationPrompt = true };
+            using var session = ChatSession.Create(template, request);
+            Assert.Equal(expectIncremental, session.IsIncremental);
+
+            var history = new List<ChatMessage>();
+            foreach (var turn in Turns)
+            {
+                session.Append(turn);
+                history.Add(turn);
+
+                var full = template.Render(new Qwen3ChatRequest { Messages = [.. history], AddGenerationPrompt = true });
+                Assert.Equal(full, session.Render());
+                Assert.Equal(full, session.Render());
+            }
+
+            // Changing another variable invalidates the retained output.
+            session.Set("add_generation_prompt", Value.Bool(false));
+            var expected = template.Render(new Qwen3ChatRequest { Messages = [.. history], AddGenerationPrompt = false });
+            Assert.Equal(expected, session.Render());
+        }
+    }
+}
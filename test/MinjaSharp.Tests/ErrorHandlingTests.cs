@@ -72,5 +72,19 @@ namespace MinjaSharp.Tests
             Assert.Contains("Template rendering failed", exception.Message);
             Assert.Contains("missing_variable", exception.Message);
         }
+
+        [Fact]
+        public void RenderError_QuotesTheTemplateAsWritten()
+        {
+            using var template = new Template("Hello\n{{ missing_variable.property }}");
+
+            using var ctx = Context.From(new { existing = "value" });
+            var exception = Assert.Throws<MinjaRenderException>(() => template.Render(ctx));
+
+            // Booleans are printed through a filter the shim adds to every expression; the
+            // excerpt must still show the source as it was passed in
+            Assert.Contains("{{ missing_variable.property }}", exception.Message);
+            Assert.DoesNotContain("_shim_print", exception.Message);
+        }
     }
 }
\ No newline at end of file
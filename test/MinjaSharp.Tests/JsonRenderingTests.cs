@@ -59,6 +59,17 @@ namespace MinjaSharp.Tests
             Assert.Throws<MinjaJsonException>(() => template.RenderJson("invalid json"));
         }
 
+        [Fact]
+        public void Utf8JsonRendersWithoutCopyingAndKeepsKeyOrder()
+        {
+            using var template = new Template("{% for key, value in data.items() %}{{ key }}={{ value }};{% endfor %}{{ flag }} {{ big }}");
+
+            var result = template.RenderJson("{\"data\":{\"zeta\":1,\"alpha\":\"a\",\"mid\":2.5},\"flag\":true,\"big\":18446744073709551615}"u8);
+
+            Assert.Equal("zeta=1;alpha=a;mid=2.5;true 18446744073709551615", result);
+            Assert.Throws<MinjaJsonException>(() => template.RenderJson("{\"data\":"u8));
+        }
+
         [Fact]
         public void DisposedTemplateThrowsExceptionWhenRenderingJson()
         {
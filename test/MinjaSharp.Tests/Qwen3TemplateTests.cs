@@ -233,5 +233,69 @@ namespace MinjaSharp.Tests
             Assert.Contains("<tool_call>", result);
             Assert.Contains("<tool_response>", result);
         }
+
+        [Fact]
+        public void AnalysisFollowsLoopVariables()
+        {
+            using var template = new Template(
+                "{% for m in messages %}{{ m.role }}{% if m.tool_calls is defined %}!{% endif %}{% endfor %}" +
+                "{{ messages|length }}{{ name|upper }}");
+
+            var analysis = template.Analyze();
+
+            Assert.True(analysis.IsComplete);
+            Assert.Equal(new[] { "messages", "name" }, analysis.Variables);
+            Assert.Contains(analysis.Paths, p => p.SequenceEqual(new[] { "messages", TemplateAnalysis.AnyElement, "role" }));
+            Assert.Contains(analysis.Shapes, p => p.SequenceEqual(new[] { "messages" }));
+            Assert.Contains(analysis.Shapes, p => p.SequenceEqual(new[] { "messages", TemplateAnalysis.AnyElement, "tool_calls" }));
+            Assert.Contains("upper", analysis.Filters);
+        }
+
+        [Fact]
+        public void PrunedContextRendersLikeTheFullRequest()
+        {
+            var request = new Qwen3ChatRequest
+            {
+                Tools = [new Tool { Name = "weather", Description = "Get the current weather for a location" }],
+                Messages =
+                [
+                    new ChatMessage { Role = "user", Content = "What's the weather in Seattle?" },
+                    new ChatMessage
+                    {
+                        Role = "assistant",
+                        Content = "I'll check the weather for you.",
+                        ToolCalls = [new ToolCall { Function = new FunctionCall { Name = "weather", Arguments = "{\"location\":\"Seattle\"}" } }]
+                    },
+                    new ChatMessage { Role = "tool", Content = "{\"temperature\": 52}" }
+                ]
+            };
+
+            using var context = _template.CreateContext(request);
+
+            Assert.Equal(_template.Render(request), _template.Render(context));
+        }
+
+        [Fact]
+        public void PrunedContextKeepsFieldsReadThroughNeighbouringItems()
+        {
+            using var template = new Template(
+                "{% for m in messages %}{{ m.content }}" +
+                "{% if loop.nextitem and loop.nextitem.role == 'tool' %} ->{% endif %}" +
+                "{% if loop.previtem %} (after {{ loop.previtem['name'] }}){% endif %};{% endfor %}");
+            var request = new
+            {
+                messages = new[]
+                {
+                    new { role = "assistant", content = "call", name = "planner" },
+                    new { role = "tool", content = "52F", name = "weather" }
+                }
+            };
+
+            using var context = template.CreateContext(request);
+
+            Assert.True(template.Analyze().IsComplete);
+            Assert.Equal("call ->;52F (after planner);", template.Render(context));
+            Assert.Equal(template.Render(request), template.Render(context));
+        }
     }
 }
\ No newline at end of file
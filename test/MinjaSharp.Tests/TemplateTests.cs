@@ -1,4 +1,8 @@
 using System;
+using System.Buffers;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
 using Xunit;
 using MinjaSharp;
 
@@ -80,6 +84,307 @@ namespace MinjaSharp.Tests
             Assert.Equal("Apple, Banana, Cherry", result);
         }
 
+        [Fact]
+        public void OwnedValuesAreMovedIntoParents()
+        {
+            using var template = new Template("{{ user.name }}: {{ tags | join(', ') }}");
+
+            var user = Value.Object();
+            user.SetOwned("name", Value.String("Alice"));
+
+            var tags = Value.Array();
+            var first = Value.String("admin");
+            tags.AddOwned(first);
+            tags.AddOwned(Value.String("editor"));
+
+            var root = Value.Object();
+            root.SetOwned("user", user);
+            root.SetOwned("tags", tags);
+
+            using var ctx = new Context(root, takeOwnership: true);
+
+            Assert.Equal("Alice: admin, editor", template.Render(ctx));
+            Assert.Throws<ObjectDisposedException>(() => tags.Add(Value.Null()));
+            Assert.Throws<ObjectDisposedException>(() => root.Set("x", Value.Null()));
+        }
+
+        [Fact]
+        public void CachedTemplatesAreParsedOnce()
+        {
+            // Unique source so other tests sharing the process-wide cache cannot interfere.
+            var source = $"{{{{ greeting }}}} {Guid.NewGuid():N}";
+            var before = TemplateCache.GetStatistics();
+
+            using var first = Template.FromCache(source);
+            using var second = Template.FromCache(source);
+            using var ctx = Context.From(new { greeting = "hi" });
+
+            var after = TemplateCache.GetStatistics();
+            Assert.True(after.Misses >= before.Misses + 1);
+            Assert.True(after.Hits >= before.Hits + 1);
+            Assert.Equal(first.Render(ctx), second.Render(ctx));
+            Assert.StartsWith("hi ", first.Render(ctx));
+            Assert.Throws<MinjaParseException>(() => Template.FromCache("{% if %}"));
+        }
+
+        [Fact]
+        public void PooledRenderersReuseTheirBuffers()
+        {
+            using var template = new Template("{% for item in items %}{{ item }};{% endfor %}");
+            using var small = Context.From(new { items = new[] { 1, 2, 3 } });
+            using var large = Context.From(new { items = Enumerable.Range(0, 500).ToArray() });
+
+            var renderer = Renderer.Rent();
+            try
+            {
+                for (var i = 0; i < 3; i++)
+                {
+                    Assert.Equal(template.Render(large), renderer.Render(template, large));
+                    Assert.Equal("1;2;3;", renderer.Render(template, small));
+                }
+            }
+            finally
+            {
+                Renderer.Return(renderer);
+            }
+
+            var again = Renderer.Rent();
+            Assert.Equal("1;2;3;", again.Render(template, small));
+            Renderer.Return(again);
+        }
+
+        [Fact]
+        public void LazyContextsOnlyReadWhatTheTemplateUses()
+        {
+            using var template = new Template("{{ name }}: {% for m in messages %}{{ m.role }} {% endfor %}{{ name }}{{ missing }}");
+            var request = new TrackedRequest();
+            using var ctx = Context.FromLazy(request);
+
+            Assert.Equal("chat: user assistant chat", template.Render(ctx));
+            Assert.Equal(1, request.MessageReads());
+            Assert.Equal(0, request.PayloadReads());
+
+            using var fromDictionary = Context.FromLazy(new Dictionary<string, object> { ["name"] = "dict", ["messages"] = Array.Empty<object>() });
+            Assert.Equal("dict: dict", template.Render(fromDictionary));
+        }
+
+        private sealed class TrackedRequest
+        {
+            private int _messageReads;
+            private int _payloadReads;
+
+            public string Name => "chat";
+
+            public object[] Messages
+            {
+                get
+                {
+                    _messageReads++;
+                    return [new { role = "user" }, new { role = "assistant" }];
+                }
+            }
+
+            public byte[] Payload
+            {
+                get
+                {
+                    _payloadReads++;
+                    return new byte[1 << 20];
+                }
+            }
+
+            public int MessageReads() => _messageReads;
+
+            public int PayloadReads() => _payloadReads;
+        }
+
+        [Fact]
+        public void RenderManyMatchesIndividualRendersAndReportsErrorsPerItem()
+        {
+            using var template = new Template("{% if n is string %}{{ raise_exception('bad item') }}{% endif %}item {{ n }}");
+            var contexts = new List<Context>();
+            for (var i = 0; i < 200; i++)
+            {
+                contexts.Add(Context.From(new { n = i % 50 == 0 ? (object)"x" : i }));
+            }
+
+            try
+            {
+                var results = template.RenderMany(contexts, threadCount: 4);
+
+                Assert.Equal(contexts.Count, results.Length);
+                for (var i = 0; i < results.Length; i++)
+                {
+                    if (i % 50 == 0)
+                    {
+                        Assert.False(results[i].Succeeded);
+                        Assert.IsType<MinjaRenderException>(results[i].Error);
+                    }
+                    else
+                    {
+                        Assert.Equal(template.Render(contexts[i]), results[i].Output);
+                    }
+                }
+            }
+            finally
+            {
+                contexts.ForEach(c => c.Dispose());
+            }
+        }
+
+        [Fact]
+        public void DerivedContextsShareTheirBase()
+        {
+            using var template = new Template("{% set greeting = 'Hi' %}{{ greeting }} {{ name }}, tools: {{ tools | join(',') }}");
+            using var shared = Context.From(new { tools = new[] { "search", "calc" }, name = "nobody" });
+
+            using var alice = shared.Derive(new { name = "Alice" });
+            using var bob = shared.Derive(new { name = "Bob" });
+
+            Assert.Equal("Hi Alice, tools: search,calc", template.Render(alice));
+            Assert.Equal("Hi Bob, tools: search,calc", template.Render(bob));
+
+            // Variables set while rendering a derived context stay in its overlay.
+            using var probe = new Template("{{ greeting is defined }}");
+            using var derived = shared.Derive(new { });
+            Assert.Equal("false", probe.Render(derived));
+        }
+
+        [Fact]
+        public void StatisticsAreCollectedOnlyWhileEnabled()
+        {
+            using var template = new Template("{% if fail %}{{ raise_exception('boom') }}{% endif %}Hello {{ name }}!");
+            using var ok = Context.From(new { fail = false, name = "World" });
+            using var bad = Context.From(new { fail = true, name = "World" });
+
+            MinjaRenderException error;
+            MinjaMetrics.Enabled = true;
+            try
+            {
+                template.Render(ok);
+                template.Render(ok);
+                error = Assert.Throws<MinjaRenderException>(() => template.Render(bad));
+            }
+            finally
+            {
+                MinjaMetrics.Enabled = false;
+            }
+            template.Render(ok);
+
+            var stats = template.GetStatistics();
+            Assert.Equal(3UL, stats.Render.Renders);
+            Assert.Equal(1UL, stats.Render.Errors);
+            Assert.Equal(2UL * (ulong)"Hello World!".Length, stats.Render.OutputBytes);
+            Assert.Equal(3UL, stats.Render.Time.Count);
+            Assert.True(stats.Render.Time.GetPercentile(50) > TimeSpan.Zero);
+
+            var global = MinjaMetrics.GetStatistics();
+            Assert.True(global.Render.Renders >= 3);
+            Assert.True(global.ErrorsByCode[error.ErrorCode] >= 1);
+            Assert.True(global.LiveTemplates >= 1);
+
+            template.ResetStatistics();
+            Assert.Equal(0UL, template.GetStatistics().Render.Renders);
+        }
+
+        [Fact]
+        public void BooleansRenderLowercaseWithoutTouchingText()
+        {
+            using var template = new Template("{{ flag }}/{{ other }}: {{ text }}");
+            using var ctx = Context.From(new { flag = true, other = false, text = "True story, False alarm" });
+
+            Assert.Equal("true/false: True story, False alarm", template.Render(ctx));
+        }
+
+        [Theory]
+        [InlineData("{{ text }}", "True")]
+        [InlineData("{% if flag %}True{% endif %}", "True")]
+        [InlineData("{{ text|string }}", "True")]
+        [InlineData("{{ 'Tr' ~ 'ue' }}", "True")]
+        [InlineData("{{ [flag, false] }}", "[true, false]")]
+        [InlineData("{{ {'on': flag, 'text': text} }}", "{'on': true, 'text': 'True'}")]
+        [InlineData("{{ flag -}} !", "true!")]
+        [InlineData("a {{- flag -}} b", "atrueb")]
+        [InlineData("{%- if flag -%} {{ flag }} {%- endif %}", "true")]
+        [InlineData("{% raw %}{{ flag }} {{- text }}{% endraw %}", "{{ flag }} {{- text }}")]
+        [InlineData("{% filter trim %} {{ flag }} {% endfilter %}", "true")]
+        [InlineData("{% filter upper %}{{ flag }} {{ text }}{% endfilter %}", "TRUE TRUE")]
+        public void OnlyBooleanValuesPrintLowercase(string source, string expected)
+        {
+            using var template = new Template(source);
+            using var ctx = Context.From(new { flag = true, text = "True" });
+
+            Assert.Equal(expected, template.Render(ctx));
+        }
+
+        [Fact]
+        public void TryRenderWritesIntoCallerBuffer()
+        {
+            using var template = new Template("Hello, {{ name }}!");
+            using var ctx = Context.From(new { name = "World" });
+
+            var buffer = new byte[64];
+            var success = template.TryRender(ctx, buffer, out var bytesWritten);
+
+            Assert.True(success);
+            Assert.Equal("Hello, World!", Encoding.UTF8.GetString(buffer, 0, bytesWritten));
+        }
+
+        [Fact]
+        public void TryRenderReportsRequiredSizeWhenBufferTooSmall()
+        {
+            using var template = new Template("Hello, {{ name }}!");
+            using var ctx = Context.From(new { name = "World" });
+
+            var success = template.TryRender(ctx, new byte[4], out var required);
+
+            Assert.False(success);
+            Assert.Equal(Encoding.UTF8.GetByteCount("Hello, World!"), required);
+
+            var buffer = new byte[required];
+            Assert.True(template.TryRender(ctx, buffer, out var bytesWritten));
+            Assert.Equal("Hello, World!", Encoding.UTF8.GetString(buffer, 0, bytesWritten));
+        }
+
+        [Fact]
+        public void RenderToStreamMatchesStringRender()
+        {
+            using var template = new Template("{% for item in items %}{{ item.name }}={{ item.active }};{% endfor %}");
+            var items = new List<object>();
+            for (var i = 0; i < 50; i++)
+            {
+                items.Add(new { name = $"item{i}", active = i % 2 == 0 });
+            }
+            using var ctx = Context.From(new { items });
+
+            using var stream = new MemoryStream();
+            template.Render(ctx, stream, flushThreshold: 16);
+
+            Assert.Equal(template.Render(ctx), Encoding.UTF8.GetString(stream.ToArray()));
+        }
+
+        [Fact]
+        public void RenderToBufferWriterMatchesStringRender()
+        {
+            using var template = new Template("Hello, {{ name }}! Flag: {{ flag }}");
+            using var ctx = Context.From(new { name = "World", flag = false });
+
+            var writer = new ArrayBufferWriter<byte>();
+            template.Render(ctx, writer);
+
+            Assert.Equal("Hello, World! Flag: false", Encoding.UTF8.GetString(writer.WrittenSpan));
+        }
+
+        [Fact]
+        public void RenderToStreamPropagatesDestinationExceptions()
+        {
+            using var template = new Template("Hello, {{ name }}!");
+            using var ctx = Context.From(new { name = "World" });
+            using var stream = new MemoryStream(new byte[4], writable: false);
+
+            Assert.Throws<NotSupportedException>(() => template.Render(ctx, stream));
+        }
+
         [Fact]
         public void DisposedTemplateThrowsException()
         {
@@ -91,5 +396,147 @@ namespace MinjaSharp.Tests
             
             Assert.Throws<ObjectDisposedException>(() => template.Render(ctx));
         }
+
+        [Fact]
+        public void ToJsonMatchesPythonSeparatorsAndEscaping()
+        {
+            using var template = new Template("{{ data|tojson }}");
+
+            var result = template.RenderJson(
+                "{\"data\": {\"text\": \"say \\\"hi\\\"\\n\\u0001caf\u00e9 \\\\o/\", \"n\": 3, \"x\": 1.5, \"ok\": true, \"none\": null, \"list\": [1, []]}}");
+
+            Assert.Equal(
+                "{\"text\": \"say \\\"hi\\\"\\n\\u0001caf\u00e9 \\\\o/\", \"n\": 3, \"x\": 1.5, \"ok\": true, \"none\": null, \"list\": [1, []]}",
+                result);
+        }
+
+        [Fact]
+        public async Task RenderAsyncMatchesRender()
+        {
+            using var template = new Template("Hello, {{ name }}!");
+            var root = Value.Object();
+            root.Set("name", Value.String("World"));
+            using var ctx = new Context(root);
+
+            Assert.Equal(template.Render(ctx), await template.RenderAsync(ctx));
+        }
+
+        [Fact]
+        public async Task RunawayRendersStopAtTheirDeadlineOrWhenCancelled()
+        {
+            using var template = new Template("{% for i in range(10000) %}{% for j in range(10000) %}x{% endfor %}{% endfor %}");
+            using var ctx = new Context(Value.Object());
+
+            await Assert.ThrowsAsync<TimeoutException>(() => template.RenderAsync(ctx, TimeSpan.FromMilliseconds(50)));
+
+            using var cts = new CancellationTokenSource(TimeSpan.FromMilliseconds(50));
+            await Assert.ThrowsAnyAsync<OperationCanceledException>(() => template.RenderAsync(ctx, cts.Token));
+        }
+
+        [Fact]
+        public void RenderCachedReusesOutputForEqualValues()
+        {
+            ResultCache.SetBudget(1 << 20);
+            try
+            {
+                using var template = new Template("{% set greeting = 'Hello' %}{{ greeting }}, {{ name }}!");
+                var before = ResultCache.GetStatistics();
+
+                Assert.Equal("Hello, Ann!", template.RenderCached(new { name = "Ann" }));
+                Assert.Equal("Hello, Ann!", template.RenderCached(new { name = "Ann" }));
+                Assert.Equal("Hello, Bob!", template.RenderCached(new { name = "Bob" }));
+
+                // A value built node by node hashes like the same value built from an object.
+                using var root = Value.Object();
+                root.Set("name", Value.String("Ann"));
+                Assert.Equal("Hello, Ann!", template.RenderCached(root));
+
+                var after = ResultCache.GetStatistics();
+                Assert.Equal(2UL, after.Hits - before.Hits);
+                Assert.Equal(2UL, after.Misses - before.Misses);
+
+                // The template's `set` did not write into the caller's value.
+                using var check = new Template("{{ greeting is defined }}");
+                using var ctx = new Context(root);
+                Assert.Equal("false", check.Render(ctx));
+            }
+            finally
+            {
+                ResultCache.SetBudget(0);
+            }
+        }
+
+        [Fact]
+        public void RenderCachedSeesEditsToSharedSubtrees()
+        {
+            ResultCache.SetBudget(1 << 20);
+            try
+            {
+                using var template = new Template("{% for m in messages %}{{ m }};{% endfor %}");
+                using var child = Value.Object();
+                using var messages = Value.Array();
+                messages.Add(Value.String("a"));
+                child.Set("messages", messages);
+                Assert.Equal("a;", template.RenderCached(child));
+
+                // The parent holds a shallow copy of child, so an edit made through its context
+                // changes what child renders.
+                using var parent = Value.Object();
+                parent.Set("inner", child);
+                using var ctx = new Context(parent);
+                ctx.Append("inner.messages", Value.String("b"));
+                Assert.Equal("a;b;", template.RenderCached(child));
+            }
+            finally
+            {
+                ResultCache.SetBudget(0);
+            }
+        }
+
+        [Fact]
+        public void RenderCachedSeesEditsMadeByTheTemplate()
+        {
+            ResultCache.SetBudget(1 << 20);
+            try
+            {
+                using var template = new Template("{% set _ = items.append(1) %}{{ items|length }}");
+                using var root = Value.Object();
+                root.SetOwned("items", Value.Array());
+
+                Assert.Equal("1", template.RenderCached(root));
+                Assert.Equal("2", template.RenderCached(root));
+            }
+            finally
+            {
+                ResultCache.SetBudget(0);
+            }
+        }
+
+        [Fact]
+        public void ContextEditsApplyInPlace()
+        {
+            using var template = new Template("{% for m in messages %}{{ m.role }}:{{ m.content }};{% endfor %}{{ title }}");
+            using var ctx = Context.From(new
+            {
+                messages = new[] { new { role = "user", content = "Hi" } },
+                title = "draft"
+            });
+
+            ctx.Append("messages", new { role = "assistant", content = "Hello" });
+            ctx.SetPath("messages.0.content", Value.String("Hey"));
+            ctx.SetPath("title", Value.String("final"));
+            Assert.Equal("user:Hey;assistant:Hello;final", template.Render(ctx));
+
+            ctx.RemovePath("messages.0");
+            ctx.RemovePath("title");
+            Assert.Equal("assistant:Hello;", template.Render(ctx));
+
+            Assert.Throws<ArgumentException>(() => ctx.RemovePath("messages.5"));
+            Assert.Throws<ArgumentException>(() => ctx.Append("title", Value.Null()));
+
+            // Paths never reach into a base context.
+            using var derived = ctx.Derive(Value.Object());
+            Assert.Throws<ArgumentException>(() => derived.Append("messages", Value.Null()));
+        }
     }
 }
\ No newline at end of file
@@ -111,6 +111,64 @@ namespace MinjaSharp.Tests
             Assert.Equal("Regular, Custom", result);
         }
         
+        [Fact]
+        public void PrimitiveCollectionsConvertCorrectly()
+        {
+            using var template = new Template("{{ ints | join(',') }}|{{ longs | join(',') }}|{{ doubles | join(',') }}|{{ names[0] }}{{ names[2] }}|{{ names[1] is none }}");
+
+            var result = template.Render(new
+            {
+                ints = new[] { 1, 2, 3 },
+                longs = new List<long> { 4L, 5L },
+                doubles = new[] { 0.5, 1.5 },
+                names = new[] { "a", null, "c" }
+            });
+            Assert.Equal("1,2,3|4,5|0.5,1.5|ac|true", result);
+        }
+
+        [Fact]
+        public void UnreadablePropertiesAreSkipped()
+        {
+            using var template = new Template("{{ name }}{% if broken is defined %}!{% endif %}");
+            var result = template.Render(new ThrowingPropertyClass());
+            Assert.Equal("ok", result);
+        }
+
+        [Fact]
+        public void InternedKeysSetObjectProperties()
+        {
+            var role = ValueKey.Intern("role");
+            Assert.Equal(role, ValueKey.Intern("role"));
+
+            var message = Value.Object();
+            message.Set(role, Value.String("user"));
+            message.SetOwned(ValueKey.Intern("content"), Value.String("Hi"));
+            Assert.Throws<ArgumentException>(() => message.Set(default(ValueKey), Value.Null()));
+
+            var root = Value.Object();
+            root.SetOwned(ValueKey.Intern("message"), message);
+            var person = Value.Object();
+            person.SetOwned(ValueKey.Intern("name"), Value.String("Ann"));
+            root.SetOwned(ValueKey.Intern("person"), person);
+            using var ctx = new Context(root);
+            using var template = new Template("{{ message.role }}: {{ message.content }} / {{ person.name }}");
+            Assert.Equal("user: Hi / Ann", template.Render(ctx));
+
+            // POCO property names travel as interned ids in the value buffer.
+            Assert.Equal("user: Hi / Ann", template.Render(new
+            {
+                message = new { role = "user", content = "Hi" },
+                person = new { name = "Ann" }
+            }));
+        }
+
+        private class ThrowingPropertyClass
+        {
+            public string Name => "ok";
+
+            public string Broken => throw new InvalidOperationException("boom");
+        }
+
         private class TestJsonPropertyClass
         {
             public string RegularName { get; set; } = string.Empty;